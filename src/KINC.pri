@@ -19,7 +19,7 @@ QMAKE_CXX = mpic++
 CONFIG += c++11
 
 # Compiler flags
-QMAKE_CXXFLAGS += -Wno-ignored-attributes
+QMAKE_CXXFLAGS += -Wno-ignored-attributes -Wno-psabi
 
 # Preprocessor defines
 DEFINES += \
@@ -51,7 +51,7 @@ LIBS += \
     -lacecore \
     -lgsl -lopenblas \
     -L$${CUDADIR}/lib64 -lcuda -lnvrtc -lcusolver -fopenmp \
-    -lOpenCL -lmpi
+    -lOpenCL -lmpi -lnuma -lrt
 
 equals(LINK_LAPACKE, 1) { LIBS += -llapacke }
 equals(LINK_MPI_CXX, 1) { LIBS += -lmpi_cxx }
@@ -24,15 +24,19 @@ QAbstractTableModel* CCMatrix::model()
 
 /*!
  * Initialize this cluster matrix with a list of gene names, the max cluster
- * size, and a list of sample names.
+ * size, a list of sample names, and the storage format. The label format
+ * stores one byte for the number of clusters and four bits per sample for
+ * each pair, instead of four bits per sample for each cluster, but it can
+ * only be used if the max cluster size is not larger than MAX_LABEL_CLUSTERS.
  *
  * @param geneNames
  * @param maxClusterSize
  * @param sampleNames
+ * @param format
  */
-void CCMatrix::initialize(const EMetaArray& geneNames, int maxClusterSize, const EMetaArray& sampleNames)
+void CCMatrix::initialize(const EMetaArray& geneNames, int maxClusterSize, const EMetaArray& sampleNames, Format format)
 {
-   EDEBUG_FUNC(this,&geneNames,maxClusterSize,&sampleNames);
+   EDEBUG_FUNC(this,&geneNames,maxClusterSize,&sampleNames,static_cast<int>(format));
 
    // make sure sample names is not empty
    if ( sampleNames.isEmpty() )
@@ -43,14 +47,33 @@ void CCMatrix::initialize(const EMetaArray& geneNames, int maxClusterSize, const
       throw e;
    }
 
+   // make sure the label format can represent every cluster
+   if ( format == Format::Labels && maxClusterSize > MAX_LABEL_CLUSTERS )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Domain Error"));
+      e.setDetails(tr("The label format supports at most %1 clusters per pair.").arg(static_cast<int>(MAX_LABEL_CLUSTERS)));
+      throw e;
+   }
+
    // save sample names to metadata
    EMetaObject metaObject {meta().toObject()};
    metaObject.insert("samples", sampleNames);
    setMeta(metaObject);
 
-   // save sample size and initialize base class
+   // determine the size of each record, which in the label format has an
+   // additional byte for the number of clusters
+   qint32 dataSize {static_cast<qint32>((sampleNames.size() + 1) / 2 * sizeof(qint8))};
+
+   if ( format == Format::Labels )
+   {
+      dataSize += sizeof(qint8);
+   }
+
+   // save sample size and format and initialize base class
    _sampleSize = sampleNames.size();
-   Matrix::initialize(geneNames, maxClusterSize, static_cast<qint32>((_sampleSize + 1) / 2 * sizeof(qint8)), SUBHEADER_SIZE);
+   _format = format;
+   Matrix::initialize(geneNames, maxClusterSize, dataSize, SUBHEADER_SIZE);
 }
 
 
@@ -67,3 +90,161 @@ EMetaArray CCMatrix::sampleNames() const
 
    return meta().toObject().at("samples").toArray();
 }
+
+
+
+
+
+
+/*!
+ * Encode the clusters of a pair directly from its sample labels and append
+ * them to the given data in the record layout of this matrix, so that they
+ * can be written with Matrix::writeRecords(). The clusters array maps each
+ * label of the pair to its cluster in the matrix, or to -1 if the cluster is
+ * not kept, and a negative label marks a sample that was removed from the
+ * pair. In the label format the record is the number of clusters followed by
+ * the label code of each sample, and in the mask format there is a record
+ * with the sample mask of each cluster, with two samples per byte in both
+ * formats.
+ *
+ * @param labels
+ * @param clusters
+ * @param clusterSize
+ * @param data
+ */
+void CCMatrix::encodePair(const qint8* labels, const qint8* clusters, qint8 clusterSize, std::vector<char>& data) const
+{
+   // write the number of clusters and the label code of each sample in the
+   // label format
+   if ( _format == Format::Labels )
+   {
+      data.push_back(clusterSize);
+
+      for ( int i = 0; i < _sampleSize; i += 2 )
+      {
+         qint8 value {encodeLabel(labels[i], clusters)};
+
+         if ( i + 1 < _sampleSize )
+         {
+            value |= static_cast<qint8>(encodeLabel(labels[i + 1], clusters) << 4);
+         }
+
+         data.push_back(value);
+      }
+
+      return;
+   }
+
+   // otherwise write the sample mask of each cluster
+   for ( qint8 k = 0; k < clusterSize; ++k )
+   {
+      for ( int i = 0; i < _sampleSize; i += 2 )
+      {
+         qint8 value {static_cast<qint8>(((labels[i] >= 0) ? (clusters[labels[i]] == k) : -labels[i]) & 0x0F)};
+
+         if ( i + 1 < _sampleSize )
+         {
+            value |= static_cast<qint8>(((labels[i + 1] >= 0) ? (clusters[labels[i + 1]] == k) : -labels[i + 1]) << 4);
+         }
+
+         data.push_back(value);
+      }
+   }
+}
+
+
+
+
+
+
+/*!
+ * Return the number of records which are stored for a pair with the given
+ * number of clusters, which in the label format is a single record for all
+ * clusters.
+ *
+ * @param clusterSize
+ */
+qint8 CCMatrix::recordSize(qint8 clusterSize) const
+{
+   if ( _format == Format::Labels )
+   {
+      return std::min<qint8>(clusterSize, 1);
+   }
+
+   return clusterSize;
+}
+
+
+
+
+
+
+/*!
+ * Return the code of a sample label in the label format, given the map from
+ * each label to its cluster in the matrix. A sample in a kept cluster k has
+ * the code k + 1, a sample in a cluster which is not kept has the code 0, and
+ * a sample which was removed from the pair has the negated label as its code.
+ * Labels of removed samples which cannot be encoded in this way are rejected.
+ *
+ * @param label
+ * @param clusters
+ */
+qint8 CCMatrix::encodeLabel(qint8 label, const qint8* clusters) const
+{
+   if ( label >= 0 )
+   {
+      return clusters[label] + 1;
+   }
+
+   if ( -label <= MAX_LABEL_CLUSTERS || -label >= 16 )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Domain Error"));
+      e.setDetails(tr("Sample label %1 cannot be encoded in the label format.").arg(label));
+      throw e;
+   }
+
+   return -label;
+}
+
+
+
+
+
+
+/*!
+ * Write the sub-header to the data object file.
+ */
+void CCMatrix::writeHeader()
+{
+   EDEBUG_FUNC(this);
+
+   stream() << _sampleSize << static_cast<qint8>(_format);
+}
+
+
+
+
+
+
+/*!
+ * Read the sub-header from the data object file. Files which were written
+ * before the storage format was added to the sub-header are read in the mask
+ * format.
+ */
+void CCMatrix::readHeader()
+{
+   EDEBUG_FUNC(this);
+
+   stream() >> _sampleSize;
+
+   _format = Format::Masks;
+
+   if ( subHeaderSize() > 4 )
+   {
+      qint8 format;
+      stream() >> format;
+
+      _format = static_cast<Format>(format);
+   }
+}
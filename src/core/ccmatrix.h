@@ -1,5 +1,7 @@
 #ifndef CCMATRIX_H
 #define CCMATRIX_H
+#include <vector>
+
 #include "pairwise_matrix.h"
 
 
@@ -15,35 +17,61 @@ class CCMatrix : public Pairwise::Matrix
    Q_OBJECT
 public:
    class Pair;
+   /*!
+    * Defines the storage formats of the cluster matrix.
+    */
+   enum class Format : qint8
+   {
+      /*!
+       * Each cluster of a pair is stored as a separate sample mask.
+       */
+      Masks
+      /*!
+       * Each pair is stored as a single vector of sample labels, from which
+       * the sample mask of each cluster is reconstructed when it is read.
+       */
+      ,Labels
+   };
+   /*!
+    * The maximum number of clusters of a pair which can be stored in the
+    * label format.
+    */
+   constexpr static int MAX_LABEL_CLUSTERS {5};
 public:
    virtual QAbstractTableModel* model() override final;
 public:
-   void initialize(const EMetaArray& geneNames, int maxClusterSize, const EMetaArray& sampleNames);
+   void initialize(const EMetaArray& geneNames, int maxClusterSize, const EMetaArray& sampleNames, Format format = Format::Masks);
    EMetaArray sampleNames() const;
+   void encodePair(const qint8* labels, const qint8* clusters, qint8 clusterSize, std::vector<char>& data) const;
    /*!
     * Return the number of samples in the cluster matrix.
     */
    int sampleSize() const { return _sampleSize; }
+   /*!
+    * Return the storage format of the cluster matrix.
+    */
+   Format format() const { return _format; }
 private:
    class Model;
 private:
-   /*!
-    * Write the sub-header to the data object file.
-    */
-   virtual void writeHeader() override final { stream() << _sampleSize; }
-   /*!
-    * Read the sub-header from the data object file.
-    */
-   virtual void readHeader() override final { stream() >> _sampleSize; }
+   virtual void writeHeader() override final;
+   virtual void readHeader() override final;
+   virtual qint8 recordSize(qint8 clusterSize) const override final;
+   qint8 encodeLabel(qint8 label, const qint8* clusters) const;
    /*!
     * The size (in bytes) of the sub-header. The sub-header consists of the
-    * sample size.
+    * sample size and the storage format. Files without the storage format
+    * have a sub-header of 4 bytes and are stored in the mask format.
     */
-   constexpr static qint16 SUBHEADER_SIZE {4};
+   constexpr static qint16 SUBHEADER_SIZE {5};
    /*!
     * The number of samples in each sample mask.
     */
    qint32 _sampleSize {0};
+   /*!
+    * The storage format of the cluster matrix.
+    */
+   Format _format {Format::Masks};
    /*!
     * Pointer to a qt table model for this class.
     */
@@ -16,7 +16,8 @@ using namespace std;
  * @param matrix
  */
 CCMatrix::Model::Model(CCMatrix* matrix):
-   _matrix(matrix)
+   _matrix(matrix),
+   _pair(matrix)
 {
    EDEBUG_FUNC(this,matrix);
 
@@ -123,16 +124,15 @@ QVariant CCMatrix::Model::data(const QModelIndex& index, int role) const
       return "";
    }
 
-   // get constant pair and read in values
-   const Pair pair(_matrix);
+   // read in values of the pair
    int x {index.row()};
    int y {index.column()};
    if ( y > x )
    {
       swap(x,y);
    }
-   pair.read({x,y});
+   _pair.read({x,y});
 
    // Return value of pair as a string
-   return pair.toString();
+   return _pair.toString();
 }
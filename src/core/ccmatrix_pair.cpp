@@ -95,14 +95,206 @@ QString CCMatrix::Pair::toString() const
 
 
 /*!
- * Write a cluster in the iterator's pairwise data to the data object file.
+ * Return the number of records which are written for this pair, which in the
+ * label format is a single record for all clusters.
+ */
+int CCMatrix::Pair::recordSize() const
+{
+   EDEBUG_FUNC(this);
+
+   return _cMatrix->recordSize(clusterSize());
+}
+
+
+
+
+
+
+/*!
+ * Return the label code of a sample in the label format. A sample which is
+ * in cluster k has the code k + 1, and a sample which is not in any cluster
+ * has the code of its value in every sample mask, which is either 0 for a
+ * sample that was not assigned to a remaining cluster or 6 or more for a
+ * sample that was removed from the pair. Sample masks which cannot be
+ * encoded in this way are rejected.
+ *
+ * @param sample
+ */
+qint8 CCMatrix::Pair::encodeSample(int sample) const
+{
+   int member {-1};
+   int value {-1};
+   bool valid {true};
+
+   for ( int k = 0; k < _sampleMasks.size(); ++k )
+   {
+      qint8 mask {_sampleMasks[k][sample]};
+
+      if ( mask == 1 )
+      {
+         valid &= (member == -1);
+         member = k;
+      }
+      else
+      {
+         valid &= (value == -1 || value == mask);
+         value = mask;
+      }
+   }
+
+   if ( member != -1 )
+   {
+      valid &= (value == -1 || value == 0);
+   }
+   else
+   {
+      valid &= (value == 0 || (value > MAX_LABEL_CLUSTERS && value < 16));
+   }
+
+   if ( !valid )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Domain Error"));
+      e.setDetails(tr("Sample %1 of the pair cannot be encoded in the label format.").arg(sample));
+      throw e;
+   }
+
+   return (member != -1) ? member + 1 : value;
+}
+
+
+
+
+
+
+/*!
+ * Set the value of a sample in each sample mask from its label code in the
+ * label format.
+ *
+ * @param sample
+ * @param code
+ */
+void CCMatrix::Pair::decodeSample(int sample, qint8 code) const
+{
+   if ( 0 < code && code <= MAX_LABEL_CLUSTERS )
+   {
+      for ( int k = 0; k < _sampleMasks.size(); ++k )
+      {
+         _sampleMasks[k][sample] = (k == code - 1);
+      }
+   }
+   else
+   {
+      for ( int k = 0; k < _sampleMasks.size(); ++k )
+      {
+         _sampleMasks[k][sample] = code;
+      }
+   }
+}
+
+
+
+
+
+
+/*!
+ * Write the label vector of the pair to a stream, which consists
+ * of the number of clusters followed by the label code of each sample with
+ * two samples per byte.
+ *
+ * @param stream
+ */
+template<class Stream>
+void CCMatrix::Pair::writeLabels(Stream& stream)
+{
+   // write the number of clusters
+   stream << static_cast<qint8>(_sampleMasks.size());
+
+   // write the label code of each sample
+   int sampleSize {_cMatrix->_sampleSize};
+
+   for ( int i = 0; i < sampleSize; i += 2 )
+   {
+      qint8 value {encodeSample(i)};
+
+      if ( i + 1 < sampleSize )
+      {
+         value |= static_cast<qint8>(encodeSample(i + 1) << 4);
+      }
+
+      stream << value;
+   }
+}
+
+
+
+
+
+
+/*!
+ * Read the label vector of the pair from a stream and reconstruct
+ * the sample mask of each cluster. The first cluster has already been added
+ * by the base iterator.
+ *
+ * @param stream
+ */
+template<class Stream>
+void CCMatrix::Pair::readLabels(Stream& stream) const
+{
+   // read the number of clusters and make sure it is within range
+   qint8 clusterSize;
+   stream >> clusterSize;
+
+   if ( clusterSize < 1 || clusterSize > _cMatrix->maxClusterSize() )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("File IO Error"));
+      e.setDetails(tr("Reading pair failed because cluster size %1 is invalid.").arg(clusterSize));
+      throw e;
+   }
+
+   addCluster(clusterSize - _sampleMasks.size());
+
+   // read the label code of each sample
+   int sampleSize {_cMatrix->_sampleSize};
+
+   for ( int i = 0; i < sampleSize; i += 2 )
+   {
+      qint8 value;
+      stream >> value;
+
+      decodeSample(i, value & 0x0F);
+
+      if ( i + 1 < sampleSize )
+      {
+         decodeSample(i + 1, (value >> 4) & 0x0F);
+      }
+   }
+}
+
+
+
+
+
+
+/*!
+ * Write a cluster in the iterator's pairwise data to a stream, which is either
+ * the data object file or a chunk of the data object.
+ * In the label format, every cluster of the pair is written with the first
+ * cluster.
  *
  * @param stream
  * @param cluster
  */
-void CCMatrix::Pair::writeCluster(EDataStream& stream, int cluster)
+template<class Stream>
+void CCMatrix::Pair::encodeCluster(Stream& stream, int cluster)
 {
-   EDEBUG_FUNC(this,&stream,cluster);
+   // write the label vector of the pair in the label format
+   if ( _cMatrix->_format == Format::Labels )
+   {
+      writeLabels(stream);
+      return;
+   }
 
    // make sure cluster value is within range
    if ( cluster >= 0 && cluster < _sampleMasks.size() )
@@ -130,14 +322,22 @@ void CCMatrix::Pair::writeCluster(EDataStream& stream, int cluster)
 
 
 /*!
- * Read a cluster from the data object file into memory.
+ * Read a cluster from a stream into memory, which is either the data object
+ * file or a chunk of the data object. In the label format, every cluster of
+ * the pair is read with the first cluster.
  *
  * @param stream
  * @param cluster
  */
-void CCMatrix::Pair::readCluster(const EDataStream& stream, int cluster) const
+template<class Stream>
+void CCMatrix::Pair::decodeCluster(Stream& stream, int cluster) const
 {
-   EDEBUG_FUNC(this,&stream,cluster);
+   // read the label vector of the pair in the label format
+   if ( _cMatrix->_format == Format::Labels )
+   {
+      readLabels(stream);
+      return;
+   }
 
    // make sure cluster value is within range
    if ( cluster >= 0 && cluster < _sampleMasks.size() )
@@ -159,3 +359,76 @@ void CCMatrix::Pair::readCluster(const EDataStream& stream, int cluster) const
       }
    }
 }
+
+
+
+
+
+
+/*!
+ * Write a cluster in the iterator's pairwise data to the data object file.
+ *
+ * @param stream
+ * @param cluster
+ */
+void CCMatrix::Pair::writeCluster(EDataStream& stream, int cluster)
+{
+   EDEBUG_FUNC(this,&stream,cluster);
+
+   encodeCluster(stream, cluster);
+}
+
+
+
+
+
+
+/*!
+ * Read a cluster from the data object file into memory.
+ *
+ * @param stream
+ * @param cluster
+ */
+void CCMatrix::Pair::readCluster(const EDataStream& stream, int cluster) const
+{
+   EDEBUG_FUNC(this,&stream,cluster);
+
+   decodeCluster(stream, cluster);
+}
+
+
+
+
+
+
+/*!
+ * Write a cluster in the iterator's pairwise data to a chunk of the data
+ * object.
+ *
+ * @param stream
+ * @param cluster
+ */
+void CCMatrix::Pair::writeCluster(QDataStream& stream, int cluster)
+{
+   EDEBUG_FUNC(this,&stream,cluster);
+
+   encodeCluster(stream, cluster);
+}
+
+
+
+
+
+
+/*!
+ * Read a cluster from a chunk of the data object into memory.
+ *
+ * @param stream
+ * @param cluster
+ */
+void CCMatrix::Pair::readCluster(QDataStream& stream, int cluster) const
+{
+   EDEBUG_FUNC(this,&stream,cluster);
+
+   decodeCluster(stream, cluster);
+}
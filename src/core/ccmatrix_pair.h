@@ -8,7 +8,9 @@
 /*!
  * This class implements the pairwise iterator for the cluster matrix data
  * object. This class extends the behavior of the base pairwise iterator to read
- * and write sample masks.
+ * and write sample masks. In the label format, the sample masks of a pair are
+ * encoded as a single label vector when they are written, and they are
+ * reconstructed from the label vector when they are read.
  */
 class CCMatrix::Pair : public Pairwise::Matrix::Pair
 {
@@ -32,8 +34,17 @@ public:
    const qint8& at(int cluster, int sample) const { return _sampleMasks.at(cluster).at(sample); }
    qint8& at(int cluster, int sample) { return _sampleMasks[cluster][sample]; }
 private:
+   virtual int recordSize() const override;
    virtual void writeCluster(EDataStream& stream, int cluster);
    virtual void readCluster(const EDataStream& stream, int cluster) const;
+   virtual void writeCluster(QDataStream& stream, int cluster);
+   virtual void readCluster(QDataStream& stream, int cluster) const;
+   template<class Stream> void encodeCluster(Stream& stream, int cluster);
+   template<class Stream> void decodeCluster(Stream& stream, int cluster) const;
+   qint8 encodeSample(int sample) const;
+   void decodeSample(int sample, qint8 code) const;
+   template<class Stream> void writeLabels(Stream& stream);
+   template<class Stream> void readLabels(Stream& stream) const;
    /*!
     * Array of sample masks for the current pair.
     */
@@ -10,6 +10,9 @@ CONFIG += staticlib
 # Build settings
 DESTDIR = $$PWD/../../build/libs/
 
+# Keep the SIMD kernels bit-for-bit identical across instruction sets
+QMAKE_CXXFLAGS += -ffp-contract=off
+
 # Source files
 SOURCES += \
    analyticfactory.cpp \
@@ -26,6 +29,8 @@ SOURCES += \
    exportexpressionmatrix.cpp \
    expressionmatrix_gene.cpp \
    expressionmatrix_model.cpp \
+   expressionmatrix_tilecache.cpp \
+   expressionmatrix_view.cpp \
    expressionmatrix.cpp \
    extract_input.cpp \
    extract.cpp \
@@ -34,13 +39,19 @@ SOURCES += \
    importexpressionmatrix_input.cpp \
    importexpressionmatrix.cpp \
    pairwise_correlationmodel.cpp \
+   pairwise_gmm_kernels.cpp \
    pairwise_gmm.cpp \
    pairwise_index.cpp \
    pairwise_linalg.cpp \
+   pairwise_matrix_cursor.cpp \
    pairwise_matrix_pair.cpp \
    pairwise_matrix.cpp \
    pairwise_pearson.cpp \
+   pairwise_samplemasks.cpp \
+   pairwise_simd.cpp \
    pairwise_spearman.cpp \
+   pairwise_tiledcorrelation.cpp \
+   pairwise_vbgmm.cpp \
    powerlaw_input.cpp \
    powerlaw.cpp \
    rmt_input.cpp \
@@ -62,7 +73,9 @@ SOURCES += \
    similarity_opencl.cpp \
    similarity_resultblock.cpp \
    similarity_serial.cpp \
+   similarity_threadpool.cpp \
    similarity_workblock.cpp \
+   similarity_writer.cpp \
    similarity.cpp
 
 # Header files
@@ -81,6 +94,8 @@ HEADERS += \
    exportexpressionmatrix.h \
    expressionmatrix_gene.h \
    expressionmatrix_model.h \
+   expressionmatrix_tilecache.h \
+   expressionmatrix_view.h \
    expressionmatrix.h \
    extract_input.h \
    extract.h \
@@ -90,13 +105,19 @@ HEADERS += \
    importexpressionmatrix.h \
    pairwise_clusteringmodel.h \
    pairwise_correlationmodel.h \
+   pairwise_gmm_kernels.h \
    pairwise_gmm.h \
    pairwise_index.h \
    pairwise_linalg.h \
+   pairwise_matrix_cursor.h \
    pairwise_matrix_pair.h \
    pairwise_matrix.h \
    pairwise_pearson.h \
+   pairwise_samplemasks.h \
+   pairwise_simd.h \
    pairwise_spearman.h \
+   pairwise_tiledcorrelation.h \
+   pairwise_vbgmm.h \
    powerlaw_input.h \
    powerlaw.h \
    rmt_input.h \
@@ -118,5 +139,7 @@ HEADERS += \
    similarity_opencl.h \
    similarity_resultblock.h \
    similarity_serial.h \
+   similarity_threadpool.h \
    similarity_workblock.h \
+   similarity_writer.h \
    similarity.h
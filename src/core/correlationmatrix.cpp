@@ -1,6 +1,9 @@
+#include <QtEndian>
+
 #include "correlationmatrix.h"
 #include "correlationmatrix_model.h"
 #include "correlationmatrix_pair.h"
+#include "pairwise_matrix_cursor.h"
 
 
 
@@ -65,36 +68,93 @@ QString CorrelationMatrix::correlationName() const
 
 
 /*!
- * Return a list of correlation pairs in raw form.
+ * Encode the correlations of a pair and append them to the given data in the
+ * record layout of this matrix, so that they can be written with
+ * Matrix::writeRecords(). Each correlation is a record which is stored as a
+ * little-endian float, as in the chunks of the data object.
+ *
+ * @param correlations
+ * @param clusterSize
+ * @param data
  */
-std::vector<CorrelationMatrix::RawPair> CorrelationMatrix::dumpRawData() const
+void CorrelationMatrix::encodePair(const float* correlations, qint8 clusterSize, std::vector<char>& data) const
 {
-   EDEBUG_FUNC(this);
+   for ( qint8 k = 0; k < clusterSize; ++k )
+   {
+      quint32 value;
+      memcpy(&value, &correlations[k], sizeof(value));
+      value = qToLittleEndian(value);
+
+      const char *bytes {reinterpret_cast<const char*>(&value)};
+      data.insert(data.end(), bytes, bytes + sizeof(value));
+   }
+}
 
-   // create list of raw pairs
-   std::vector<RawPair> pairs;
-   pairs.reserve(size());
 
-   // iterate through all pairs
-   Pair pair(this);
 
-   while ( pair.hasNext() )
+
+
+
+/*!
+ * Return the correlations of every pair in raw form. If the matrix is stored
+ * in the chunked layout, each pair is decoded directly from its chunk with a
+ * cursor; otherwise each pair is read with the pairwise iterator.
+ */
+CorrelationMatrix::RawData CorrelationMatrix::dumpRawData() const
+{
+   EDEBUG_FUNC(this);
+
+   // initialize raw data
+   RawData data;
+   data.pairs.reserve(size());
+
+   if ( isChunked() )
    {
-      // read in next pair
-      pair.readNext();
+      // iterate through all pairs with a cursor
+      Cursor cursor(this);
 
-      // copy pair to raw list
-      RawPair rawPair;
-      rawPair.index = pair.index();
-      rawPair.correlations.resize(pair.clusterSize());
+      while ( cursor.next() )
+      {
+         data.pairs.push_back({ cursor.index(), cursor.recordSize(), nullptr });
+
+         // decode each correlation from its little-endian record
+         for ( int k = 0; k < cursor.recordSize(); ++k )
+         {
+            const uchar* record {cursor.record(k)};
+            quint32 bits {record[0] | (record[1] << 8) | (record[2] << 16) | (static_cast<quint32>(record[3]) << 24)};
+            float correlation;
+
+            memcpy(&correlation, &bits, sizeof(float));
+            data.correlations.push_back(correlation);
+         }
+      }
+   }
+   else
+   {
+      // iterate through all pairs with the pairwise iterator
+      Pair pair(this);
 
-      for ( int k = 0; k < pair.clusterSize(); ++k )
+      while ( pair.hasNext() )
       {
-         rawPair.correlations[k] = pair.at(k);
+         pair.readNext();
+
+         data.pairs.push_back({ pair.index(), pair.clusterSize(), nullptr });
+
+         for ( int k = 0; k < pair.clusterSize(); ++k )
+         {
+            data.correlations.push_back(pair.at(k));
+         }
       }
-      
-      pairs.push_back(rawPair);
    }
 
-   return pairs;
+   // set the view of each pair into the array of correlations
+   const float* correlations {data.correlations.data()};
+
+   for ( auto& pair : data.pairs )
+   {
+      pair.correlations = correlations;
+      correlations += pair.clusterSize;
+   }
+
+   return data;
 }
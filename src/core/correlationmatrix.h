@@ -15,9 +15,42 @@ class CorrelationMatrix : public Pairwise::Matrix
 public:
    class Pair;
 public:
+   /*!
+    * Defines a read-only view of a pair in the raw data of a correlation
+    * matrix.
+    */
    struct RawPair
    {
+      /*!
+       * The pairwise index of the pair.
+       */
       Pairwise::Index index;
+      /*!
+       * The number of correlations of the pair.
+       */
+      int clusterSize;
+      /*!
+       * Pointer to the correlations of the pair.
+       */
+      const float* correlations;
+   };
+   /*!
+    * Defines the raw data of a correlation matrix, which stores the
+    * correlations of every pair in a single array. The raw data can be moved
+    * but not copied, since each pair refers to the array of correlations.
+    */
+   struct RawData
+   {
+      RawData() = default;
+      RawData(const RawData&) = delete;
+      RawData(RawData&&) = default;
+      /*!
+       * The view of each pair.
+       */
+      std::vector<RawPair> pairs;
+      /*!
+       * The correlations of every pair.
+       */
       std::vector<float> correlations;
    };
 public:
@@ -25,7 +58,8 @@ public:
 public:
    void initialize(const EMetaArray& geneNames, int maxClusterSize, const QString& correlationName);
    QString correlationName() const;
-   std::vector<RawPair> dumpRawData() const;
+   void encodePair(const float* correlations, qint8 clusterSize, std::vector<char>& data) const;
+   RawData dumpRawData() const;
 private:
    class Model;
 private:
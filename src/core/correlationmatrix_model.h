@@ -1,6 +1,7 @@
 #ifndef CORRELATIONMATRIX_MODEL_H
 #define CORRELATIONMATRIX_MODEL_H
 #include "correlationmatrix.h"
+#include "correlationmatrix_pair.h"
 
 
 
@@ -22,6 +23,11 @@ private:
     * Pointer to the data object for this table model.
     */
    CorrelationMatrix* _matrix;
+   /*!
+    * Pairwise iterator which is used to read each pair, so that adjacent
+    * cells can reuse the chunk which is stored by the iterator.
+    */
+   const Pair _pair;
 };
 
 
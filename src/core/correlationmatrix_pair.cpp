@@ -55,15 +55,15 @@ QString CorrelationMatrix::Pair::toString() const
 
 
 /*!
- * Write a cluster in the iterator's pairwise data to the data object file.
+ * Write a cluster in the iterator's pairwise data to a stream, which is either
+ * the data object file or a chunk of the data object.
  *
  * @param stream
  * @param cluster
  */
-void CorrelationMatrix::Pair::writeCluster(EDataStream& stream, int cluster)
+template<class Stream>
+void CorrelationMatrix::Pair::encodeCluster(Stream& stream, int cluster)
 {
-   EDEBUG_FUNC(this,&stream,cluster);
-
    // make sure cluster value is within range
    if ( cluster >= 0 && cluster < _correlations.size() )
    {
@@ -78,15 +78,15 @@ void CorrelationMatrix::Pair::writeCluster(EDataStream& stream, int cluster)
 
 
 /*!
- * Read a cluster from the data object file into memory.
+ * Read a cluster from a stream into memory, which is either the data object
+ * file or a chunk of the data object.
  *
  * @param stream
  * @param cluster
  */
-void CorrelationMatrix::Pair::readCluster(const EDataStream& stream, int cluster) const
+template<class Stream>
+void CorrelationMatrix::Pair::decodeCluster(Stream& stream, int cluster) const
 {
-   EDEBUG_FUNC(this,&stream,cluster);
-
    // make sure cluster value is within range
    if ( cluster >= 0 && cluster < _correlations.size() )
    {
@@ -94,3 +94,76 @@ void CorrelationMatrix::Pair::readCluster(const EDataStream& stream, int cluster
       stream >> _correlations[cluster];
    }
 }
+
+
+
+
+
+
+/*!
+ * Write a cluster in the iterator's pairwise data to the data object file.
+ *
+ * @param stream
+ * @param cluster
+ */
+void CorrelationMatrix::Pair::writeCluster(EDataStream& stream, int cluster)
+{
+   EDEBUG_FUNC(this,&stream,cluster);
+
+   encodeCluster(stream, cluster);
+}
+
+
+
+
+
+
+/*!
+ * Read a cluster from the data object file into memory.
+ *
+ * @param stream
+ * @param cluster
+ */
+void CorrelationMatrix::Pair::readCluster(const EDataStream& stream, int cluster) const
+{
+   EDEBUG_FUNC(this,&stream,cluster);
+
+   decodeCluster(stream, cluster);
+}
+
+
+
+
+
+
+/*!
+ * Write a cluster in the iterator's pairwise data to a chunk of the data
+ * object.
+ *
+ * @param stream
+ * @param cluster
+ */
+void CorrelationMatrix::Pair::writeCluster(QDataStream& stream, int cluster)
+{
+   EDEBUG_FUNC(this,&stream,cluster);
+
+   encodeCluster(stream, cluster);
+}
+
+
+
+
+
+
+/*!
+ * Read a cluster from a chunk of the data object into memory.
+ *
+ * @param stream
+ * @param cluster
+ */
+void CorrelationMatrix::Pair::readCluster(QDataStream& stream, int cluster) const
+{
+   EDEBUG_FUNC(this,&stream,cluster);
+
+   decodeCluster(stream, cluster);
+}
@@ -34,6 +34,10 @@ public:
 private:
    virtual void writeCluster(EDataStream& stream, int cluster);
    virtual void readCluster(const EDataStream& stream, int cluster) const;
+   virtual void writeCluster(QDataStream& stream, int cluster);
+   virtual void readCluster(QDataStream& stream, int cluster) const;
+   template<class Stream> void encodeCluster(Stream& stream, int cluster);
+   template<class Stream> void decodeCluster(Stream& stream, int cluster) const;
    /*!
     * Array of correlations for the current pair.
     */
@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 #include "expressionmatrix.h"
 #include "expressionmatrix_model.h"
+#include "expressionmatrix_view.h"
 //
 
 
@@ -12,7 +17,7 @@ qint64 ExpressionMatrix::dataEnd() const
 {
    EDEBUG_FUNC(this);
 
-   return _headerSize + static_cast<qint64>(_geneSize) * _sampleSize * sizeof(float);
+   return headerSize() + static_cast<qint64>(_geneSize) * geneBytes();
 }
 
 
@@ -32,6 +37,17 @@ void ExpressionMatrix::readData()
 
    // read the header
    stream() >> _geneSize >> _sampleSize;
+
+   // read the precision of a file with a reduced precision, whose sample
+   // size is negated
+   if ( _sampleSize < 0 )
+   {
+      qint8 precision;
+      stream() >> precision;
+
+      _sampleSize = -_sampleSize;
+      _precision = static_cast<Precision>(precision);
+   }
 }
 
 
@@ -49,11 +65,8 @@ void ExpressionMatrix::writeNewData()
    // initialize metadata object
    setMeta(EMetaObject());
 
-   // seek to the beginning of the data
-   seek(0);
-
    // write the header
-   stream() << _geneSize << _sampleSize;
+   writeHeader();
 }
 
 
@@ -69,11 +82,8 @@ void ExpressionMatrix::finish()
 {
    EDEBUG_FUNC(this);
 
-   // seek to the beginning of the data
-   seek(0);
-
    // write the header
-   stream() << _geneSize << _sampleSize;
+   writeHeader();
 }
 
 
@@ -176,13 +186,10 @@ std::vector<float> ExpressionMatrix::dumpRawData() const
    // allocate an array with the same size as the expression matrix
    std::vector<float> ret(static_cast<qint64>(_geneSize) * _sampleSize);
 
-   // seek to the beginning of the expression data
-   seekExpression(0,0);
-
-   // write each expression to the array
-   for ( float& sample: ret )
+   // write each gene to the array
+   for ( int i = 0; i < _geneSize; ++i )
    {
-      stream() >> sample;
+      readGene(i, &ret[static_cast<qint64>(i) * _sampleSize]);
    }
 
    // return the array
@@ -195,15 +202,65 @@ std::vector<float> ExpressionMatrix::dumpRawData() const
 
 
 /*!
- * Initialize this expression matrix with a list of gene names and a list of
- * sample names.
+ * Return a read-only view of this expression matrix's data in row-major
+ * order. The view is shared with every other owner of a view of this matrix,
+ * including the processes on the same node which read the same matrix, so
+ * that the expression data is only held in memory once per node. The view
+ * can be placed on a NUMA node, or interleaved across all NUMA nodes, as
+ * described by ExpressionMatrix::View.
+ *
+ * @param hugePages
+ * @param node
+ */
+std::shared_ptr<const ExpressionMatrix::View> ExpressionMatrix::mapRawData(bool hugePages, int node) const
+{
+   EDEBUG_FUNC(this,hugePages,node);
+
+   // return the current view of the node if it is still owned
+   std::shared_ptr<const View> view {_views.value(node).lock()};
+
+   // otherwise create a new view
+   if ( !view )
+   {
+      view = std::make_shared<const View>(this, hugePages, node);
+      _views.insert(node, view);
+   }
+
+   return view;
+}
+
+
+
+
+
+
+/*!
+ * Return the precision with which the expressions of this expression matrix
+ * are stored.
+ */
+ExpressionMatrix::Precision ExpressionMatrix::precision() const
+{
+   EDEBUG_FUNC(this);
+
+   return _precision;
+}
+
+
+
+
+
+
+/*!
+ * Initialize this expression matrix with a list of gene names, a list of
+ * sample names and the precision with which the expressions are stored.
  *
  * @param geneNames
  * @param sampleNames
+ * @param precision
  */
-void ExpressionMatrix::initialize(const QStringList& geneNames, const QStringList& sampleNames)
+void ExpressionMatrix::initialize(const QStringList& geneNames, const QStringList& sampleNames, Precision precision)
 {
-   EDEBUG_FUNC(this,&geneNames,&sampleNames);
+   EDEBUG_FUNC(this,&geneNames,&sampleNames,precision);
 
    // create a metadata array of gene names
    EMetaArray metaGeneNames;
@@ -228,6 +285,235 @@ void ExpressionMatrix::initialize(const QStringList& geneNames, const QStringLis
    // initialize the gene size and sample size accordingly
    _geneSize = geneNames.size();
    _sampleSize = sampleNames.size();
+   _precision = precision;
+}
+
+
+
+
+
+
+/*!
+ * Convert a float to a 16-bit IEEE half precision float, rounding to the
+ * nearest even value. Values whose magnitude is too large are converted to
+ * infinity.
+ *
+ * @param value
+ */
+quint16 ExpressionMatrix::toFloat16(float value)
+{
+   quint32 bits;
+   memcpy(&bits, &value, sizeof(bits));
+
+   quint32 sign {(bits >> 16) & 0x8000};
+   bits &= 0x7FFFFFFF;
+
+   // convert infinity and NAN, and values which overflow to infinity
+   if ( bits >= 0x47800000 )
+   {
+      return sign | ((bits > 0x7F800000) ? 0x7E00 : 0x7C00);
+   }
+
+   // convert subnormal values by adding 0.5, which aligns the bits of the
+   // half precision value to the end of the mantissa and rounds it
+   if ( bits < 0x38800000 )
+   {
+      float magnitude;
+      memcpy(&magnitude, &bits, sizeof(magnitude));
+      magnitude += 0.5f;
+      memcpy(&bits, &magnitude, sizeof(bits));
+
+      return sign | (bits - 0x3F000000);
+   }
+
+   // otherwise rebias the exponent and round the mantissa
+   bits += 0xC8000FFF + ((bits >> 13) & 1);
+
+   return sign | (bits >> 13);
+}
+
+
+
+
+
+
+/*!
+ * Convert a 16-bit IEEE half precision float to a float, which is exact.
+ *
+ * @param value
+ */
+float ExpressionMatrix::fromFloat16(quint16 value)
+{
+   quint32 sign {static_cast<quint32>(value & 0x8000) << 16};
+   quint32 exponent {(value >> 10) & 0x1Fu};
+   quint32 mantissa {value & 0x3FFu};
+   quint32 bits;
+
+   if ( exponent == 0x1F )
+   {
+      bits = sign | 0x7F800000 | (mantissa << 13);
+   }
+   else if ( exponent != 0 )
+   {
+      bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+   }
+   else
+   {
+      float magnitude {mantissa * (1.0f / (1 << 24))};
+      memcpy(&bits, &magnitude, sizeof(bits));
+      bits |= sign;
+   }
+
+   float result;
+   memcpy(&result, &bits, sizeof(result));
+
+   return result;
+}
+
+
+
+
+
+
+/*!
+ * Convert a float to a 16-bit brain float, rounding to the nearest even value.
+ *
+ * @param value
+ */
+quint16 ExpressionMatrix::toBFloat16(float value)
+{
+   quint32 bits;
+   memcpy(&bits, &value, sizeof(bits));
+
+   // keep NAN as a quiet NAN
+   if ( (bits & 0x7FFFFFFF) > 0x7F800000 )
+   {
+      return (bits >> 16) | 0x0040;
+   }
+
+   bits += 0x7FFF + ((bits >> 16) & 1);
+
+   return bits >> 16;
+}
+
+
+
+
+
+
+/*!
+ * Convert a 16-bit brain float to a float, which is exact.
+ *
+ * @param value
+ */
+float ExpressionMatrix::fromBFloat16(quint16 value)
+{
+   quint32 bits {static_cast<quint32>(value) << 16};
+   float result;
+
+   memcpy(&result, &bits, sizeof(result));
+
+   return result;
+}
+
+
+
+
+
+
+/*!
+ * Write the header of this expression matrix. If the expressions are stored
+ * with a reduced precision, the sample size is negated and followed by the
+ * precision, so that files with 32-bit expressions keep their original
+ * layout.
+ */
+void ExpressionMatrix::writeHeader()
+{
+   EDEBUG_FUNC(this);
+
+   seek(0);
+
+   if ( _precision == Precision::Float32 )
+   {
+      stream() << _geneSize << _sampleSize;
+   }
+   else
+   {
+      stream() << _geneSize << -_sampleSize << static_cast<qint8>(_precision);
+   }
+}
+
+
+
+
+
+
+/*!
+ * Return the size (in bytes) of the header of this expression matrix.
+ */
+qint64 ExpressionMatrix::headerSize() const
+{
+   EDEBUG_FUNC(this);
+
+   if ( _precision == Precision::Float32 )
+   {
+      return _headerSize;
+   }
+
+   return _extendedHeaderSize;
+}
+
+
+
+
+
+
+/*!
+ * Return the size (in bytes) of each gene of this expression matrix, which
+ * includes the offset and scale of a gene which is stored as integers.
+ */
+qint64 ExpressionMatrix::geneBytes() const
+{
+   EDEBUG_FUNC(this);
+
+   switch ( _precision )
+   {
+   case Precision::Float32: return static_cast<qint64>(_sampleSize) * sizeof(float);
+   case Precision::Float16:
+   case Precision::BFloat16: return static_cast<qint64>(_sampleSize) * sizeof(quint16);
+   case Precision::Int16: return _int16HeaderSize + static_cast<qint64>(_sampleSize) * sizeof(qint16);
+   }
+
+   return 0;
+}
+
+
+
+
+
+
+/*!
+ * Seek to the beginning of a gene in this expression matrix.
+ *
+ * @param gene
+ */
+void ExpressionMatrix::seekGene(int gene) const
+{
+   EDEBUG_FUNC(this,gene);
+
+   // make sure that the index is valid
+   if ( gene < 0 || gene >= _geneSize )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Invalid Argument"));
+      e.setDetails(tr("Invalid gene index %1 with size of %2.")
+                   .arg(gene)
+                   .arg(_geneSize));
+      throw e;
+   }
+
+   // seek to the specified gene in the data
+   seek(headerSize() + static_cast<qint64>(gene) * geneBytes());
 }
 
 
@@ -260,5 +546,239 @@ void ExpressionMatrix::seekExpression(int gene, int sample) const
    }
 
    // seek to the specified position in the data
-   seek(_headerSize + (static_cast<qint64>(gene) * _sampleSize + sample) * sizeof(float));
+   qint64 offset {headerSize() + static_cast<qint64>(gene) * geneBytes()};
+
+   if ( _precision == Precision::Float32 )
+   {
+      offset += static_cast<qint64>(sample) * sizeof(float);
+   }
+   else
+   {
+      offset += static_cast<qint64>(sample) * sizeof(quint16);
+   }
+
+   if ( _precision == Precision::Int16 )
+   {
+      offset += _int16HeaderSize;
+   }
+
+   seek(offset);
+}
+
+
+
+
+
+
+/*!
+ * Read a single expression of this expression matrix and widen it to a
+ * float.
+ *
+ * @param gene
+ * @param sample
+ */
+float ExpressionMatrix::readExpression(int gene, int sample) const
+{
+   EDEBUG_FUNC(this,gene,sample);
+
+   // read the offset and scale of a gene which is stored as integers
+   float offset {0};
+   float scale {0};
+
+   if ( _precision == Precision::Int16 )
+   {
+      seekGene(gene);
+      stream() >> offset >> scale;
+   }
+
+   // read the expression
+   seekExpression(gene, sample);
+
+   switch ( _precision )
+   {
+   case Precision::Float32:
+      {
+         float value;
+         stream() >> value;
+         return value;
+      }
+   case Precision::Float16:
+   case Precision::BFloat16:
+      {
+         quint16 value;
+         stream() >> value;
+         return (_precision == Precision::Float16) ? fromFloat16(value) : fromBFloat16(value);
+      }
+   case Precision::Int16:
+      {
+         qint16 value;
+         stream() >> value;
+         return (value == INT16_NAN) ? NAN : offset + value * scale;
+      }
+   }
+
+   return NAN;
+}
+
+
+
+
+
+
+/*!
+ * Read the expressions of a gene of this expression matrix into the given
+ * array, widening each expression to a float.
+ *
+ * @param gene
+ * @param expressions
+ */
+void ExpressionMatrix::readGene(int gene, float* expressions) const
+{
+   EDEBUG_FUNC(this,gene,expressions);
+
+   seekGene(gene);
+
+   switch ( _precision )
+   {
+   case Precision::Float32:
+      for ( int i = 0; i < _sampleSize; ++i )
+      {
+         stream() >> expressions[i];
+      }
+      break;
+   case Precision::Float16:
+      for ( int i = 0; i < _sampleSize; ++i )
+      {
+         quint16 value;
+         stream() >> value;
+         expressions[i] = fromFloat16(value);
+      }
+      break;
+   case Precision::BFloat16:
+      for ( int i = 0; i < _sampleSize; ++i )
+      {
+         quint16 value;
+         stream() >> value;
+         expressions[i] = fromBFloat16(value);
+      }
+      break;
+   case Precision::Int16:
+      {
+         float offset;
+         float scale;
+         stream() >> offset >> scale;
+
+         for ( int i = 0; i < _sampleSize; ++i )
+         {
+            qint16 value;
+            stream() >> value;
+            expressions[i] = (value == INT16_NAN) ? NAN : offset + value * scale;
+         }
+      }
+      break;
+   }
+}
+
+
+
+
+
+
+/*!
+ * Write the expressions of a gene of this expression matrix from the given
+ * array, narrowing each expression to the precision of this matrix. A gene
+ * which is stored as integers is mapped linearly from the range of its
+ * finite expressions to the integers from -INT16_LIMIT to INT16_LIMIT, and
+ * NAN is stored as INT16_NAN. An exception is thrown if an expression cannot
+ * be represented, which is an expression that overflows half precision or an
+ * infinite expression of a gene which is stored as integers.
+ *
+ * @param gene
+ * @param expressions
+ */
+void ExpressionMatrix::writeGene(int gene, const float* expressions)
+{
+   EDEBUG_FUNC(this,gene,expressions);
+
+   seekGene(gene);
+
+   switch ( _precision )
+   {
+   case Precision::Float32:
+      for ( int i = 0; i < _sampleSize; ++i )
+      {
+         stream() << expressions[i];
+      }
+      break;
+   case Precision::Float16:
+      for ( int i = 0; i < _sampleSize; ++i )
+      {
+         quint16 value {toFloat16(expressions[i])};
+
+         if ( std::isinf(fromFloat16(value)) && !std::isinf(expressions[i]) )
+         {
+            E_MAKE_EXCEPTION(e);
+            e.setTitle(tr("Domain Error"));
+            e.setDetails(tr("Expression %1 of gene %2 is too large for half precision.")
+                         .arg(expressions[i])
+                         .arg(gene));
+            throw e;
+         }
+
+         stream() << value;
+      }
+      break;
+   case Precision::BFloat16:
+      for ( int i = 0; i < _sampleSize; ++i )
+      {
+         stream() << toBFloat16(expressions[i]);
+      }
+      break;
+   case Precision::Int16:
+      {
+         // find the range of the finite expressions
+         float min {INFINITY};
+         float max {-INFINITY};
+
+         for ( int i = 0; i < _sampleSize; ++i )
+         {
+            if ( std::isinf(expressions[i]) )
+            {
+               E_MAKE_EXCEPTION(e);
+               e.setTitle(tr("Domain Error"));
+               e.setDetails(tr("Expression %1 of gene %2 cannot be stored as an integer.")
+                            .arg(expressions[i])
+                            .arg(gene));
+               throw e;
+            }
+
+            if ( !std::isnan(expressions[i]) )
+            {
+               min = std::min(min, expressions[i]);
+               max = std::max(max, expressions[i]);
+            }
+         }
+
+         // map the range to the integers around the midpoint
+         float offset {(min <= max) ? min + (max - min) / 2 : 0.0f};
+         float scale {(min < max) ? (max - min) / (2 * INT16_LIMIT) : 0.0f};
+
+         stream() << offset << scale;
+
+         for ( int i = 0; i < _sampleSize; ++i )
+         {
+            qint16 value {INT16_NAN};
+
+            if ( !std::isnan(expressions[i]) )
+            {
+               float step {(scale > 0) ? std::round((expressions[i] - offset) / scale) : 0.0f};
+
+               value = static_cast<qint16>(std::max(-static_cast<float>(INT16_LIMIT), std::min(step, static_cast<float>(INT16_LIMIT))));
+            }
+
+            stream() << value;
+         }
+      }
+      break;
+   }
 }
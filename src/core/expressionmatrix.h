@@ -1,5 +1,7 @@
 #ifndef EXPRESSIONMATRIX_H
 #define EXPRESSIONMATRIX_H
+#include <memory>
+
 #include <ace/core/core.h>
 //
 
@@ -9,13 +11,40 @@
  * This class implements the expression matrix data object. An expression matrix
  * is a matrix of real numbers whose rows represent genes and whose columns
  * represent samples. The matrix data can be accessed using the gene interator,
- * which iterates through each gene (row) in the matrix.
+ * which iterates through each gene (row) in the matrix. The expressions can be
+ * stored with a reduced precision, in which case they are widened to floats
+ * when they are read.
  */
 class ExpressionMatrix : public EAbstractData
 {
    Q_OBJECT
 public:
    class Gene;
+   class View;
+   class TileCache;
+   /*!
+    * Defines the precisions with which the expressions can be stored.
+    */
+   enum class Precision : qint8
+   {
+      /*!
+       * 32-bit IEEE floating point
+       */
+      Float32
+      /*!
+       * 16-bit IEEE half precision floating point
+       */
+      ,Float16
+      /*!
+       * 16-bit brain floating point, which has the exponent range of 32-bit
+       * floating point
+       */
+      ,BFloat16
+      /*!
+       * 16-bit integers with an offset and scale for each gene
+       */
+      ,Int16
+   };
 public:
    virtual qint64 dataEnd() const override final;
    virtual void readData() override final;
@@ -28,16 +57,49 @@ public:
    EMetaArray geneNames() const;
    EMetaArray sampleNames() const;
    std::vector<float> dumpRawData() const;
-   void initialize(const QStringList& geneNames, const QStringList& sampleNames);
+   std::shared_ptr<const View> mapRawData(bool hugePages = false, int node = -1) const;
+   Precision precision() const;
+   void initialize(const QStringList& geneNames, const QStringList& sampleNames, Precision precision = Precision::Float32);
 private:
    class Model;
 private:
+   static quint16 toFloat16(float value);
+   static float fromFloat16(quint16 value);
+   static quint16 toBFloat16(float value);
+   static float fromBFloat16(quint16 value);
+   void writeHeader();
+   qint64 headerSize() const;
+   qint64 geneBytes() const;
+   void seekGene(int gene) const;
    void seekExpression(int gene, int sample) const;
+   float readExpression(int gene, int sample) const;
+   void readGene(int gene, float* expressions) const;
+   void writeGene(int gene, const float* expressions);
    /*!
     * The header size (in bytes) at the beginning of the file. The header
     * consists of the gene size and the sample size.
     */
    constexpr static const qint64 _headerSize {8};
+   /*!
+    * The header size (in bytes) at the beginning of a file whose expressions
+    * are stored with a reduced precision. The sample size is stored negated
+    * and followed by the precision.
+    */
+   constexpr static const qint64 _extendedHeaderSize {9};
+   /*!
+    * The size (in bytes) of the offset and scale at the beginning of each gene
+    * which is stored as 16-bit integers.
+    */
+   constexpr static const qint64 _int16HeaderSize {8};
+   /*!
+    * The 16-bit integer which represents NAN.
+    */
+   constexpr static const qint16 INT16_NAN {-32768};
+   /*!
+    * The largest 16-bit integer which represents an expression. Expressions
+    * are mapped to the integers from -INT16_LIMIT to INT16_LIMIT.
+    */
+   constexpr static const qint16 INT16_LIMIT {32767};
    /*!
     * The number of genes (rows) in the expression matrix.
     */
@@ -46,10 +108,20 @@ private:
     * The number of samples (columns) in the expression matrix.
     */
    qint32 _sampleSize;
+   /*!
+    * The precision with which the expressions are stored.
+    */
+   Precision _precision {Precision::Float32};
    /*!
     * Pointer to a qt table model for this class.
     */
    Model* _model {nullptr};
+   /*!
+    * The views of the expression data which were returned by mapRawData()
+    * for each NUMA node, which are shared until every owner has released
+    * them.
+    */
+   mutable QMap<int,std::weak_ptr<const View>> _views;
 };
 
 
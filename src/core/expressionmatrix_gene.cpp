@@ -92,14 +92,8 @@ void ExpressionMatrix::Gene::read(int index)
       throw e;
    }
 
-   // seek to the beginning of the specified row in the data object file
-   _matrix->seekExpression(index,0);
-
    // read the entire row into memory
-   for ( int i = 0; i < _matrix->sampleSize(); ++i )
-   {
-      _matrix->stream() >> _expressions[i];
-   }
+   _matrix->readGene(index, _expressions);
 
    // set the iterator's current index
    _index = index;
@@ -155,14 +149,8 @@ void ExpressionMatrix::Gene::write(int index)
       throw e;
    }
 
-   // seek to the beginning of the specified row in the data object file
-   _matrix->seekExpression(index,0);
-
    // write the entire row to the data object
-   for ( int i = 0; i < _matrix->sampleSize(); ++i )
-   {
-      _matrix->stream() << _expressions[i];
-   }
+   _matrix->writeGene(index, _expressions);
 
    // set the iterator's current index
    _index = index;
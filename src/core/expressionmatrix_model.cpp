@@ -142,9 +142,7 @@ QVariant ExpressionMatrix::Model::data(const QModelIndex& index, int role) const
    }
 
    // get the specified value from the expression matrix
-   float value;
-   _matrix->seekExpression(index.row(),index.column());
-   _matrix->stream() >> value;
+   float value {_matrix->readExpression(index.row(),index.column())};
 
    // return the specified value
    return value;
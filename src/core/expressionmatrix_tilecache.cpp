@@ -0,0 +1,458 @@
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "expressionmatrix_tilecache.h"
+//
+
+
+
+using namespace std;
+
+
+
+
+
+
+/*!
+ * Construct a new tile cache for an expression matrix with the given memory
+ * limit in bytes and start its I/O thread. The number of genes in each tile is
+ * given by selectTileSize(), and the capacity of the cache is the number of
+ * tiles which fit in the memory limit.
+ *
+ * @param matrix
+ * @param memoryLimit
+ */
+ExpressionMatrix::TileCache::TileCache(const ExpressionMatrix* matrix, qint64 memoryLimit):
+   _matrix(matrix)
+{
+   EDEBUG_FUNC(this,matrix,memoryLimit);
+
+   _tileSize = selectTileSize(matrix);
+   _tileBytes = _tileSize * (max(1, matrix->_sampleSize) * static_cast<qint64>(sizeof(float)));
+   _tiles.resize((matrix->_geneSize + _tileSize - 1) / _tileSize);
+   _capacity = min(memoryLimit / _tileBytes, static_cast<qint64>(_tiles.size()));
+
+   // make sure that at least one tile fits in the memory limit
+   if ( !_tiles.empty() && _capacity < 1 )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Invalid Argument"));
+      e.setDetails(tr("The memory limit of %1 bytes is smaller than a tile of %2 bytes.")
+                   .arg(memoryLimit)
+                   .arg(_tileBytes));
+      throw e;
+   }
+
+   // reserve address space for the entire matrix without committing memory
+   _length = _tiles.size() * _tileBytes;
+
+   if ( _length > 0 )
+   {
+      void* address {mmap(nullptr, _length, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)};
+
+      if ( address == MAP_FAILED )
+      {
+         E_MAKE_EXCEPTION(e);
+         e.setTitle(tr("Memory Error"));
+         e.setDetails(tr("Failed to reserve %1 bytes of address space for the expression data.").arg(_length));
+         throw e;
+      }
+
+      _address = static_cast<char*>(address);
+      _data = reinterpret_cast<const float*>(_address);
+   }
+
+   _thread = std::thread(&TileCache::loop, this);
+}
+
+
+
+
+
+
+/*!
+ * Stop and join the I/O thread and release the reserved address space.
+ */
+ExpressionMatrix::TileCache::~TileCache()
+{
+   EDEBUG_FUNC(this);
+
+   {
+      lock_guard<mutex> lock(_mutex);
+      _stop = true;
+   }
+
+   _requested.notify_all();
+   _thread.join();
+
+   if ( _address )
+   {
+      munmap(_address, _length);
+   }
+}
+
+
+
+
+
+
+/*!
+ * Return the number of genes in each tile of a tile cache for an expression
+ * matrix, which is the smallest multiple of the number of genes which span a
+ * whole number of pages that is at least TILE_BYTES in size, but no larger
+ * than needed for the genes of the matrix.
+ *
+ * @param matrix
+ */
+int ExpressionMatrix::TileCache::selectTileSize(const ExpressionMatrix* matrix)
+{
+   // determine the smallest number of genes which span a whole number of
+   // pages
+   qint64 pageSize {sysconf(_SC_PAGESIZE)};
+   qint64 geneBytes {max(1, matrix->_sampleSize) * static_cast<qint64>(sizeof(float))};
+   qint64 a {geneBytes};
+   qint64 b {pageSize};
+
+   while ( b != 0 )
+   {
+      qint64 r {a % b};
+      a = b;
+      b = r;
+   }
+
+   qint64 unit {pageSize / a};
+
+   // determine the tile size, which does not need to exceed the number of
+   // genes
+   qint64 tileSize {unit * max(1LL, TILE_BYTES / (unit * geneBytes))};
+   qint64 geneUnits {(max(1, matrix->_geneSize) + unit - 1) / unit};
+
+   return min(tileSize, geneUnits * unit);
+}
+
+
+
+
+
+
+/*!
+ * Replace the tiles which should be read ahead with the given tiles, which
+ * are read in the given order whenever no tile is needed by a caller.
+ *
+ * @param tiles
+ */
+void ExpressionMatrix::TileCache::prefetch(const std::vector<int>& tiles)
+{
+   EDEBUG_FUNC(this,&tiles);
+
+   {
+      lock_guard<mutex> lock(_mutex);
+      _ahead.assign(tiles.begin(), tiles.end());
+   }
+
+   _requested.notify_one();
+}
+
+
+
+
+
+
+/*!
+ * Acquire a tile, which is read by the I/O thread first if it is not
+ * resident. The tile cannot be evicted until it is released. Any exception
+ * which was thrown by the I/O thread is rethrown here.
+ *
+ * @param tile
+ */
+void ExpressionMatrix::TileCache::acquire(int tile)
+{
+   unique_lock<mutex> lock(_mutex);
+   Tile& state {_tiles[tile]};
+
+   if ( state.state == State::Resident )
+   {
+      ++_statistics.hits;
+
+      if ( state.pins == 0 )
+      {
+         _evictable.erase(state.position);
+      }
+   }
+   else
+   {
+      ++_statistics.misses;
+
+      if ( state.state == State::Absent )
+      {
+         _demand.push_back(tile);
+         _requested.notify_one();
+      }
+   }
+
+   ++state.pins;
+   state.ahead = false;
+
+   // wait for the tile to be read
+   _loaded.wait(lock, [this, &state] { return state.state == State::Resident || _exception; });
+
+   if ( _exception )
+   {
+      --state.pins;
+      rethrow_exception(_exception);
+   }
+}
+
+
+
+
+
+
+/*!
+ * Release a tile which was acquired. Once a tile is released by every caller
+ * it becomes the most recently used evictable tile.
+ *
+ * @param tile
+ */
+void ExpressionMatrix::TileCache::release(int tile)
+{
+   {
+      lock_guard<mutex> lock(_mutex);
+      Tile& state {_tiles[tile]};
+
+      if ( --state.pins > 0 )
+      {
+         return;
+      }
+
+      state.position = _evictable.insert(_evictable.end(), tile);
+   }
+
+   _requested.notify_one();
+}
+
+
+
+
+
+
+/*!
+ * Return the access statistics since they were last taken and reset them.
+ */
+ExpressionMatrix::TileCache::Statistics ExpressionMatrix::TileCache::takeStatistics()
+{
+   EDEBUG_FUNC(this);
+
+   lock_guard<mutex> lock(_mutex);
+   Statistics statistics {_statistics};
+
+   _statistics = Statistics();
+
+   return statistics;
+}
+
+
+
+
+
+
+/*!
+ * Read each requested tile until the cache is stopped. Tiles which are needed
+ * by a caller are read before tiles which should be read ahead. If the cache
+ * is full, the least recently used evictable tile is evicted first; a tile
+ * which is read ahead only evicts tiles which have been used, and it waits
+ * otherwise. This function is the main loop of the I/O thread.
+ */
+void ExpressionMatrix::TileCache::loop()
+{
+   while ( true )
+   {
+      // wait for a tile to read and a slot for it
+      unique_lock<mutex> lock(_mutex);
+      int tile {-1};
+      int victim {-1};
+      bool ahead {false};
+
+      _requested.wait(lock, [&]
+      {
+         if ( _stop )
+         {
+            return true;
+         }
+
+         // drop the requests for tiles which are no longer absent
+         while ( !_demand.empty() && _tiles[_demand.front()].state != State::Absent )
+         {
+            _demand.pop_front();
+         }
+
+         while ( !_ahead.empty() && _tiles[_ahead.front()].state != State::Absent )
+         {
+            _ahead.pop_front();
+         }
+
+         ahead = _demand.empty();
+
+         if ( ahead && _ahead.empty() )
+         {
+            return false;
+         }
+
+         tile = ahead ? _ahead.front() : _demand.front();
+         victim = (_resident < _capacity) ? -1 : selectVictim(ahead);
+
+         return _resident < _capacity || victim >= 0;
+      });
+
+      if ( _stop )
+      {
+         return;
+      }
+
+      (ahead ? _ahead : _demand).pop_front();
+
+      // evict the victim, which is absent as soon as it leaves the list of
+      // evictable tiles
+      if ( victim >= 0 )
+      {
+         _evictable.erase(_tiles[victim].position);
+         _tiles[victim].state = State::Absent;
+         --_resident;
+         ++_statistics.evictions;
+      }
+
+      Tile& state {_tiles[tile]};
+
+      state.state = State::Loading;
+      state.ahead = ahead;
+      ++_resident;
+
+      lock.unlock();
+
+      // release the memory of the victim and read the tile
+      try
+      {
+         if ( victim >= 0 )
+         {
+            evict(victim);
+         }
+
+         load(tile);
+      }
+      catch ( ... )
+      {
+         lock.lock();
+
+         if ( !_exception )
+         {
+            _exception = current_exception();
+         }
+
+         state.state = State::Absent;
+         --_resident;
+
+         lock.unlock();
+         _loaded.notify_all();
+         continue;
+      }
+
+      // make the tile resident
+      lock.lock();
+
+      state.state = State::Resident;
+      ++_statistics.reads;
+
+      if ( state.pins == 0 )
+      {
+         state.position = _evictable.insert(_evictable.end(), tile);
+      }
+
+      lock.unlock();
+      _loaded.notify_all();
+   }
+}
+
+
+
+
+
+
+/*!
+ * Return the least recently used evictable tile, or -1 if there is none. If
+ * the tile is needed for read-ahead, tiles which were read ahead and have not
+ * been used are skipped.
+ *
+ * @param ahead
+ */
+int ExpressionMatrix::TileCache::selectVictim(bool ahead) const
+{
+   for ( int tile : _evictable )
+   {
+      if ( !ahead || !_tiles[tile].ahead )
+      {
+         return tile;
+      }
+   }
+
+   return -1;
+}
+
+
+
+
+
+
+/*!
+ * Read the genes of a tile into its place in the reserved address space and
+ * protect them from writes.
+ *
+ * @param tile
+ */
+void ExpressionMatrix::TileCache::load(int tile)
+{
+   EDEBUG_FUNC(this,tile);
+
+   char* address {_address + tile * _tileBytes};
+
+   if ( mprotect(address, _tileBytes, PROT_READ | PROT_WRITE) != 0 )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Memory Error"));
+      e.setDetails(tr("Failed to map %1 bytes for tile %2 of the expression data.")
+                   .arg(_tileBytes)
+                   .arg(tile));
+      throw e;
+   }
+
+   int start {tile * _tileSize};
+   int end {min(start + _tileSize, _matrix->_geneSize)};
+   float* expressions {reinterpret_cast<float*>(address)};
+
+   for ( int i = start; i < end; ++i )
+   {
+      _matrix->readGene(i, &expressions[static_cast<qint64>(i - start) * _matrix->_sampleSize]);
+   }
+
+   mprotect(address, _tileBytes, PROT_READ);
+}
+
+
+
+
+
+
+/*!
+ * Release the memory of a tile and make its address range inaccessible, so
+ * that a read of an evicted tile faults instead of returning stale data.
+ *
+ * @param tile
+ */
+void ExpressionMatrix::TileCache::evict(int tile)
+{
+   EDEBUG_FUNC(this,tile);
+
+   char* address {_address + tile * _tileBytes};
+
+   madvise(address, _tileBytes, MADV_DONTNEED);
+   mprotect(address, _tileBytes, PROT_NONE);
+}
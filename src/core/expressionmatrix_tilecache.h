@@ -0,0 +1,226 @@
+#ifndef EXPRESSIONMATRIX_TILECACHE_H
+#define EXPRESSIONMATRIX_TILECACHE_H
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <list>
+#include <mutex>
+#include <thread>
+
+#include "expressionmatrix.h"
+//
+
+
+
+/*!
+ * This class implements an out-of-core cache of the expression data of an
+ * expression matrix, for expression matrices which do not fit in memory. The
+ * genes are divided into tiles of consecutive genes, and at most a fixed
+ * number of tiles, which is determined by a memory limit, are resident at
+ * once. The cache reserves address space for the entire matrix without
+ * committing any memory, and each tile is mapped at its place in the matrix
+ * when it is loaded, so the expressions of a resident gene are found at the
+ * same offset from data() as in the full matrix. Tiles are read from the
+ * expression matrix on a dedicated I/O thread, which reads tiles that are
+ * needed by a caller before the tiles that are given as read-ahead. A tile
+ * must be acquired before its expressions are read and released afterwards,
+ * and the least recently used tile which is not acquired is evicted when the
+ * cache is full. Read-ahead never evicts a tile which was read ahead and has
+ * not been used yet.
+ */
+class ExpressionMatrix::TileCache
+{
+public:
+   /*!
+    * Defines the access statistics of the cache.
+    */
+   struct Statistics
+   {
+      /*!
+       * The number of acquired tiles which were already resident.
+       */
+      qint64 hits {0};
+      /*!
+       * The number of acquired tiles which had to be read first.
+       */
+      qint64 misses {0};
+      /*!
+       * The number of tiles which were read from the expression matrix.
+       */
+      qint64 reads {0};
+      /*!
+       * The number of tiles which were evicted.
+       */
+      qint64 evictions {0};
+   };
+public:
+   TileCache(const ExpressionMatrix* matrix, qint64 memoryLimit);
+   ~TileCache();
+   TileCache(const TileCache&) = delete;
+   TileCache& operator=(const TileCache&) = delete;
+public:
+   static int selectTileSize(const ExpressionMatrix* matrix);
+   /*!
+    * Return a pointer to the expression data, which is only valid for the
+    * genes of acquired tiles.
+    */
+   const float* data() const { return _data; }
+   /*!
+    * Return the number of genes in each tile.
+    */
+   int tileSize() const { return _tileSize; }
+   /*!
+    * Return the number of tiles.
+    */
+   int size() const { return _tiles.size(); }
+   /*!
+    * Return the maximum number of resident tiles.
+    */
+   int capacity() const { return _capacity; }
+   /*!
+    * Return the tile which contains a gene.
+    *
+    * @param gene
+    */
+   int tile(int gene) const { return gene / _tileSize; }
+   void prefetch(const std::vector<int>& tiles);
+   void acquire(int tile);
+   void release(int tile);
+   Statistics takeStatistics();
+private:
+   /*!
+    * Defines the load state of a tile.
+    */
+   enum class State
+   {
+      /*!
+       * The tile is not in memory.
+       */
+      Absent
+      /*!
+       * The tile is being read by the I/O thread.
+       */
+      ,Loading
+      /*!
+       * The tile is in memory.
+       */
+      ,Resident
+   };
+   /*!
+    * Defines the state of a tile in the cache.
+    */
+   struct Tile
+   {
+      /*!
+       * The load state of the tile.
+       */
+      State state {State::Absent};
+      /*!
+       * The number of callers which have acquired the tile.
+       */
+      int pins {0};
+      /*!
+       * Whether the tile was read ahead and has not been acquired since.
+       */
+      bool ahead {false};
+      /*!
+       * The position of the tile in the list of evictable tiles, which is
+       * only valid if the tile is resident and not acquired.
+       */
+      std::list<int>::iterator position;
+   };
+   void loop();
+   int selectVictim(bool ahead) const;
+   void load(int tile);
+   void evict(int tile);
+private:
+   /*!
+    * The size in bytes at which the tile size is chosen, unless a single page
+    * aligned group of genes is larger.
+    */
+   constexpr static qint64 TILE_BYTES {1LL << 22};
+   /*!
+    * Pointer to the expression matrix from which tiles are read.
+    */
+   const ExpressionMatrix* _matrix;
+   /*!
+    * The number of genes in each tile, which is chosen so that each tile
+    * starts on a page boundary.
+    */
+   int _tileSize {0};
+   /*!
+    * The size in bytes of each tile.
+    */
+   qint64 _tileBytes {0};
+   /*!
+    * The maximum number of resident tiles.
+    */
+   int _capacity {0};
+   /*!
+    * The address of the reserved address space.
+    */
+   char* _address {nullptr};
+   /*!
+    * The length in bytes of the reserved address space.
+    */
+   qint64 _length {0};
+   /*!
+    * Pointer to the expression data within the reserved address space.
+    */
+   const float* _data {nullptr};
+   /*!
+    * The state of each tile.
+    */
+   std::vector<Tile> _tiles;
+   /*!
+    * The number of tiles which are resident or being read.
+    */
+   int _resident {0};
+   /*!
+    * The tiles which are resident and not acquired, from least to most
+    * recently used.
+    */
+   std::list<int> _evictable;
+   /*!
+    * The tiles which are needed by a caller, in the order they were
+    * requested.
+    */
+   std::deque<int> _demand;
+   /*!
+    * The tiles which should be read ahead, in the order they will be needed.
+    */
+   std::deque<int> _ahead;
+   /*!
+    * The access statistics since they were last taken.
+    */
+   Statistics _statistics;
+   /*!
+    * The I/O thread.
+    */
+   std::thread _thread;
+   /*!
+    * Mutex which protects the state of the cache.
+    */
+   mutable std::mutex _mutex;
+   /*!
+    * Condition which is signaled when a tile is requested, a tile becomes
+    * evictable or the cache is stopped.
+    */
+   std::condition_variable _requested;
+   /*!
+    * Condition which is signaled when a tile has been read.
+    */
+   std::condition_variable _loaded;
+   /*!
+    * Whether the I/O thread should exit.
+    */
+   bool _stop {false};
+   /*!
+    * The first exception which was thrown by the I/O thread.
+    */
+   std::exception_ptr _exception;
+};
+
+
+
+#endif
@@ -0,0 +1,605 @@
+#include <cerrno>
+#include <fcntl.h>
+#include <numa.h>
+#include <numaif.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+
+#include "expressionmatrix_view.h"
+//
+
+
+
+
+
+
+/*!
+ * Construct a view of the expression data of an expression matrix. The view
+ * maps the shared memory segment of the matrix if another process on this
+ * node has already created it, otherwise it creates the segment and loads the
+ * expression data into it. Stale segments which were left behind by processes
+ * that exited without unmapping them are removed first. If the creator of an
+ * existing segment has exited without loading it, the segment is removed and
+ * created again. If shared
+ * memory cannot be used, the expression data is loaded into a private mapping
+ * instead, which uses huge pages if requested and available. The pages of the
+ * view are placed on the given NUMA node, or interleaved across all nodes,
+ * before the expression data is loaded.
+ *
+ * @param matrix
+ * @param hugePages
+ * @param node
+ */
+ExpressionMatrix::View::View(const ExpressionMatrix* matrix, bool hugePages, int node):
+   _size(static_cast<qint64>(matrix->_geneSize) * matrix->_sampleSize),
+   _pageSize(sysconf(_SC_PAGESIZE)),
+   _node(numa_available() >= 0 ? node : ANY_NODE)
+{
+   EDEBUG_FUNC(this,matrix,hugePages,node);
+
+   // return an empty view if the expression matrix is empty
+   if ( _size == 0 )
+   {
+      return;
+   }
+
+   // create or attach to the shared memory segment of the expression matrix
+   removeStale();
+
+   _name = key(matrix, _node);
+
+   for ( int attempt = 0; attempt < 2 && !_address; ++attempt )
+   {
+      int fd = shm_open(_name.constData(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+      if ( fd >= 0 )
+      {
+         create(fd, matrix, hugePages);
+         break;
+      }
+
+      if ( errno != EEXIST || attach() )
+      {
+         break;
+      }
+   }
+
+   // otherwise load the expression data into a private mapping
+   if ( !_address )
+   {
+      allocate(matrix, hugePages);
+   }
+
+   // find the NUMA node of each gene
+   locate(matrix->_geneSize, matrix->_sampleSize);
+}
+
+
+
+
+
+
+/*!
+ * Unmap this view. The shared memory segment is removed if no other process
+ * has it mapped.
+ */
+ExpressionMatrix::View::~View()
+{
+   EDEBUG_FUNC(this);
+
+   if ( !_address )
+   {
+      return;
+   }
+
+   if ( _shared && header()->references.fetch_sub(1) == 1 )
+   {
+      shm_unlink(_name.constData());
+   }
+
+   munmap(_address, _length);
+}
+
+
+
+
+
+
+/*!
+ * Remove the shared memory segments of this user which were left behind by
+ * processes that crashed or were killed, since such a segment is as large as
+ * its expression matrix. A segment is stale if its creator no longer exists
+ * and no process has it mapped, which is found from the memory maps of the
+ * processes on this node.
+ */
+void ExpressionMatrix::View::removeStale()
+{
+   QString prefix {QString("kinc-emx-%1-").arg(getuid())};
+   QStringList entries {QDir(SHM_DIRECTORY).entryList({ prefix + "*" }, QDir::Files | QDir::System)};
+
+   for ( const QString& entry : entries )
+   {
+      QByteArray name {("/" + entry).toLatin1()};
+      int fd = shm_open(name.constData(), O_RDONLY, 0);
+
+      if ( fd < 0 )
+      {
+         continue;
+      }
+
+      // read the creator from the header page if the segment has one
+      struct stat status;
+      void* address {MAP_FAILED};
+
+      if ( fstat(fd, &status) == 0 && status.st_size >= static_cast<qint64>(sizeof(Header)) )
+      {
+         address = mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0);
+      }
+
+      close(fd);
+
+      if ( address == MAP_FAILED )
+      {
+         continue;
+      }
+
+      qint64 creator {static_cast<const Header*>(address)->creator.load()};
+
+      munmap(address, sizeof(Header));
+
+      // remove the segment if its creator has exited and nobody maps it
+      if ( creator != 0
+         && kill(static_cast<pid_t>(creator), 0) != 0 && errno == ESRCH
+         && !isMapped(entry) )
+      {
+         shm_unlink(name.constData());
+      }
+   }
+}
+
+
+
+
+
+
+/*!
+ * Return whether any process on this node has the shared memory segment with
+ * the given file name mapped.
+ *
+ * @param entry
+ */
+bool ExpressionMatrix::View::isMapped(const QString& entry)
+{
+   QByteArray path {(SHM_DIRECTORY + QString("/") + entry).toLatin1()};
+
+   for ( const QString& pid : QDir("/proc").entryList(QDir::Dirs | QDir::NoDotAndDotDot) )
+   {
+      QFile maps(QString("/proc/%1/maps").arg(pid));
+
+      if ( pid.toInt() > 0 && maps.open(QIODevice::ReadOnly) && maps.readAll().contains(path) )
+      {
+         return true;
+      }
+   }
+
+   return false;
+}
+
+
+
+
+
+
+/*!
+ * Return the name of the shared memory segment of an expression matrix. The
+ * name is unique to the user and to a hash of the shape, gene names, sample
+ * names and every expression of the matrix, so that processes which read the
+ * same expression matrix share one segment and a matrix whose data has
+ * changed never maps the segment of its previous data. Hashing the data takes
+ * one read of the matrix in each process, which is cheap next to loading a
+ * private copy since the file is in the page cache after the first read.
+ * Views which are placed on a NUMA node or interleaved have their own
+ * segment.
+ *
+ * @param matrix
+ * @param node
+ */
+QByteArray ExpressionMatrix::View::key(const ExpressionMatrix* matrix, int node)
+{
+   QCryptographicHash hash(QCryptographicHash::Sha1);
+
+   // hash the shape of the matrix
+   hash.addData(reinterpret_cast<const char*>(&matrix->_geneSize), sizeof(qint32));
+   hash.addData(reinterpret_cast<const char*>(&matrix->_sampleSize), sizeof(qint32));
+
+   // hash the gene names and sample names
+   for ( const EMetaArray& names : { matrix->geneNames(), matrix->sampleNames() } )
+   {
+      for ( int i = 0; i < names.size(); ++i )
+      {
+         hash.addData(names.at(i).toString().toUtf8());
+         hash.addData("\n", 1);
+      }
+   }
+
+   // hash the expressions of every gene
+   std::vector<float> expressions(matrix->_sampleSize);
+
+   for ( int gene = 0; gene < matrix->_geneSize; ++gene )
+   {
+      matrix->readGene(gene, expressions.data());
+
+      hash.addData(reinterpret_cast<const char*>(expressions.data()), expressions.size() * sizeof(float));
+   }
+
+   QString name {QString("/kinc-emx-%1-%2")
+      .arg(getuid())
+      .arg(QString(hash.result().toHex()))};
+
+   if ( node == ALL_NODES )
+   {
+      name += "-all";
+   }
+   else if ( node != ANY_NODE )
+   {
+      name += QString("-n%1").arg(node);
+   }
+
+   return name.toLatin1();
+}
+
+
+
+
+
+
+/*!
+ * Create the shared memory segment of this view from the given descriptor of
+ * a new segment and load the expression data into it. Returns false if the
+ * segment could not be mapped, in which case it is removed. If loading fails,
+ * the segment is marked as failed and removed before the exception is
+ * rethrown.
+ *
+ * @param fd
+ * @param matrix
+ * @param hugePages
+ */
+bool ExpressionMatrix::View::create(int fd, const ExpressionMatrix* matrix, bool hugePages)
+{
+   EDEBUG_FUNC(this,fd,matrix,hugePages);
+
+   // resize and map the segment
+   qint64 length {sharedLength()};
+   void* address {MAP_FAILED};
+
+   if ( ftruncate(fd, length) == 0 )
+   {
+      address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   }
+
+   close(fd);
+
+   if ( address == MAP_FAILED )
+   {
+      shm_unlink(_name.constData());
+      return false;
+   }
+
+   _address = address;
+   _length = length;
+   _shared = true;
+
+   header()->creator.store(getpid());
+   header()->references.fetch_add(1);
+
+   // load the expression data after the header page
+   char* data {static_cast<char*>(_address) + _pageSize};
+
+   if ( hugePages )
+   {
+      madvise(data, _length - _pageSize, MADV_HUGEPAGE);
+   }
+
+   place(data, _length - _pageSize);
+
+   try
+   {
+      load(matrix, reinterpret_cast<float*>(data));
+   }
+   catch ( ... )
+   {
+      header()->state.store(static_cast<qint32>(State::Failed));
+      header()->references.fetch_sub(1);
+      shm_unlink(_name.constData());
+      munmap(_address, _length);
+      _address = nullptr;
+      throw;
+   }
+
+   // publish the expression data as read-only
+   mprotect(data, _length - _pageSize, PROT_READ);
+
+   _data = reinterpret_cast<const float*>(data);
+   header()->state.store(static_cast<qint32>(State::Ready));
+
+   return true;
+}
+
+
+
+
+
+
+/*!
+ * Attach to the existing shared memory segment of this view and wait until
+ * its creator has loaded the expression data. Returns false if the segment
+ * does not exist, if it could not be mapped, or if its creator has failed or
+ * exited without loading it, in which case the segment is removed so that it
+ * can be created again.
+ */
+bool ExpressionMatrix::View::attach()
+{
+   EDEBUG_FUNC(this);
+
+   int fd = shm_open(_name.constData(), O_RDWR, 0);
+
+   if ( fd < 0 )
+   {
+      return false;
+   }
+
+   // wait until the creator has resized the segment
+   qint64 length {sharedLength()};
+   QElapsedTimer timer;
+   struct stat status;
+
+   timer.start();
+
+   while ( fstat(fd, &status) == 0 && status.st_size != length && timer.elapsed() < START_TIMEOUT )
+   {
+      QThread::msleep(POLL_INTERVAL);
+   }
+
+   void* address {MAP_FAILED};
+
+   if ( status.st_size == length )
+   {
+      address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   }
+
+   close(fd);
+
+   if ( address == MAP_FAILED )
+   {
+      return false;
+   }
+
+   _address = address;
+   _length = length;
+   _shared = true;
+
+   header()->references.fetch_add(1);
+
+   // wait until the creator has loaded the expression data
+   while ( header()->state.load() == static_cast<qint32>(State::Loading) )
+   {
+      qint64 creator {header()->creator.load()};
+
+      if ( (creator == 0 && timer.elapsed() >= START_TIMEOUT)
+         || (creator != 0 && kill(static_cast<pid_t>(creator), 0) != 0 && errno == ESRCH) )
+      {
+         header()->state.store(static_cast<qint32>(State::Failed));
+         shm_unlink(_name.constData());
+         break;
+      }
+
+      QThread::msleep(POLL_INTERVAL);
+   }
+
+   if ( header()->state.load() != static_cast<qint32>(State::Ready) )
+   {
+      header()->references.fetch_sub(1);
+      munmap(_address, _length);
+
+      _address = nullptr;
+      _length = 0;
+      _shared = false;
+      return false;
+   }
+
+   // protect the expression data from writes by this process
+   char* data {static_cast<char*>(_address) + _pageSize};
+
+   mprotect(data, _length - _pageSize, PROT_READ);
+
+   _data = reinterpret_cast<const float*>(data);
+
+   return true;
+}
+
+
+
+
+
+
+/*!
+ * Load the expression data into a private anonymous mapping. If huge pages
+ * are requested, the mapping is first made from the reserved huge pages of
+ * the system, and otherwise transparent huge pages are requested for it.
+ *
+ * @param matrix
+ * @param hugePages
+ */
+void ExpressionMatrix::View::allocate(const ExpressionMatrix* matrix, bool hugePages)
+{
+   EDEBUG_FUNC(this,matrix,hugePages);
+
+   qint64 bytes {_size * static_cast<qint64>(sizeof(float))};
+   void* address {MAP_FAILED};
+
+   // try to map reserved huge pages
+   if ( hugePages )
+   {
+      _length = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+      address = mmap(nullptr, _length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+   }
+
+   // otherwise map regular pages
+   if ( address == MAP_FAILED )
+   {
+      _length = (bytes + _pageSize - 1) / _pageSize * _pageSize;
+      address = mmap(nullptr, _length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+      if ( address != MAP_FAILED && hugePages )
+      {
+         madvise(address, _length, MADV_HUGEPAGE);
+      }
+   }
+
+   if ( address == MAP_FAILED )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Memory Error"));
+      e.setDetails(tr("Failed to allocate %1 bytes for the expression data.").arg(bytes));
+      throw e;
+   }
+
+   _address = address;
+
+   place(_address, _length);
+
+   // load the expression data and protect it from writes
+   try
+   {
+      load(matrix, static_cast<float*>(_address));
+   }
+   catch ( ... )
+   {
+      munmap(_address, _length);
+      _address = nullptr;
+      throw;
+   }
+
+   mprotect(_address, _length, PROT_READ);
+
+   _data = static_cast<const float*>(_address);
+}
+
+
+
+
+
+
+/*!
+ * Read the expression data of an expression matrix into the given array.
+ *
+ * @param matrix
+ * @param data
+ */
+void ExpressionMatrix::View::load(const ExpressionMatrix* matrix, float* data) const
+{
+   EDEBUG_FUNC(this,matrix,data);
+
+   for ( int i = 0; i < matrix->_geneSize; ++i )
+   {
+      matrix->readGene(i, &data[static_cast<qint64>(i) * matrix->_sampleSize]);
+   }
+}
+
+
+
+
+
+
+/*!
+ * Return the length in bytes of the shared memory segment of this view, which
+ * consists of the header page followed by the expression data rounded up to a
+ * whole number of pages.
+ */
+qint64 ExpressionMatrix::View::sharedLength() const
+{
+   qint64 bytes {_size * static_cast<qint64>(sizeof(float))};
+
+   return _pageSize + (bytes + _pageSize - 1) / _pageSize * _pageSize;
+}
+
+
+
+
+
+
+/*!
+ * Set the NUMA policy of a range of this view's pages according to its node,
+ * so that the pages are allocated on that node, or interleaved across all
+ * nodes, when the expression data is loaded.
+ *
+ * @param address
+ * @param length
+ */
+void ExpressionMatrix::View::place(void* address, qint64 length) const
+{
+   EDEBUG_FUNC(this,address,length);
+
+   if ( _node == ALL_NODES )
+   {
+      numa_interleave_memory(address, length, numa_all_nodes_ptr);
+   }
+   else if ( _node != ANY_NODE )
+   {
+      numa_tonode_memory(address, length, _node);
+   }
+}
+
+
+
+
+
+
+/*!
+ * Find the NUMA node of the page on which the expressions of each gene start.
+ * The first expression of each gene is read so that its page is mapped into
+ * this process before the node of the page is queried.
+ *
+ * @param geneSize
+ * @param sampleSize
+ */
+void ExpressionMatrix::View::locate(int geneSize, int sampleSize)
+{
+   EDEBUG_FUNC(this,geneSize,sampleSize);
+
+   if ( !_data || numa_available() < 0 )
+   {
+      return;
+   }
+
+   std::vector<void*> pages(geneSize);
+   std::vector<int> status(geneSize);
+   volatile float sum {0};
+
+   for ( int i = 0; i < geneSize; ++i )
+   {
+      const float* gene {_data + static_cast<qint64>(i) * sampleSize};
+
+      sum += *gene;
+      pages[i] = reinterpret_cast<void*>(reinterpret_cast<quintptr>(gene) & ~static_cast<quintptr>(_pageSize - 1));
+   }
+
+   if ( numa_move_pages(0, geneSize, pages.data(), nullptr, status.data(), 0) != 0 )
+   {
+      return;
+   }
+
+   _nodes.resize(geneSize);
+
+   for ( int i = 0; i < geneSize; ++i )
+   {
+      _nodes[i] = (status[i] >= 0) ? status[i] : -1;
+   }
+}
@@ -0,0 +1,174 @@
+#ifndef EXPRESSIONMATRIX_VIEW_H
+#define EXPRESSIONMATRIX_VIEW_H
+#include <atomic>
+
+#include "expressionmatrix.h"
+//
+
+
+
+/*!
+ * This class implements a read-only view of the expression data of an
+ * expression matrix in row-major order. The data is loaded once per node into
+ * a POSIX shared memory segment, which is mapped by every process that views
+ * the same expression matrix, so that the MPI ranks on a node share a single
+ * copy instead of each holding its own. The segment is named after the user
+ * and a hash of the shape, names and expressions of the matrix, and it is
+ * removed by the last process that unmaps it, or by a later view if every
+ * process which mapped it has exited without unmapping it. If shared memory
+ * is not available, the view falls back to a private anonymous mapping. In
+ * both cases the data starts on a page boundary and is mapped read-only once
+ * it has been loaded. A view can also be placed on a single NUMA node, in which
+ * case each node has its own segment, or interleaved across all NUMA nodes.
+ */
+class ExpressionMatrix::View
+{
+public:
+   /*!
+    * The node of a view which is placed by the default policy of the system.
+    */
+   constexpr static int ANY_NODE {-1};
+   /*!
+    * The node of a view which is interleaved across all NUMA nodes.
+    */
+   constexpr static int ALL_NODES {-2};
+public:
+   View(const ExpressionMatrix* matrix, bool hugePages = false, int node = ANY_NODE);
+   ~View();
+   View(const View&) = delete;
+   View& operator=(const View&) = delete;
+public:
+   /*!
+    * Return a pointer to the expression data.
+    */
+   const float* data() const { return _data; }
+   /*!
+    * Return the number of expressions in the view.
+    */
+   qint64 size() const { return _size; }
+   /*!
+    * Return whether the view is mapped from a shared memory segment.
+    */
+   bool isShared() const { return _shared; }
+   /*!
+    * Return the NUMA node on which the expressions of a gene start, or -1 if
+    * it is not known.
+    *
+    * @param gene
+    */
+   int node(int gene) const { return _nodes.empty() ? -1 : _nodes[gene]; }
+private:
+   /*!
+    * Defines the load state of a shared memory segment. A new segment is
+    * filled with zeros, so it starts in the loading state.
+    */
+   enum class State : qint32
+   {
+      /*!
+       * The creator of the segment is loading the expression data.
+       */
+      Loading
+      /*!
+       * The expression data is loaded and can be read.
+       */
+      ,Ready
+      /*!
+       * The creator of the segment failed to load the expression data.
+       */
+      ,Failed
+   };
+   /*!
+    * Defines the header page at the beginning of a shared memory segment.
+    */
+   struct Header
+   {
+      /*!
+       * The load state of the segment.
+       */
+      std::atomic<qint32> state;
+      /*!
+       * The number of processes which have mapped the segment.
+       */
+      std::atomic<qint32> references;
+      /*!
+       * The process ID of the creator of the segment, which is zero until
+       * the creator has mapped the segment.
+       */
+      std::atomic<qint64> creator;
+   };
+   /*!
+    * Return the header of the shared memory segment.
+    */
+   Header* header() const { return reinterpret_cast<Header*>(_address); }
+   static void removeStale();
+   static bool isMapped(const QString& entry);
+   static QByteArray key(const ExpressionMatrix* matrix, int node);
+   bool create(int fd, const ExpressionMatrix* matrix, bool hugePages);
+   bool attach();
+   void allocate(const ExpressionMatrix* matrix, bool hugePages);
+   void load(const ExpressionMatrix* matrix, float* data) const;
+   void place(void* address, qint64 length) const;
+   void locate(int geneSize, int sampleSize);
+   qint64 sharedLength() const;
+   /*!
+    * The directory in which the shared memory segments of this node appear
+    * as files.
+    */
+   constexpr static const char* SHM_DIRECTORY {"/dev/shm"};
+   /*!
+    * The size in bytes of a huge page, to which private mappings with huge
+    * pages are aligned.
+    */
+   constexpr static qint64 HUGE_PAGE_SIZE {1LL << 21};
+   /*!
+    * The time in milliseconds to wait for the creator of a shared memory
+    * segment to map it before the segment is considered abandoned.
+    */
+   constexpr static int START_TIMEOUT {10000};
+   /*!
+    * The time in milliseconds between checks of the state of a shared memory
+    * segment which is being loaded by another process.
+    */
+   constexpr static int POLL_INTERVAL {10};
+   /*!
+    * The number of expressions in the view.
+    */
+   qint64 _size {0};
+   /*!
+    * The page size of the system.
+    */
+   qint64 _pageSize {0};
+   /*!
+    * The NUMA node on which the view is placed.
+    */
+   int _node {ANY_NODE};
+   /*!
+    * The name of the shared memory segment.
+    */
+   QByteArray _name;
+   /*!
+    * Whether the view is mapped from a shared memory segment.
+    */
+   bool _shared {false};
+   /*!
+    * The address of the mapping, or null if nothing is mapped.
+    */
+   void* _address {nullptr};
+   /*!
+    * The length in bytes of the mapping.
+    */
+   qint64 _length {0};
+   /*!
+    * Pointer to the expression data within the mapping.
+    */
+   const float* _data {nullptr};
+   /*!
+    * The NUMA node on which the expressions of each gene start, which is
+    * empty if NUMA is not available.
+    */
+   std::vector<qint8> _nodes;
+};
+
+
+
+#endif
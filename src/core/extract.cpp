@@ -1,7 +1,6 @@
 #include "extract.h"
 #include "extract_input.h"
 #include "datafactory.h"
-#include "expressionmatrix_gene.h"
 
 
 
@@ -153,17 +152,13 @@ void Extract::writeTextFormat(int index)
       // otherwise use expression data
       else
       {
-         // read in gene expressions
-         ExpressionMatrix::Gene gene1(_emx);
-         ExpressionMatrix::Gene gene2(_emx);
+         // determine sample mask, summary statistics from the missing masks of each gene
+         const quint64 *missing_x = _masks.missing(_cmxPair.index().getX());
+         const quint64 *missing_y = _masks.missing(_cmxPair.index().getY());
 
-         gene1.read(_cmxPair.index().getX());
-         gene2.read(_cmxPair.index().getY());
-
-         // determine sample mask, summary statistics from expression data
          for ( int i = 0; i < _emx->sampleSize(); ++i )
          {
-            if ( isnan(gene1.at(i)) || isnan(gene2.at(i)) )
+            if ( ((missing_x[i / 64] | missing_y[i / 64]) >> (i % 64)) & 1 )
             {
                sampleMask[i] = '9';
                numMissing++;
@@ -342,17 +337,13 @@ void Extract::writeGraphMLFormat(int index)
       // otherwise use expression data
       else
       {
-         // read in gene expressions
-         ExpressionMatrix::Gene gene1(_emx);
-         ExpressionMatrix::Gene gene2(_emx);
-
-         gene1.read(_cmxPair.index().getX());
-         gene2.read(_cmxPair.index().getY());
+         // determine sample mask from the missing masks of each gene
+         const quint64 *missing_x = _masks.missing(_cmxPair.index().getX());
+         const quint64 *missing_y = _masks.missing(_cmxPair.index().getY());
 
-         // determine sample mask from expression data
          for ( int i = 0; i < _emx->sampleSize(); ++i )
          {
-            if ( isnan(gene1.at(i)) || isnan(gene2.at(i)) )
+            if ( ((missing_x[i / 64] | missing_y[i / 64]) >> (i % 64)) & 1 )
             {
                sampleMask[i] = '9';
             }
@@ -431,6 +422,9 @@ void Extract::initialize()
    _ccmPair = CCMatrix::Pair(_ccm);
    _cmxPair = CorrelationMatrix::Pair(_cmx);
 
+   // initialize sample masks of each gene
+   _masks = Pairwise::SampleMasks(_emx->dumpRawData().data(), _emx->geneSize(), _emx->sampleSize());
+
    // initialize output file stream
    _stream.setDevice(_output);
    _stream.setRealNumberPrecision(8);
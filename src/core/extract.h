@@ -7,6 +7,7 @@
 #include "correlationmatrix_pair.h"
 #include "correlationmatrix.h"
 #include "expressionmatrix.h"
+#include "pairwise_samplemasks.h"
 
 
 
@@ -56,6 +57,10 @@ private:
    QTextStream _stream;
    CCMatrix::Pair _ccmPair;
    CorrelationMatrix::Pair _cmxPair;
+   /*!
+    * The missing sample masks of each gene in the input expression matrix.
+    */
+   Pairwise::SampleMasks _masks;
    /*!
     * Pointer to the input expression matrix.
     */
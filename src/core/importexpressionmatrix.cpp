@@ -151,7 +151,7 @@ void ImportExpressionMatrix::process(const EAbstractAnalyticBlock* result)
    else if ( result->index() == _numLines )
    {
       // initialize expression matrix
-      _output->initialize(_geneNames, _sampleNames);
+      _output->initialize(_geneNames, _sampleNames, _precision);
 
       // iterate through each gene
       ExpressionMatrix::Gene gene(_output);
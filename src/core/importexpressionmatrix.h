@@ -13,7 +13,8 @@
  * containing the row names and column names, respectively. Elements which have
  * the given NAN token are read in as NAN. If the sample names are not in the
  * input file, the user must provide the number of samples to the analytic, and
- * the samples will be given integer names.
+ * the samples will be given integer names. The expressions can be stored with a
+ * reduced precision to halve the size of the output expression matrix.
  */
 class ImportExpressionMatrix : public EAbstractAnalytic
 {
@@ -62,6 +63,10 @@ private:
     * The number of samples to read.
     */
    qint32 _sampleSize {0};
+   /*!
+    * The precision with which the output expression matrix stores expressions.
+    */
+   ExpressionMatrix::Precision _precision {ExpressionMatrix::Precision::Float32};
 };
 
 
@@ -6,6 +6,24 @@
 
 
 
+/*!
+ * String list of storage precisions for this analytic that correspond exactly
+ * to the precision enumeration of the expression matrix. Used for handling the
+ * precision argument for this input object.
+ */
+const QStringList ImportExpressionMatrix::Input::PRECISION_NAMES
+{
+   "float32"
+   ,"float16"
+   ,"bfloat16"
+   ,"int16"
+};
+
+
+
+
+
+
 /*!
  * Construct a new input object with the given analytic as its parent.
  *
@@ -53,6 +71,7 @@ EAbstractAnalyticInput::Type ImportExpressionMatrix::Input::type(int index) cons
    case OutputData: return Type::DataOut;
    case NANToken: return Type::String;
    case SampleSize: return Type::Integer;
+   case PrecisionType: return Type::Selection;
    default: return Type::Boolean;
    }
 }
@@ -112,6 +131,16 @@ QVariant ImportExpressionMatrix::Input::data(int index, Role role) const
       case Role::Maximum: return std::numeric_limits<int>::max();
       default: return QVariant();
       }
+   case PrecisionType:
+      switch (role)
+      {
+      case Role::CommandLineName: return QString("precision");
+      case Role::Title: return tr("Precision:");
+      case Role::WhatsThis: return tr("Precision with which expressions are stored. Reduced precisions halve the size of the expression matrix at the cost of a small error in each expression.");
+      case Role::SelectionValues: return PRECISION_NAMES;
+      case Role::Default: return "float32";
+      default: return QVariant();
+      }
    default: return QVariant();
    }
 }
@@ -139,6 +168,9 @@ void ImportExpressionMatrix::Input::set(int index, const QVariant& value)
    case NANToken:
       _base->_nanToken = value.toString();
       break;
+   case PrecisionType:
+      _base->_precision = static_cast<ExpressionMatrix::Precision>(PRECISION_NAMES.indexOf(value.toString()));
+      break;
    }
 }
 
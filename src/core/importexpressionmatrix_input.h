@@ -20,6 +20,7 @@ public:
       ,OutputData
       ,NANToken
       ,SampleSize
+      ,PrecisionType
       ,Total
    };
    explicit Input(ImportExpressionMatrix* parent);
@@ -30,6 +31,7 @@ public:
    virtual void set(int index, QFile* file) override final;
    virtual void set(int index, EAbstractData* data) override final;
 private:
+   static const QStringList PRECISION_NAMES;
    /*!
     * Pointer to the base analytic for this object.
     */
@@ -27,6 +27,29 @@ namespace Pairwise
       ,ICL
    };
 
+   /*!
+    * Defines the strategies used by a clustering model to select the number of
+    * clusters from several sub-models.
+    */
+   enum class Selection
+   {
+      /*!
+       * Fit every sub-model
+       */
+      Full
+      /*!
+       * Abandon a sub-model when an extrapolation of its log-likelihood
+       * suggests that it cannot have the best criterion value, which is a
+       * heuristic that can change the selected sub-model
+       */
+      ,Extrapolate
+      /*!
+       * Abandon sub-models as in Extrapolate, and stop at the first sub-model
+       * which does not improve the criterion value
+       */
+      ,First
+   };
+
    /*!
     * This class implements the abstract pairwise clustering model, which takes
     * a pairwise data array and determines the number of clusters, as well as the
@@ -36,10 +59,10 @@ namespace Pairwise
    class ClusteringModel
    {
    public:
-      ~ClusteringModel() = default;
+      virtual ~ClusteringModel() = default;
    public:
       virtual qint8 compute(
-         const std::vector<float>& expressions,
+         const float *expressions,
          const Index& index,
          int numSamples,
          QVector<qint8>& labels,
@@ -10,29 +10,31 @@ using namespace Pairwise;
 
 
 /*!
- * Compute the correlation of each cluster in a pairwise data array.
+ * Compute the correlation of each cluster in a pairwise data array and save
+ * the correlations to the given array.
  *
  * @param expressions
  * @param index
  * @param K
  * @param labels
+ * @param N
  * @param minSamples
+ * @param correlations
  */
-QVector<float> CorrelationModel::compute(
-   const std::vector<float>& expressions,
+void CorrelationModel::compute(
+   const float *expressions,
    const Index& index,
    int K,
-   const QVector<qint8>& labels,
-   int minSamples)
+   const qint8 *labels,
+   int N,
+   int minSamples,
+   float *correlations)
 {
-   const float *x = &expressions[index.getX() * labels.size()];
-   const float *y = &expressions[index.getY() * labels.size()];
-   QVector<float> correlations(K);
+   const float *x = &expressions[static_cast<qint64>(index.getX()) * N];
+   const float *y = &expressions[static_cast<qint64>(index.getY()) * N];
 
    for ( qint8 k = 0; k < K; ++k )
    {
-      correlations[k] = computeCluster(x, y, labels, k, minSamples);
+      correlations[k] = computeCluster(x, y, labels, N, k, minSamples);
    }
-
-   return correlations;
 }
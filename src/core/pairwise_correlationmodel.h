@@ -10,25 +10,30 @@ namespace Pairwise
     * This class implements the abstract pairwise correlation model, which
     * takes a pairwise data array (with cluster labels) and computes a correlation
     * for each cluster in the data. The correlation metric must be implemented by
-    * the inheriting class.
+    * the inheriting class. The labels and correlations of a pair are given as
+    * arrays which are owned by the caller, so that no allocation is made for
+    * each pair.
     */
    class CorrelationModel
    {
    public:
-      ~CorrelationModel() = default;
+      virtual ~CorrelationModel() = default;
    public:
-      QVector<float> compute(
-         const std::vector<float>& expressions,
+      virtual void compute(
+         const float *expressions,
          const Index& index,
          int K,
-         const QVector<qint8>& labels,
-         int minSamples
+         const qint8 *labels,
+         int N,
+         int minSamples,
+         float *correlations
       );
    protected:
       virtual float computeCluster(
          const float *x,
          const float *y,
-         const QVector<qint8>& labels,
+         const qint8 *labels,
+         int N,
          qint8 cluster,
          int minSamples
       ) = 0;
@@ -1,4 +1,5 @@
 #include "pairwise_gmm.h"
+#include "pairwise_gmm_kernels.h"
 
 
 
@@ -25,18 +26,29 @@ int myrand(unsigned long *state)
 
 
 /*!
- * Construct a Gaussian mixture model.
+ * Construct a Gaussian mixture model which uses the SIMD kernels of the given
+ * instruction set and the given model selection strategy.
  *
  * @param emx
  * @param maxClusters
+ * @param level
+ * @param selection
  */
-GMM::GMM(ExpressionMatrix* emx, qint8 maxClusters)
+GMM::GMM(ExpressionMatrix* emx, qint8 maxClusters, SimdLevel level, Selection selection):
+   _kernels(Kernels::get(level)),
+   _selection(selection)
 {
    // pre-allocate workspace
-   _data.resize(emx->sampleSize());
+   const int stride = Kernels::stride(emx->sampleSize());
+
+   _x.resize(stride);
+   _y.resize(stride);
+   _logpx.resize(stride);
    _labels.resize(emx->sampleSize());
    _components.reserve(maxClusters);
-   _gamma = new float[maxClusters * emx->sampleSize()];
+   _gamma = new float[maxClusters * stride];
+   _iterations.resize(MAX_ITERATIONS + 1);
+   _skipped.resize(maxClusters + 1);
 }
 
 
@@ -57,6 +69,21 @@ GMM::~GMM()
 
 
 
+/*!
+ * Reset the histograms of the number of EM iterations and the number of
+ * skipped sub-models.
+ */
+void GMM::resetIterations()
+{
+   _iterations.fill(0);
+   _skipped.fill(0);
+}
+
+
+
+
+
+
 /*!
  * Initialize a mixture component with the given mixture weight and mean.
  *
@@ -90,7 +117,7 @@ bool GMM::Component::prepare()
    matrixInverse(_sigma, _sigmaInv, &det);
 
    // compute normalizer term for multivariate normal distribution
-   _normalizer = -0.5f * (D * logf(2.0f * M_PI) + logf(det));
+   _normalizer = -0.5f * (D * logf(2.0f * M_PI) + simdLog(det));
 
    // return failure if matrix inverse failed
    return !(det <= 0);
@@ -111,28 +138,82 @@ bool GMM::Component::prepare()
  *
  *   log(P(x|k)) = -0.5 * (x - mu)^T Sigma^-1 (x - mu) - 0.5 * (d * log(2pi) + log(det(Sigma)))
  *
- * @param X
+ * @param kernels
+ * @param x
+ * @param y
  * @param N
  * @param logP
  */
-void GMM::Component::computeLogProbNorm(const QVector<Vector2>& X, int N, float *logP)
+void GMM::Component::computeLogProbNorm(const Kernels& kernels, const float *x, const float *y, int N, float *logP)
+{
+   kernels.logProbNorm(x, y, N, _mu, _sigmaInv, _normalizer, logP);
+}
+
+
+
+
+
+
+/*!
+ * Select a sample as the mean of a new component with the k-means++ rule:
+ * each sample is selected with a probability proportional to its squared
+ * distance from the nearest mean of the first K components. The selection
+ * only depends on the given random state, so it is reproducible.
+ *
+ * @param x
+ * @param y
+ * @param N
+ * @param K
+ * @param state
+ */
+int GMM::sampleMean(const float *x, const float *y, int N, int K, unsigned long *state)
 {
+   // compute the squared distance of a sample from the nearest mean
+   auto distance = [this, x, y, K] (int i)
+   {
+      float min_dist = INFINITY;
+
+      for ( int k = 0; k < K; ++k )
+      {
+         float dx = x[i] - _components[k]._mu.s[0];
+         float dy = y[i] - _components[k]._mu.s[1];
+
+         min_dist = fmin(min_dist, dx * dx + dy * dy);
+      }
+
+      return min_dist;
+   };
+
+   // compute the sum of the squared distances
+   float total = 0;
+
    for ( int i = 0; i < N; ++i )
    {
-      // compute xm = (x - mu)
-      Vector2 xm = X[i];
-      vectorSubtract(xm, _mu);
+      total += distance(i);
+   }
 
-      // compute Sxm = Sigma^-1 xm
-      Vector2 Sxm;
-      matrixProduct(_sigmaInv, xm, Sxm);
+   // select a random sample if every sample coincides with a mean
+   if ( !(total > 0) )
+   {
+      return myrand(state) % N;
+   }
+
+   // select a random point along the cumulative sum of the distances
+   float u = total * myrand(state) / 32768.0f;
 
-      // compute xmSxm = xm^T Sigma^-1 xm
-      float xmSxm = vectorDot(xm, Sxm);
+   float sum = 0;
+
+   for ( int i = 0; i < N; ++i )
+   {
+      sum += distance(i);
 
-      // compute log(P) = normalizer - 0.5 * xm^T * Sigma^-1 * xm
-      logP[i] = _normalizer - 0.5f * xmSxm;
+      if ( u < sum )
+      {
+         return i;
+      }
    }
+
+   return N - 1;
 }
 
 
@@ -141,19 +222,21 @@ void GMM::Component::computeLogProbNorm(const QVector<Vector2>& X, int N, float
 
 
 /*!
- * Initialize the mean of each component in the mixture model using k-means
- * clustering.
+ * Refine the mean of each component in the mixture model using k-means
+ * clustering. A component which is not nearest to any sample keeps its
+ * mean.
  *
- * @param X
+ * @param x
+ * @param y
  * @param N
  */
-void GMM::initializeMeans(const QVector<Vector2>& X, int N)
+void GMM::initializeMeans(const float *x, const float *y, int N)
 {
    const int K = _components.size();
 
    const int MAX_ITERATIONS = 20;
    const float TOLERANCE = 1e-3f;
-   float diff = 0;
+   float diff = INFINITY;
 
    // initialize workspace
    Vector2 Mu[K];
@@ -167,12 +250,14 @@ void GMM::initializeMeans(const QVector<Vector2>& X, int N)
 
       for ( int i = 0; i < N; ++i )
       {
+         const Vector2 x_i = {{ x[i], y[i] }};
+
          // determine the component mean which is nearest to x_i
          float min_dist = INFINITY;
          int min_k = 0;
          for ( int k = 0; k < K; ++k )
          {
-            float dist = vectorDiffNorm(X[i], _components[k]._mu);
+            float dist = vectorDiffNorm(x_i, _components[k]._mu);
             if ( min_dist > dist )
             {
                min_dist = dist;
@@ -181,14 +266,21 @@ void GMM::initializeMeans(const QVector<Vector2>& X, int N)
          }
 
          // update mean and sample count
-         vectorAdd(Mu[min_k], X[i]);
+         vectorAdd(Mu[min_k], x_i);
          ++counts[min_k];
       }
 
       // scale each mean by its sample count
       for ( int k = 0; k < K; ++k )
       {
-         vectorScale(Mu[k], 1.0f / counts[k]);
+         if ( counts[k] > 0 )
+         {
+            vectorScale(Mu[k], 1.0f / counts[k]);
+         }
+         else
+         {
+            Mu[k] = _components[k]._mu;
+         }
       }
 
       // compute the total change of all means
@@ -223,19 +315,24 @@ void GMM::initializeMeans(const QVector<Vector2>& X, int N)
  *
  *   log(L) = sum(log(p(x_i)))
  *
- * @param X
+ * The log-probabilities and gamma are computed by the SIMD kernels, while the
+ * log-likelihood is summed in sample order.
+ *
+ * @param x
+ * @param y
  * @param N
  */
-float GMM::computeEStep(const QVector<Vector2>& X, int N)
+float GMM::computeEStep(const float *x, const float *y, int N)
 {
    const int K = _components.size();
+   const int stride = Kernels::stride(N);
 
    // compute logpi
    float logpi[K];
 
    for ( int k = 0; k < K; ++k )
    {
-      logpi[k] = logf(_components[k]._pi);
+      logpi[k] = simdLog(_components[k]._pi);
    }
 
    // compute the log-probability for each component and each point in X
@@ -243,43 +340,18 @@ float GMM::computeEStep(const QVector<Vector2>& X, int N)
 
    for ( int k = 0; k < K; ++k )
    {
-      _components[k].computeLogProbNorm(X, N, &logProb[k * N]);
+      _components[k].computeLogProbNorm(_kernels, x, y, N, &logProb[k * stride]);
    }
 
-   // compute gamma and log-likelihood
+   // compute gamma and logpx
+   _kernels.responsibilities(_gamma, stride, logpi, K, N, _logpx.data());
+
+   // compute log-likelihood
    float logL = 0;
 
    for ( int i = 0; i < N; ++i )
    {
-      // compute a = argmax(logpi_k + logProb_ki, k)
-      float maxArg = -INFINITY;
-      for ( int k = 0; k < K; ++k )
-      {
-         float arg = logpi[k] + logProb[k * N + i];
-         if ( maxArg < arg )
-         {
-            maxArg = arg;
-         }
-      }
-
-      // compute logpx
-      float sum = 0;
-      for ( int k = 0; k < K; ++k )
-      {
-         sum += expf(logpi[k] + logProb[k * N + i] - maxArg);
-      }
-
-      float logpx = maxArg + logf(sum);
-
-      // compute gamma_ki
-      for ( int k = 0; k < K; ++k )
-      {
-         _gamma[k * N + i] += logpi[k] - logpx;
-         _gamma[k * N + i] = expf(_gamma[k * N + i]);
-      }
-
-      // update log-likelihood
-      logL += logpx;
+      logL += _logpx[i];
    }
 
    // return log-likelihood
@@ -304,22 +376,26 @@ float GMM::computeEStep(const QVector<Vector2>& X, int N)
  *
  *   Sigma_k = sum(gamma_ki * (x_i - mu_k) * (x_i - mu_k)^T) / n_k
  *
- * @param X
+ * The sums over samples are computed by the SIMD kernels.
+ *
+ * @param x
+ * @param y
  * @param N
  */
-void GMM::computeMStep(const QVector<Vector2>& X, int N)
+void GMM::computeMStep(const float *x, const float *y, int N)
 {
    const int K = _components.size();
+   const int stride = Kernels::stride(N);
 
    for ( int k = 0; k < K; ++k )
    {
-      // compute n_k = sum(gamma_ki)
-      float n_k = 0;
+      const float *gamma = &_gamma[k * stride];
 
-      for ( int i = 0; i < N; ++i )
-      {
-         n_k += _gamma[k * N + i];
-      }
+      // compute n_k = sum(gamma_ki) and sum(gamma_ki * x_i)
+      float sums[3];
+      _kernels.moments(gamma, x, y, N, sums);
+
+      float n_k = sums[0];
 
       // update mixture weight
       _components[k]._pi = n_k / N;
@@ -327,30 +403,15 @@ void GMM::computeMStep(const QVector<Vector2>& X, int N)
       // update mean
       Vector2& mu = _components[k]._mu;
 
-      vectorInitZero(mu);
-
-      for ( int i = 0; i < N; ++i )
-      {
-         vectorAdd(mu, _gamma[k * N + i], X[i]);
-      }
-
+      mu = {{ sums[1], sums[2] }};
       vectorScale(mu, 1.0f / n_k);
 
       // update covariance matrix
       Matrix2x2& sigma = _components[k]._sigma;
 
-      matrixInitZero(sigma);
-
-      for ( int i = 0; i < N; ++i )
-      {
-         // compute xm = (x_i - mu_k)
-         Vector2 xm = X[i];
-         vectorSubtract(xm, mu);
-
-         // compute Sigma_ki = gamma_ki * (x_i - mu_k) (x_i - mu_k)^T
-         matrixAddOuterProduct(sigma, _gamma[k * N + i], xm);
-      }
+      _kernels.covariance(gamma, x, y, N, mu, sums);
 
+      sigma = {{ sums[0], sums[1], sums[1], sums[2] }};
       matrixScale(sigma, 1.0f / n_k);
    }
 }
@@ -372,6 +433,8 @@ void GMM::computeMStep(const QVector<Vector2>& X, int N)
  */
 void GMM::computeLabels(const float *gamma, int N, int K, QVector<qint8>& labels)
 {
+   const int stride = Kernels::stride(N);
+
    for ( int i = 0; i < N; ++i )
    {
       // determine the value k for which gamma_ki is highest
@@ -380,10 +443,10 @@ void GMM::computeLabels(const float *gamma, int N, int K, QVector<qint8>& labels
 
       for ( int k = 0; k < K; ++k )
       {
-         if ( max_gamma < gamma[k * N + i] )
+         if ( max_gamma < gamma[k * stride + i] )
          {
             max_k = k;
-            max_gamma = gamma[k * N + i];
+            max_gamma = gamma[k * stride + i];
          }
       }
 
@@ -409,13 +472,14 @@ void GMM::computeLabels(const float *gamma, int N, int K, QVector<qint8>& labels
  */
 float GMM::computeEntropy(const float *gamma, int N, const QVector<qint8>& labels)
 {
+   const int stride = Kernels::stride(N);
    float E = 0;
 
    for ( int i = 0; i < N; ++i )
    {
       int k = labels[i];
 
-      E -= logf(gamma[k * N + i]);
+      E -= simdLog(gamma[k * stride + i]);
    }
 
    return E;
@@ -427,15 +491,17 @@ float GMM::computeEntropy(const float *gamma, int N, const QVector<qint8>& label
 
 
 /*!
- * Fit the mixture model to a pairwise data array and compute the output cluster
- * labels for the data. The data array should only contain clean samples.
+ * Initialize the K components of the mixture model for a pairwise data array.
+ * Each component has a uniform mixture weight, an identity covariance matrix
+ * and a mean which is seeded with k-means++, and the means are then refined
+ * with k-means.
  *
- * @param X
+ * @param x
+ * @param y
  * @param N
  * @param K
- * @param labels
  */
-bool GMM::fit(const QVector<Vector2>& X, int N, int K, QVector<qint8>& labels)
+void GMM::initializeComponents(const float *x, const float *y, int N, int K)
 {
    // initialize random state
    unsigned long state = 1;
@@ -445,20 +511,100 @@ bool GMM::fit(const QVector<Vector2>& X, int N, int K, QVector<qint8>& labels)
 
    for ( int k = 0; k < K; ++k )
    {
-      // use uniform mixture weight and randomly sampled mean
-      int i = myrand(&state) % N;
+      // use uniform mixture weight and a random sample as the first mean
+      int i = (k == 0)
+         ? myrand(&state) % N
+         : sampleMean(x, y, N, k, &state);
 
-      _components[k].initialize(1.0f / K, X[i]);
+      _components[k].initialize(1.0f / K, {{ x[i], y[i] }});
    }
 
-   // initialize means with k-means
-   initializeMeans(X, N);
+   // refine means with k-means
+   initializeMeans(x, y, N);
+}
+
+
+
+
+
+
+/*!
+ * Initialize the components of the mixture model with K + 1 components from
+ * the components of a fitted mixture model with K components, so that the
+ * EM algorithm starts near a good solution. The fitted components are kept
+ * and a new component is added whose mean is seeded with k-means++. The
+ * mixture weights are scaled so that the new component has a uniform weight.
+ *
+ * @param x
+ * @param y
+ * @param N
+ */
+void GMM::extendComponents(const float *x, const float *y, int N)
+{
+   const int K = _components.size();
+
+   // initialize random state
+   unsigned long state = 1;
+
+   // select the mean of the new component
+   int i = sampleMean(x, y, N, K, &state);
+
+   // scale the mixture weights of the fitted components
+   for ( int k = 0; k < K; ++k )
+   {
+      _components[k]._pi *= static_cast<float>(K) / (K + 1);
+   }
+
+   // add the new component
+   _components.resize(K + 1);
+   _components[K].initialize(1.0f / (K + 1), {{ x[i], y[i] }});
+}
+
+
+
+
+
+
+/*!
+ * Fit the mixture model to a pairwise data array and compute the output cluster
+ * labels for the data, starting from the current components. The data arrays
+ * should only contain clean samples.
+ *
+ * The fit is abandoned as soon as an extrapolation of its final log-likelihood
+ * is not above the given threshold. Once EM has reached its linear rate of
+ * convergence, the ratio r of successive increases d_t of the log-likelihood
+ * is roughly stable, and the remaining increase is extrapolated as the
+ * geometric series of the last increase, which is enlarged by a safety factor:
+ *
+ *   logL_final ~ logL_t + EXTRAPOLATE_SAFETY * d_t * r / (1 - r), r = d_t / d_t-1
+ *
+ * The extrapolation is only used after the ratio has been stable for several
+ * iterations, since EM often stalls before it accelerates again. It is a
+ * heuristic rather than a bound, because EM can still accelerate after the
+ * ratio has been stable, so an abandoned sub-model may have been the best one
+ * and the selected number of clusters can differ from that of fitting every
+ * sub-model. The components of an abandoned fit are kept, so that the next
+ * sub-model can still be warm started from them.
+ *
+ * @param x
+ * @param y
+ * @param N
+ * @param threshold
+ * @param labels
+ */
+bool GMM::fit(const float *x, const float *y, int N, float threshold, QVector<qint8>& labels)
+{
+   const int K = _components.size();
 
    // run EM algorithm
-   const int MAX_ITERATIONS = 100;
-   const float TOLERANCE = 1e-8f;
    float prevLogL = -INFINITY;
    float currLogL = -INFINITY;
+   float prevDiff = INFINITY;
+   float prevRatio = INFINITY;
+   int stable = 0;
+   int iterations = 0;
+
+   _abandoned = false;
 
    for ( int t = 0; t < MAX_ITERATIONS; ++t )
    {
@@ -478,7 +624,7 @@ bool GMM::fit(const QVector<Vector2>& X, int N, int K, QVector<qint8>& labels)
 
       // perform E step
       prevLogL = currLogL;
-      currLogL = computeEStep(X, N);
+      currLogL = computeEStep(x, y, N);
 
       // check for convergence
       if ( fabs(currLogL - prevLogL) < TOLERANCE )
@@ -486,11 +632,35 @@ bool GMM::fit(const QVector<Vector2>& X, int N, int K, QVector<qint8>& labels)
          break;
       }
 
+      // return failure if the log-likelihood cannot reach the threshold
+      float diff = currLogL - prevLogL;
+      float ratio = diff / prevDiff;
+
+      if ( 0 < ratio && ratio < 1 && fabs(ratio - prevRatio) <= EXTRAPOLATE_TOLERANCE * ratio )
+      {
+         ++stable;
+      }
+      else
+      {
+         stable = 0;
+      }
+
+      if ( stable >= EXTRAPOLATE_WINDOW && currLogL + EXTRAPOLATE_SAFETY * diff * ratio / (1 - ratio) <= threshold )
+      {
+         _abandoned = true;
+         return false;
+      }
+
+      prevDiff = diff;
+      prevRatio = ratio;
+
       // perform M step
-      computeMStep(X, N);
+      computeMStep(x, y, N);
+      ++iterations;
    }
 
    // save outputs
+   _iterations[iterations]++;
    _logL = currLogL;
    computeLabels(_gamma, N, K, labels);
    _entropy = computeEntropy(_gamma, N, labels);
@@ -563,10 +733,80 @@ float GMM::computeICL(int K, int D, float logL, int N, float E)
 
 
 
+/*!
+ * Compute the value of the given criterion for a sub-model with K components
+ * which was fit to N samples.
+ *
+ * @param criterion
+ * @param K
+ * @param logL
+ * @param N
+ * @param E
+ */
+float GMM::computeCriterion(Criterion criterion, int K, float logL, int N, float E)
+{
+   float value = INFINITY;
+
+   switch (criterion)
+   {
+   case Criterion::AIC:
+      value = computeAIC(K, 2, logL);
+      break;
+   case Criterion::BIC:
+      value = computeBIC(K, 2, logL, N);
+      break;
+   case Criterion::ICL:
+      value = computeICL(K, 2, logL, N, E);
+      break;
+   }
+
+   return value;
+}
+
+
+
+
+
+
+/*!
+ * Compute the log-likelihood threshold which a sub-model with K components
+ * must exceed in order to have a lower criterion value than the given best
+ * value. Since the entropy term of ICL is not negative, a sub-model whose
+ * log-likelihood does not exceed the threshold cannot have the best criterion
+ * value. The threshold is -INFINITY if every sub-model must be fit.
+ *
+ * @param criterion
+ * @param K
+ * @param N
+ * @param bestValue
+ */
+float GMM::computeThreshold(Criterion criterion, int K, int N, float bestValue)
+{
+   if ( _selection == Selection::Full || std::isinf(bestValue) )
+   {
+      return -INFINITY;
+   }
+
+   float penalty = computeCriterion(criterion, K, 0, N, 0);
+
+   return 0.5f * (penalty - bestValue);
+}
+
+
+
+
+
+
 /*!
  * Determine the number of clusters in a pairwise data array. Several sub-models,
  * each one having a different number of clusters, are fit to the data and the
- * sub-model with the best criterion value is selected.
+ * sub-model with the best criterion value is selected. Each sub-model is warm
+ * started from the previous sub-model if it was fit successfully or abandoned.
+ * Depending on the selection strategy, sub-models which are not expected to
+ * have the best criterion value are abandoned, and the remaining sub-models
+ * are skipped after the first sub-model which does not improve the criterion
+ * value. Both strategies are heuristics which can change the selected number
+ * of clusters, so every sub-model is fit by default.
  *
  * @param expressions
  * @param index
@@ -578,7 +818,7 @@ float GMM::computeICL(int K, int D, float logL, int N, float E)
  * @param criterion
  */
 qint8 GMM::compute(
-   const std::vector<float>& expressions,
+   const float *expressions,
    const Index& index,
    int numSamples,
    QVector<qint8>& labels,
@@ -588,8 +828,8 @@ qint8 GMM::compute(
    Criterion criterion)
 {
    // index into gene expressions
-   const float *x = &expressions[index.getX() * labels.size()];
-   const float *y = &expressions[index.getY() * labels.size()];
+   const float *x = &expressions[static_cast<qint64>(index.getX()) * labels.size()];
+   const float *y = &expressions[static_cast<qint64>(index.getY()) * labels.size()];
 
    // perform clustering only if there are enough samples
    qint8 bestK = 0;
@@ -601,18 +841,35 @@ qint8 GMM::compute(
       {
          if ( labels[i] >= 0 )
          {
-            _data[j] = { x[i], y[i] };
+            _x[j] = x[i];
+            _y[j] = y[i];
             ++j;
          }
       }
 
       // determine the number of clusters
       float bestValue = INFINITY;
+      bool warmStart = false;
+      int skipped = 0;
 
       for ( qint8 K = minClusters; K <= maxClusters; ++K )
       {
+         // initialize each sub-model from the previous sub-model if it was fit
+         if ( warmStart )
+         {
+            extendComponents(_x.data(), _y.data(), numSamples);
+         }
+         else
+         {
+            initializeComponents(_x.data(), _y.data(), numSamples, K);
+         }
+
          // run each clustering sub-model
-         bool success = fit(_data, numSamples, K, _labels);
+         float threshold = computeThreshold(criterion, K, numSamples, bestValue);
+         bool success = fit(_x.data(), _y.data(), numSamples, threshold, _labels);
+
+         warmStart = success || _abandoned;
+         skipped += _abandoned;
 
          if ( !success )
          {
@@ -620,18 +877,12 @@ qint8 GMM::compute(
          }
 
          // compute the criterion value of the sub-model
-         float value = INFINITY;
+         float value = computeCriterion(criterion, K, _logL, numSamples, _entropy);
 
-         switch (criterion)
+         // skip the remaining sub-models if the sub-model is not an improvement
+         if ( _selection == Selection::First && value >= bestValue )
          {
-         case Criterion::AIC:
-            value = computeAIC(K, 2, _logL);
-            break;
-         case Criterion::BIC:
-            value = computeBIC(K, 2, _logL, numSamples);
-            break;
-         case Criterion::ICL:
-            value = computeICL(K, 2, _logL, numSamples, _entropy);
+            skipped += maxClusters - K;
             break;
          }
 
@@ -652,6 +903,8 @@ qint8 GMM::compute(
             }
          }
       }
+
+      _skipped[skipped]++;
    }
 
    return bestK;
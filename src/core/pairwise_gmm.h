@@ -2,6 +2,7 @@
 #define PAIRWISE_GMM_H
 #include "pairwise_clusteringmodel.h"
 #include "pairwise_linalg.h"
+#include "pairwise_simd.h"
 
 namespace Pairwise
 {
@@ -10,20 +11,25 @@ namespace Pairwise
     * determined by creating several sub-models, each with a different assumption
     * of the number of clusters, and selecting the sub-model which best fits the
     * data according to a criterion.
+    *
+    * The samples of a pair are stored as separate arrays of x and y values, and
+    * the per-sample steps of the EM algorithm are computed by the SIMD kernels
+    * in GMM::Kernels for the instruction set of the CPU.
     */
    class GMM : public ClusteringModel
    {
    public:
-      GMM(ExpressionMatrix* emx, qint8 maxClusters);
+      GMM(ExpressionMatrix* emx, qint8 maxClusters, SimdLevel level = simdLevel(), Selection selection = Selection::Full);
       ~GMM();
    public:
+      class Kernels;
       class Component
       {
       public:
          Component() = default;
          void initialize(float pi, const Vector2& mu);
          bool prepare();
-         void computeLogProbNorm(const QVector<Vector2>& X, int N, float *logP);
+         void computeLogProbNorm(const Kernels& kernels, const float *x, const float *y, int N, float *logP);
       public:
          /*!
           * The mixture weight.
@@ -50,7 +56,7 @@ namespace Pairwise
       };
    public:
       virtual qint8 compute(
-         const std::vector<float>& expressions,
+         const float *expressions,
          const Index& index,
          int numSamples,
          QVector<qint8>& labels,
@@ -59,21 +65,82 @@ namespace Pairwise
          qint8 maxClusters,
          Criterion criterion
       ) override final;
+      /*!
+       * Return the histogram of the number of EM iterations of each fit since
+       * the histogram was last reset, where bin t is the number of fits which
+       * stopped after t iterations.
+       */
+      const QVector<qint64>& iterations() const { return _iterations; }
+      /*!
+       * Return the histogram of the number of sub-models of each pair which
+       * were skipped or abandoned since the histogram was last reset, where
+       * bin n is the number of pairs for which n sub-models were skipped.
+       */
+      const QVector<qint64>& skipped() const { return _skipped; }
+      void resetIterations();
+      /*!
+       * The maximum number of iterations of the EM algorithm.
+       */
+      constexpr static int MAX_ITERATIONS {100};
+      /*!
+       * The minimum change in log-likelihood between iterations of the EM
+       * algorithm, below which the algorithm has converged.
+       */
+      constexpr static float TOLERANCE {1e-8f};
+      /*!
+       * The number of consecutive iterations in which the ratio of successive
+       * increases of the log-likelihood must be stable before the
+       * extrapolated log-likelihood is used to abandon a fit.
+       */
+      constexpr static int EXTRAPOLATE_WINDOW {4};
+      /*!
+       * The largest relative change of the ratio of successive increases of
+       * the log-likelihood for which the ratio is stable.
+       */
+      constexpr static float EXTRAPOLATE_TOLERANCE {0.02f};
+      /*!
+       * The factor by which the extrapolated remaining increase of the
+       * log-likelihood is enlarged.
+       */
+      constexpr static float EXTRAPOLATE_SAFETY {2.0f};
    private:
-      void initializeMeans(const QVector<Vector2>& X, int N);
-      float computeEStep(const QVector<Vector2>& X, int N);
-      void computeMStep(const QVector<Vector2>& X, int N);
+      int sampleMean(const float *x, const float *y, int N, int K, unsigned long *state);
+      void initializeMeans(const float *x, const float *y, int N);
+      float computeEStep(const float *x, const float *y, int N);
+      void computeMStep(const float *x, const float *y, int N);
+      void initializeComponents(const float *x, const float *y, int N, int K);
+      void extendComponents(const float *x, const float *y, int N);
       void computeLabels(const float *gamma, int N, int K, QVector<qint8>& labels);
       float computeEntropy(const float *gamma, int N, const QVector<qint8>& labels);
-      bool fit(const QVector<Vector2>& X, int N, int K, QVector<qint8>& labels);
+      bool fit(const float *x, const float *y, int N, float threshold, QVector<qint8>& labels);
       float computeAIC(int K, int D, float logL);
       float computeBIC(int K, int D, float logL, int N);
       float computeICL(int K, int D, float logL, int N, float E);
+      float computeCriterion(Criterion criterion, int K, float logL, int N, float E);
+      float computeThreshold(Criterion criterion, int K, int N, float bestValue);
    private:
       /*!
-       * Workspace for clustering data.
+       * The SIMD kernels of the EM algorithm.
        */
-      QVector<Vector2> _data;
+      const Kernels& _kernels;
+      /*!
+       * The strategy used to select the number of clusters.
+       */
+      Selection _selection;
+      /*!
+       * Workspace for the x values of the clustering data, padded for the SIMD
+       * kernels.
+       */
+      std::vector<float> _x;
+      /*!
+       * Workspace for the y values of the clustering data, padded for the SIMD
+       * kernels.
+       */
+      std::vector<float> _y;
+      /*!
+       * Workspace for the log-probability of each sample.
+       */
+      std::vector<float> _logpx;
       /*!
        * Workspace for the cluster labels.
        */
@@ -84,7 +151,8 @@ namespace Pairwise
        */
       QVector<Component> _components;
       /*!
-       * The array of posterior probabilities used by the EM algorithm.
+       * The array of posterior probabilities used by the EM algorithm, which
+       * has one row of padded samples for each component.
        */
       float *_gamma;
       /*!
@@ -95,6 +163,19 @@ namespace Pairwise
        * The entropy of the mixture model.
        */
       float _entropy;
+      /*!
+       * Whether the last fit was abandoned because it could not reach the
+       * log-likelihood threshold.
+       */
+      bool _abandoned;
+      /*!
+       * The histogram of the number of EM iterations of each fit.
+       */
+      QVector<qint64> _iterations;
+      /*!
+       * The histogram of the number of skipped sub-models of each pair.
+       */
+      QVector<qint64> _skipped;
    };
 }
 
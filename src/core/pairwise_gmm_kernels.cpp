@@ -0,0 +1,346 @@
+#include "pairwise_gmm_kernels.h"
+
+
+
+using namespace Pairwise;
+
+
+
+
+
+
+/*!
+ * Compute the log-probability density of a component for each sample, as
+ * described in GMM::Component::computeLogProbNorm().
+ *
+ * @param x
+ * @param y
+ * @param N
+ * @param mu
+ * @param sigmaInv
+ * @param normalizer
+ * @param logP
+ */
+template<typename T>
+static inline __attribute__((always_inline)) void computeLogProbNorm(
+   const float *x,
+   const float *y,
+   int N,
+   const Vector2& mu,
+   const Matrix2x2& sigmaInv,
+   float normalizer,
+   float *logP)
+{
+   const int L = SimdTraits<T>::LANES;
+
+   for ( int i = 0; i < N; i += L )
+   {
+      // compute xm = (x - mu)
+      T xm0 = simdLoad<T>(&x[i]) - mu.s[0];
+      T xm1 = simdLoad<T>(&y[i]) - mu.s[1];
+
+      // compute Sxm = Sigma^-1 xm
+      T Sxm0 = sigmaInv.s[0] * xm0 + sigmaInv.s[1] * xm1;
+      T Sxm1 = sigmaInv.s[2] * xm0 + sigmaInv.s[3] * xm1;
+
+      // compute xmSxm = xm^T Sigma^-1 xm
+      T xmSxm = xm0 * Sxm0 + xm1 * Sxm1;
+
+      // compute log(P) = normalizer - 0.5 * xm^T * Sigma^-1 * xm
+      simdStore(&logP[i], normalizer - 0.5f * xmSxm);
+   }
+}
+
+
+
+
+
+
+/*!
+ * Compute the posterior probabilities of each component and the
+ * log-probability of each sample, as described in GMM::computeEStep().
+ *
+ * @param gamma
+ * @param stride
+ * @param logpi
+ * @param K
+ * @param N
+ * @param logpx
+ */
+template<typename T>
+static inline __attribute__((always_inline)) void computeResponsibilities(
+   float *gamma,
+   int stride,
+   const float *logpi,
+   int K,
+   int N,
+   float *logpx)
+{
+   const int L = SimdTraits<T>::LANES;
+
+   for ( int i = 0; i < N; i += L )
+   {
+      // compute a = argmax(logpi_k + logProb_ki, k)
+      T maxArg = simdSet<T>(-INFINITY);
+
+      for ( int k = 0; k < K; ++k )
+      {
+         T arg = logpi[k] + simdLoad<T>(&gamma[k * stride + i]);
+         maxArg = simdSelect(maxArg < arg, arg, maxArg);
+      }
+
+      // compute logpx
+      T sum = simdSet<T>(0.0f);
+
+      for ( int k = 0; k < K; ++k )
+      {
+         sum += simdExp(logpi[k] + simdLoad<T>(&gamma[k * stride + i]) - maxArg);
+      }
+
+      T lpx = maxArg + simdLog(sum);
+
+      // compute gamma_ki
+      for ( int k = 0; k < K; ++k )
+      {
+         float *g = &gamma[k * stride + i];
+
+         simdStore(g, simdExp(simdLoad<T>(g) + (logpi[k] - lpx)));
+      }
+
+      simdStore(&logpx[i], lpx);
+   }
+}
+
+
+
+
+
+
+/*!
+ * Compute the sums of gamma, gamma * x and gamma * y of a component with the
+ * striped reduction.
+ *
+ * @param gamma
+ * @param x
+ * @param y
+ * @param N
+ * @param sums
+ */
+template<typename T>
+static inline __attribute__((always_inline)) void computeMoments(
+   const float *gamma,
+   const float *x,
+   const float *y,
+   int N,
+   float *sums)
+{
+   const int L = SimdTraits<T>::LANES;
+   const int S = SIMD_STRIPES / L;
+   const T zero = simdSet<T>(0.0f);
+
+   T n[S], mx[S], my[S];
+
+   for ( int s = 0; s < S; ++s )
+   {
+      n[s] = zero;
+      mx[s] = zero;
+      my[s] = zero;
+   }
+
+   for ( int i = 0; i < N; i += L )
+   {
+      auto valid = (simdIota<T>() + static_cast<float>(i) < static_cast<float>(N));
+      int s = (i / L) % S;
+
+      T g = simdLoad<T>(&gamma[i]);
+
+      n[s] += simdSelect(valid, g, zero);
+      mx[s] += simdSelect(valid, g * simdLoad<T>(&x[i]), zero);
+      my[s] += simdSelect(valid, g * simdLoad<T>(&y[i]), zero);
+   }
+
+   sums[0] = simdReduce(n);
+   sums[1] = simdReduce(mx);
+   sums[2] = simdReduce(my);
+}
+
+
+
+
+
+
+/*!
+ * Compute the weighted sums of squares and cross products of a component about
+ * its mean with the striped reduction.
+ *
+ * @param gamma
+ * @param x
+ * @param y
+ * @param N
+ * @param mu
+ * @param sums
+ */
+template<typename T>
+static inline __attribute__((always_inline)) void computeCovariance(
+   const float *gamma,
+   const float *x,
+   const float *y,
+   int N,
+   const Vector2& mu,
+   float *sums)
+{
+   const int L = SimdTraits<T>::LANES;
+   const int S = SIMD_STRIPES / L;
+   const T zero = simdSet<T>(0.0f);
+
+   T sxx[S], sxy[S], syy[S];
+
+   for ( int s = 0; s < S; ++s )
+   {
+      sxx[s] = zero;
+      sxy[s] = zero;
+      syy[s] = zero;
+   }
+
+   for ( int i = 0; i < N; i += L )
+   {
+      auto valid = (simdIota<T>() + static_cast<float>(i) < static_cast<float>(N));
+      int s = (i / L) % S;
+
+      // compute xm = (x_i - mu_k)
+      T g = simdLoad<T>(&gamma[i]);
+      T xm0 = simdLoad<T>(&x[i]) - mu.s[0];
+      T xm1 = simdLoad<T>(&y[i]) - mu.s[1];
+
+      // compute gamma_ki * (x_i - mu_k) (x_i - mu_k)^T
+      sxx[s] += simdSelect(valid, g * xm0 * xm0, zero);
+      sxy[s] += simdSelect(valid, g * xm0 * xm1, zero);
+      syy[s] += simdSelect(valid, g * xm1 * xm1, zero);
+   }
+
+   sums[0] = simdReduce(sxx);
+   sums[1] = simdReduce(sxy);
+   sums[2] = simdReduce(syy);
+}
+
+
+
+
+
+
+/*
+ * Instantiate the kernels for each instruction set. The vector instantiations
+ * are compiled for their target inside these wrappers, since the kernel
+ * templates are always inlined.
+ */
+static void logProbNormScalar(const float *x, const float *y, int N, const Vector2& mu, const Matrix2x2& sigmaInv, float normalizer, float *logP)
+   { computeLogProbNorm<float>(x, y, N, mu, sigmaInv, normalizer, logP); }
+static void responsibilitiesScalar(float *gamma, int stride, const float *logpi, int K, int N, float *logpx)
+   { computeResponsibilities<float>(gamma, stride, logpi, K, N, logpx); }
+static void momentsScalar(const float *gamma, const float *x, const float *y, int N, float *sums)
+   { computeMoments<float>(gamma, x, y, N, sums); }
+static void covarianceScalar(const float *gamma, const float *x, const float *y, int N, const Vector2& mu, float *sums)
+   { computeCovariance<float>(gamma, x, y, N, mu, sums); }
+
+#if defined(__x86_64__) || defined(__i386__)
+
+__attribute__((target("sse2")))
+static void logProbNormSSE2(const float *x, const float *y, int N, const Vector2& mu, const Matrix2x2& sigmaInv, float normalizer, float *logP)
+   { computeLogProbNorm<Float4>(x, y, N, mu, sigmaInv, normalizer, logP); }
+__attribute__((target("sse2")))
+static void responsibilitiesSSE2(float *gamma, int stride, const float *logpi, int K, int N, float *logpx)
+   { computeResponsibilities<Float4>(gamma, stride, logpi, K, N, logpx); }
+__attribute__((target("sse2")))
+static void momentsSSE2(const float *gamma, const float *x, const float *y, int N, float *sums)
+   { computeMoments<Float4>(gamma, x, y, N, sums); }
+__attribute__((target("sse2")))
+static void covarianceSSE2(const float *gamma, const float *x, const float *y, int N, const Vector2& mu, float *sums)
+   { computeCovariance<Float4>(gamma, x, y, N, mu, sums); }
+
+__attribute__((target("avx2")))
+static void logProbNormAVX2(const float *x, const float *y, int N, const Vector2& mu, const Matrix2x2& sigmaInv, float normalizer, float *logP)
+   { computeLogProbNorm<Float8>(x, y, N, mu, sigmaInv, normalizer, logP); }
+__attribute__((target("avx2")))
+static void responsibilitiesAVX2(float *gamma, int stride, const float *logpi, int K, int N, float *logpx)
+   { computeResponsibilities<Float8>(gamma, stride, logpi, K, N, logpx); }
+__attribute__((target("avx2")))
+static void momentsAVX2(const float *gamma, const float *x, const float *y, int N, float *sums)
+   { computeMoments<Float8>(gamma, x, y, N, sums); }
+__attribute__((target("avx2")))
+static void covarianceAVX2(const float *gamma, const float *x, const float *y, int N, const Vector2& mu, float *sums)
+   { computeCovariance<Float8>(gamma, x, y, N, mu, sums); }
+
+__attribute__((target("avx512f")))
+static void logProbNormAVX512(const float *x, const float *y, int N, const Vector2& mu, const Matrix2x2& sigmaInv, float normalizer, float *logP)
+   { computeLogProbNorm<Float16>(x, y, N, mu, sigmaInv, normalizer, logP); }
+__attribute__((target("avx512f")))
+static void responsibilitiesAVX512(float *gamma, int stride, const float *logpi, int K, int N, float *logpx)
+   { computeResponsibilities<Float16>(gamma, stride, logpi, K, N, logpx); }
+__attribute__((target("avx512f")))
+static void momentsAVX512(const float *gamma, const float *x, const float *y, int N, float *sums)
+   { computeMoments<Float16>(gamma, x, y, N, sums); }
+__attribute__((target("avx512f")))
+static void covarianceAVX512(const float *gamma, const float *x, const float *y, int N, const Vector2& mu, float *sums)
+   { computeCovariance<Float16>(gamma, x, y, N, mu, sums); }
+
+#endif
+
+
+
+
+
+
+/*!
+ * Return the set of kernels for the given instruction set. If the instruction
+ * set is not available on this platform then the scalar kernels are returned.
+ *
+ * @param level
+ */
+const GMM::Kernels& GMM::Kernels::get(SimdLevel level)
+{
+   static const Kernels SCALAR {
+      logProbNormScalar, responsibilitiesScalar, momentsScalar, covarianceScalar
+   };
+
+#if defined(__x86_64__) || defined(__i386__)
+   static const Kernels SSE2 {
+      logProbNormSSE2, responsibilitiesSSE2, momentsSSE2, covarianceSSE2
+   };
+   static const Kernels AVX2 {
+      logProbNormAVX2, responsibilitiesAVX2, momentsAVX2, covarianceAVX2
+   };
+   static const Kernels AVX512 {
+      logProbNormAVX512, responsibilitiesAVX512, momentsAVX512, covarianceAVX512
+   };
+
+   switch ( level )
+   {
+   case SimdLevel::SSE2:
+      return SSE2;
+   case SimdLevel::AVX2:
+      return AVX2;
+   case SimdLevel::AVX512:
+      return AVX512;
+   default:
+      break;
+   }
+#else
+   Q_UNUSED(level);
+#endif
+
+   return SCALAR;
+}
+
+
+
+
+
+
+/*!
+ * Return the set of kernels for the widest instruction set which is supported
+ * by the CPU.
+ */
+const GMM::Kernels& GMM::Kernels::instance()
+{
+   return get(simdLevel());
+}
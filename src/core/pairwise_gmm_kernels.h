@@ -0,0 +1,63 @@
+#ifndef PAIRWISE_GMM_KERNELS_H
+#define PAIRWISE_GMM_KERNELS_H
+#include "pairwise_gmm.h"
+#include "pairwise_simd.h"
+
+namespace Pairwise
+{
+   /*!
+    * This class implements the per-sample kernels of the EM algorithm of the
+    * Gaussian mixture model: the log-probability density of a component, the
+    * log-sum-exp responsibilities of every component, and the weighted
+    * moments of a component. The kernels operate on a structure-of-arrays
+    * layout, in which the x and y values of the samples are stored in separate
+    * arrays, and each kernel is compiled for every supported instruction set.
+    * The set of kernels for the instruction set of the CPU is selected at
+    * runtime with instance().
+    *
+    * Every array which is passed to a kernel must be readable and writable up
+    * to the next multiple of PADDING samples, because the vector kernels load
+    * and store whole vectors. The values in the padding are ignored. Sums over
+    * samples use the striped reduction of pairwise_simd.h, so every set of
+    * kernels computes exactly the same values.
+    */
+   class GMM::Kernels
+   {
+   public:
+      static const Kernels& get(SimdLevel level);
+      static const Kernels& instance();
+      /*!
+       * Return the number of samples in an array of N samples with padding.
+       *
+       * @param N
+       */
+      static int stride(int N) { return (N + PADDING - 1) / PADDING * PADDING; }
+      /*!
+       * The number of samples to which every array is padded.
+       */
+      constexpr static int PADDING {SIMD_STRIPES};
+   public:
+      /*!
+       * Compute the log-probability density of a component for each sample.
+       */
+      void (*logProbNorm)(const float *x, const float *y, int N, const Vector2& mu, const Matrix2x2& sigmaInv, float normalizer, float *logP);
+      /*!
+       * Replace the log-probability densities in gamma, which has one row of
+       * the given stride for each of the K components, with the posterior
+       * probabilities of each component, and save the log-probability of each
+       * sample to logpx.
+       */
+      void (*responsibilities)(float *gamma, int stride, const float *logpi, int K, int N, float *logpx);
+      /*!
+       * Compute the sums of gamma, gamma * x and gamma * y of a component.
+       */
+      void (*moments)(const float *gamma, const float *x, const float *y, int N, float *sums);
+      /*!
+       * Compute the sums of gamma * (x - mu_x)^2, gamma * (x - mu_x) * (y -
+       * mu_y) and gamma * (y - mu_y)^2 of a component.
+       */
+      void (*covariance)(const float *gamma, const float *x, const float *y, int N, const Vector2& mu, float *sums);
+   };
+}
+
+#endif
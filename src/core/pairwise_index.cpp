@@ -2,8 +2,8 @@
 
 
 
-
 using namespace Pairwise;
+using namespace std;
 
 
 
@@ -58,17 +58,232 @@ Index::Index(qint64 index)
    }
 
    // compute pairwise index from scalar index
-   qint64 pos {0};
-   qint64 x {0};
+   _x = rowOf(index);
+   _y = static_cast<qint32>(index - rowOffset(_x));
+}
+
+
+
+
+
 
-   while ( pos + x <= index )
+/*!
+ * Construct a pairwise index from a row index and a column index without
+ * checking that the pairwise index is valid.
+ *
+ * @param x
+ * @param y
+ */
+Index Index::fromUnchecked(qint32 x, qint32 y)
+{
+   Index index;
+   index._x = x;
+   index._y = y;
+
+   return index;
+}
+
+
+
+
+
+
+/*!
+ * Return the row index of the pair with the given scalar index. Row x contains
+ * the scalar indices in [x(x-1)/2, x(x+1)/2), so the row index is the floor of
+ * (1 + sqrt(1 + 8 * index)) / 2. The square root is evaluated in floating
+ * point and then corrected, which is exact for any 64-bit scalar index.
+ *
+ * @param index
+ */
+qint32 Index::rowOf(qint64 index)
+{
+   qint64 x {static_cast<qint64>((1 + sqrt(1 + 8 * static_cast<double>(index))) / 2)};
+
+   while ( x > 1 && rowOffset(x) > index )
+   {
+      --x;
+   }
+
+   while ( rowOffset(x + 1) <= index )
    {
-      pos += x;
       ++x;
    }
 
-   _x = static_cast<qint32>(x);
-   _y = static_cast<qint32>(index - pos);
+   return static_cast<qint32>(x);
+}
+
+
+
+
+
+
+/*!
+ * Split a range of scalar indices into rows. Each element of the returned
+ * list describes the pairs of one row which are in the range, in order.
+ *
+ * @param start
+ * @param size
+ */
+QVector<Index::RowRange> Index::splitRows(qint64 start, qint64 size)
+{
+   QVector<RowRange> rows;
+
+   if ( size <= 0 )
+   {
+      return rows;
+   }
+
+   qint64 end {start + size};
+   qint32 xFirst {rowOf(start)};
+   qint32 xLast {rowOf(end - 1)};
+
+   for ( qint32 x = xFirst; x <= xLast; ++x )
+   {
+      qint64 first {max(start, rowOffset(x))};
+      qint64 last {min(end, rowOffset(x) + x)};
+
+      rows.append({
+         x,
+         static_cast<qint32>(first - rowOffset(x)),
+         static_cast<qint32>(last - rowOffset(x)),
+         first - start
+      });
+   }
+
+   return rows;
+}
+
+
+
+
+
+
+/*!
+ * Return the number of square tiles of the given size which cover the lower
+ * triangle of a pairwise matrix with the given number of genes, including the
+ * tiles on the diagonal.
+ *
+ * @param geneSize
+ * @param tileSize
+ */
+qint64 Index::tileCount(qint32 geneSize, qint32 tileSize)
+{
+   qint64 n {(static_cast<qint64>(geneSize) + tileSize - 1) / tileSize};
+
+   return n * (n + 1) / 2;
+}
+
+
+
+
+
+
+/*!
+ * Return the tile with the given index. Tiles are numbered in row-major order
+ * within the lower triangle, the same way as pairwise indices except that the
+ * diagonal is included, so the tiles of each row of tiles have consecutive
+ * indices and the last tile of each row lies on the diagonal.
+ *
+ * @param tile
+ * @param geneSize
+ * @param tileSize
+ */
+Index::Tile Index::tileAt(qint64 tile, qint32 geneSize, qint32 tileSize)
+{
+   // determine the row and column of the tile, which are the row and column
+   // of the pairwise index of the tile shifted by one row
+   qint32 i {rowOf(tile) - 1};
+   qint32 j {static_cast<qint32>(tile - rowOffset(i + 1))};
+
+   // determine the rows and columns of the tile
+   Tile result;
+   result.rowStart = i * tileSize;
+   result.rowEnd = min(result.rowStart + tileSize, geneSize);
+   result.colStart = j * tileSize;
+   result.colEnd = min(result.colStart + tileSize, geneSize);
+
+   return result;
+}
+
+
+
+
+
+
+/*!
+ * Return the tile which is processed at the given position of the owner
+ * order, where both are numbered as in tileAt(). The owner order deals the
+ * positions to a number of owners in turn, so that the owner of a position is
+ * the position modulo the number of owners, and it permutes the tiles within
+ * each row of tiles so that each owner is dealt the tiles of the same columns
+ * in every row, which are the columns congruent to the owner. Since the number
+ * of tiles in a row is not a multiple of the number of owners in general,
+ * fewer than one tile per owner in each row goes to another owner instead.
+ * The tiles of each row still occupy the same consecutive positions and the
+ * tile on the diagonal remains the last of its row.
+ *
+ * @param position
+ * @param owners
+ */
+qint64 Index::ownedTile(qint64 position, qint32 owners)
+{
+   // determine the row of tiles of the position and its column within the
+   // row, which is kept on the diagonal
+   qint32 row {rowOf(position) - 1};
+   qint64 base {rowOffset(row + 1)};
+   qint32 p {static_cast<qint32>(position - base)};
+
+   if ( p == row || owners <= 1 )
+   {
+      return position;
+   }
+
+   // determine the number of columns and positions of each owner within the
+   // tiles off the diagonal, where the owner of column c is c modulo the
+   // number of owners and the first position of owner r is the first one
+   // which is congruent to r
+   qint32 length {row};
+   qint32 shift {static_cast<qint32>(base % owners)};
+   auto first = [&] (qint32 r) { return (r - shift + owners) % owners; };
+   auto columns = [&] (qint32 r) { return (r < length) ? (length - 1 - r) / owners + 1 : 0; };
+   auto positions = [&] (qint32 r) { return (first(r) < length) ? (length - 1 - first(r)) / owners + 1 : 0; };
+
+   // use the k-th column of the owner of the position for its k-th position
+   // if the owner has that many columns
+   qint32 r {static_cast<qint32>((base + p) % owners)};
+   qint32 k {(p - first(r)) / owners};
+
+   if ( k < columns(r) )
+   {
+      return base + r + k * owners;
+   }
+
+   // otherwise pair the remaining positions with the remaining columns in
+   // order, which all lie in the last partial round of owners because every
+   // owner has at least that many columns and positions
+   qint32 round {length / owners * owners};
+   qint32 ordinal {0};
+
+   for ( qint32 q = round; q < p; ++q )
+   {
+      qint32 s {static_cast<qint32>((base + q) % owners)};
+
+      if ( (q - first(s)) / owners >= columns(s) )
+      {
+         ++ordinal;
+      }
+   }
+
+   for ( qint32 c = round; c < length; ++c )
+   {
+      if ( c / owners >= positions(c % owners) && ordinal-- == 0 )
+      {
+         return base + c;
+      }
+   }
+
+   return position;
 }
 
 
@@ -95,8 +310,7 @@ qint64 Index::indent(qint8 cluster) const
    }
 
    // compute indent with given cluster and return it
-   qint64 index {static_cast<qint64>(_x) * (_x - 1) / 2 + _y};
-   return index * MAX_CLUSTER_SIZE + cluster;
+   return indentUnchecked(cluster);
 }
 
 
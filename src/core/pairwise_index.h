@@ -15,16 +15,93 @@ namespace Pairwise
     * used to rank pairs that also have a cluster index; this value requires a
     * fixed upper bound on the number of clusters, which depends on the data
     * objects that use this class.
+    *
+    * The class also provides the algebra of the pairwise index as static
+    * functions: converting between rows and scalar indices in constant time,
+    * splitting a range of scalar indices into rows, and numbering and ordering
+    * the square tiles of the lower triangle. Functions with an "unchecked"
+    * variant skip validation and are intended for hot loops whose arguments
+    * are known to be valid.
     */
    class Index
    {
+   public:
+      /*!
+       * Defines the pairs of a single row within a range of scalar indices.
+       */
+      struct RowRange
+      {
+         /*!
+          * The row index.
+          */
+         qint32 x;
+         /*!
+          * The first column index of the row within the range.
+          */
+         qint32 yBegin;
+         /*!
+          * One past the last column index of the row within the range.
+          */
+         qint32 yEnd;
+         /*!
+          * The number of pairs in the range which precede this row.
+          */
+         qint64 offset;
+      };
+      /*!
+       * Defines a square tile of the lower triangle of a pairwise matrix.
+       */
+      struct Tile
+      {
+         /*!
+          * The first row of the tile.
+          */
+         qint32 rowStart;
+         /*!
+          * One past the last row of the tile.
+          */
+         qint32 rowEnd;
+         /*!
+          * The first column of the tile.
+          */
+         qint32 colStart;
+         /*!
+          * One past the last column of the tile.
+          */
+         qint32 colEnd;
+      };
+      class Iterator;
+      class Range;
    public:
       Index() = default;
       Index(qint32 x, qint32 y);
       Index(qint64 index);
       Index(const Index&) = default;
       Index(Index&&) = default;
+      static Index fromUnchecked(qint32 x, qint32 y);
+      static qint32 rowOf(qint64 index);
+      /*!
+       * Return the scalar index of the first pair in the given row.
+       *
+       * @param x
+       */
+      static qint64 rowOffset(qint32 x) { return static_cast<qint64>(x) * (x - 1) / 2; }
+      static QVector<RowRange> splitRows(qint64 start, qint64 size);
+      static qint64 tileCount(qint32 geneSize, qint32 tileSize);
+      static Tile tileAt(qint64 tile, qint32 geneSize, qint32 tileSize);
+      static qint64 ownedTile(qint64 position, qint32 owners);
       qint64 indent(qint8 cluster) const;
+      /*!
+       * Return the indent value of this pairwise index with a given cluster
+       * index, without checking that the cluster index is valid.
+       *
+       * @param cluster
+       */
+      qint64 indentUnchecked(qint8 cluster) const { return toScalar() * MAX_CLUSTER_SIZE + cluster; }
+      /*!
+       * Return the scalar index of this pairwise index.
+       */
+      qint64 toScalar() const { return rowOffset(_x) + _y; }
       qint32 getX() const { return _x; }
       qint32 getY() const { return _y; }
       Index& operator=(const Index&) = default;
@@ -32,15 +109,15 @@ namespace Pairwise
       void operator++();
       bool operator==(const Index& object) const
          { return _x == object._x && _y == object._y; }
-      bool operator!=(const Index& object)
+      bool operator!=(const Index& object) const
          { return !(*this == object); }
-      bool operator<(const Index& object)
+      bool operator<(const Index& object) const
          { return _x < object._x || (_x == object._x && _y < object._y); }
-      bool operator<=(const Index& object)
+      bool operator<=(const Index& object) const
          { return *this < object || *this == object; }
-      bool operator>(const Index& object)
+      bool operator>(const Index& object) const
          { return !(*this <= object); }
-      bool operator>=(const Index& object)
+      bool operator>=(const Index& object) const
          { return !(*this < object); }
       /*!
        * The maximum number of clusters used to compute the indent value
@@ -59,6 +136,76 @@ namespace Pairwise
        */
       qint32 _y {0};
    };
+
+
+
+   /*!
+    * This class implements a forward iterator over consecutive pairwise
+    * indices, which is incremented without validation.
+    */
+   class Index::Iterator
+   {
+   public:
+      /*!
+       * Construct an iterator at the given pairwise index.
+       *
+       * @param index
+       */
+      explicit Iterator(const Index& index): _index(index) {}
+      /*!
+       * Return the current pairwise index.
+       */
+      const Index& operator*() const { return _index; }
+      /*!
+       * Advance to the next pairwise index.
+       */
+      Iterator& operator++()
+      {
+         if ( ++_index._y >= _index._x )
+         {
+            _index._y = 0;
+            ++_index._x;
+         }
+         return *this;
+      }
+      bool operator==(const Iterator& object) const { return _index == object._index; }
+      bool operator!=(const Iterator& object) const { return _index != object._index; }
+   private:
+      /*!
+       * The current pairwise index.
+       */
+      Index _index;
+   };
+
+
+
+   /*!
+    * This class implements a range of consecutive pairwise indices, given by
+    * a range of scalar indices, which can be used in a range-based for loop.
+    * Only the endpoints of the range are decoded.
+    */
+   class Index::Range
+   {
+   public:
+      /*!
+       * Construct a range of the scalar indices in [start, start + size).
+       *
+       * @param start
+       * @param size
+       */
+      Range(qint64 start, qint64 size): _begin(Index(start)), _end(Index(start + size)) {}
+      Iterator begin() const { return _begin; }
+      Iterator end() const { return _end; }
+   private:
+      /*!
+       * Iterator at the first pairwise index of the range.
+       */
+      Iterator _begin;
+      /*!
+       * Iterator one past the last pairwise index of the range.
+       */
+      Iterator _end;
+   };
 }
 
 
@@ -12,13 +12,19 @@ using namespace Pairwise;
 /*!
  * Return the index of the first byte in this data object after the end of
  * the data section. Defined as the size of the header and sub-header plus the
- * total size of all pairs.
+ * total size of all pairs, or in the chunked layout as the end of the row
+ * table.
  */
 qint64 Matrix::dataEnd() const
 {
    EDEBUG_FUNC(this);
 
-   return _headerSize + _subHeaderSize + _clusterSize * (_dataSize + _itemHeaderSize);
+   if ( _chunked )
+   {
+      return _chunkEnd + sizeof(qint32) + _chunks.size() * _chunkEntrySize + _rows.size() * _rowEntrySize;
+   }
+
+   return dataStart() + _clusterSize * (_dataSize + _itemHeaderSize);
 }
 
 
@@ -39,8 +45,25 @@ void Matrix::readData()
    // read the header
    stream() >> _geneSize >> _maxClusterSize >> _dataSize >> _pairSize >> _clusterSize >> _subHeaderSize;
 
+   // read the position of the chunk directory if the matrix is chunked
+   _chunked = (_dataSize < 0);
+   _chunks.clear();
+   _rows.clear();
+
+   if ( _chunked )
+   {
+      _dataSize = -_dataSize;
+      stream() >> _chunkEnd;
+   }
+
    // read the sub-header
    readHeader();
+
+   // read the chunk directory and the row table
+   if ( _chunked )
+   {
+      readDirectory();
+   }
 }
 
 
@@ -75,17 +98,33 @@ void Matrix::writeNewData()
 
 /*!
  * Finalize this data object's data after the analytic that created it has
- * finished giving it new data.
+ * finished giving it new data. In the chunked layout, the last chunk, the
+ * chunk directory and the row table are written before the header.
  */
 void Matrix::finish()
 {
    EDEBUG_FUNC(this);
 
+   // write the last chunk, the chunk directory and the row table
+   if ( _chunked )
+   {
+      writeChunk();
+      writeDirectory();
+   }
+
    // seek to the beginning of the data
    seek(0);
 
-   // write the header
-   stream() << _geneSize << _maxClusterSize << _dataSize << _pairSize << _clusterSize << _subHeaderSize;
+   // write the header, with a negative data size and the position of the
+   // chunk directory in the chunked layout
+   if ( _chunked )
+   {
+      stream() << _geneSize << _maxClusterSize << -_dataSize << _pairSize << _clusterSize << _subHeaderSize << _chunkEnd;
+   }
+   else
+   {
+      stream() << _geneSize << _maxClusterSize << _dataSize << _pairSize << _clusterSize << _subHeaderSize;
+   }
 
    // write the sub-header
    writeHeader();
@@ -111,9 +150,93 @@ EMetaArray Matrix::geneNames() const
 
 
 
+/*!
+ * Write pairs which are already encoded in the record layout of this matrix
+ * to the chunks of the data object, given the x and y index and the number of
+ * clusters of each pair. The records of the pairs follow each other in the
+ * given data, so each pair is written as its index followed by a single copy
+ * of its records, and a chunk is written to the data object file once it is
+ * full. Pairs without any clusters are not stored.
+ *
+ * @param indices
+ * @param clusterSizes
+ * @param pairSize
+ * @param data
+ */
+void Matrix::writeRecords(const qint32* indices, const qint8* clusterSizes, int pairSize, const char* data)
+{
+   EDEBUG_FUNC(this,indices,clusterSizes,pairSize,&data);
+
+   // make sure the matrix is stored in the chunked layout
+   if ( !_chunked )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Pairwise Matrix Logical Error"));
+      e.setDetails(tr("Encoded records can only be written in the chunked layout."));
+      throw e;
+   }
+
+   int i = 0;
+
+   while ( i < pairSize )
+   {
+      // encode pairs at the end of the current chunk until it is full
+      {
+         QDataStream stream(&_chunkData, QIODevice::WriteOnly | QIODevice::Append);
+         prepareStream(stream);
+
+         for ( ; i < pairSize && _chunkData.size() < CHUNK_SIZE; ++i )
+         {
+            qint8 clusterSize {clusterSizes[i]};
+
+            if ( clusterSize == 0 )
+            {
+               continue;
+            }
+
+            // make sure cluster size of pair does not exceed max
+            if ( clusterSize > _maxClusterSize )
+            {
+               E_MAKE_EXCEPTION(e);
+               e.setTitle(tr("Pairwise Logical Error"));
+               e.setDetails(tr("Cannot write pair with cluster size %1 exceeding the max of %2.")
+                  .arg(clusterSize)
+                  .arg(_maxClusterSize));
+               throw e;
+            }
+
+            // write the index and the records of the pair
+            Index index {Index::fromUnchecked(indices[2 * i], indices[2 * i + 1])};
+            qint8 records {recordSize(clusterSize)};
+            int size {records * _dataSize};
+
+            writeIndex(stream, index, records);
+            stream.writeRawData(data, size);
+            data += size;
+
+            // increment pair size and cluster size of data object
+            ++_pairSize;
+            _clusterSize += clusterSize;
+         }
+      }
+
+      // write the chunk if it is full
+      if ( _chunkData.size() >= CHUNK_SIZE )
+      {
+         writeChunk();
+      }
+   }
+}
+
+
+
+
+
+
 /*!
  * Initialize this pairwise matrix with a list of gene names, the max cluster
- * size, the pairwise data size, and the sub-header size.
+ * size, the pairwise data size, and the sub-header size. New matrices are
+ * stored in the chunked layout.
  *
  * @param geneNames
  * @param maxClusterSize
@@ -163,6 +286,14 @@ void Matrix::initialize(const EMetaArray& geneNames, qint32 maxClusterSize, qint
    _pairSize = 0;
    _clusterSize = 0;
    _lastWrite = -1;
+
+   // initialize the chunked layout
+   _chunked = true;
+   _chunks.clear();
+   _rows.clear();
+   _chunkEnd = dataStart();
+   _chunkData.clear();
+   _chunkPairSize = 0;
 }
 
 
@@ -191,22 +322,24 @@ void Matrix::write(const Index& index, qint8 cluster)
 
    // make sure the new pair has a higher indent than the previous written so the list of
    // all indents are sorted
-   if ( index.indent(cluster) <= _lastWrite )
+   qint64 indent {index.indent(cluster)};
+
+   if ( indent <= _lastWrite )
    {
       E_MAKE_EXCEPTION(e);
       e.setTitle(tr("Pairwise Matrix Logical Error"));
       e.setDetails(tr("Attempting to write indent %1 when last written is %2.")
-                   .arg(index.indent(0)).arg(_lastWrite));
+                   .arg(indent).arg(_lastWrite));
       throw e;
    }
 
    // seek to position for next pair and write indent value
-   seek(_headerSize + _subHeaderSize + _clusterSize * (_dataSize + _itemHeaderSize));
+   seek(dataStart() + _clusterSize * (_dataSize + _itemHeaderSize));
    stream() << index.getX() << index.getY() << cluster;
 
    // increment cluster size and set new last index
    ++_clusterSize;
-   _lastWrite = index.indent(cluster);
+   _lastWrite = indent;
 }
 
 
@@ -260,10 +393,10 @@ qint64 Matrix::findPair(qint64 indent, qint64 first, qint64 last) const
    qint32 geneY;
    qint8 cluster;
    stream() >> geneX >> geneY >> cluster;
-   Index index(geneX,geneY);
+   qint64 pivotIndent {Index::fromUnchecked(geneX,geneY).indentUnchecked(cluster)};
 
    // if indent values match return index
-   if ( index.indent(cluster) == indent )
+   if ( pivotIndent == indent )
    {
       return pivot;
    }
@@ -272,7 +405,7 @@ qint64 Matrix::findPair(qint64 indent, qint64 first, qint64 last) const
    // to divide and conquer depending on the value of the pivot
    else if ( first != last )
    {
-      if ( index.indent(cluster) > indent )
+      if ( pivotIndent > indent )
       {
          // if pivot is first add one so pivot is not less than first when passed
          if ( pivot == first )
@@ -324,5 +457,392 @@ void Matrix::seekPair(qint64 index) const
    }
 
    // seek to the specified index
-   seek(_headerSize + _subHeaderSize + index * (_dataSize + _itemHeaderSize));
+   seek(dataStart() + index * (_dataSize + _itemHeaderSize));
+}
+
+
+
+
+
+
+/*!
+ * Prepare a data stream for the data of a chunk, so that every chunk is
+ * encoded in the same way regardless of the platform.
+ *
+ * @param stream
+ */
+void Matrix::prepareStream(QDataStream& stream)
+{
+   stream.setByteOrder(QDataStream::LittleEndian);
+   stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+}
+
+
+
+
+
+
+/*!
+ * Write an unsigned integer to a data stream as a variable-length integer,
+ * which uses one byte for each 7 bits of the value.
+ *
+ * @param stream
+ * @param value
+ */
+void Matrix::writeVarint(QDataStream& stream, quint32 value)
+{
+   while ( value >= 0x80 )
+   {
+      stream << static_cast<quint8>(value | 0x80);
+      value >>= 7;
+   }
+
+   stream << static_cast<quint8>(value);
+}
+
+
+
+
+
+
+/*!
+ * Read a variable-length unsigned integer from a data stream.
+ *
+ * @param stream
+ */
+quint32 Matrix::readVarint(QDataStream& stream)
+{
+   quint32 value {0};
+   int shift {0};
+   quint8 byte;
+
+   do
+   {
+      stream >> byte;
+      value |= static_cast<quint32>(byte & 0x7F) << shift;
+      shift += 7;
+   }
+   while ( (byte & 0x80) && shift < 35 );
+
+   return value;
+}
+
+
+
+
+
+
+/*!
+ * Write the pairwise index and the number of records of a new pair to the
+ * chunk which is being written. The row index is encoded as the difference
+ * from the row of the previous pair in the chunk, and the column index is
+ * encoded as the difference from the column of the previous pair if both
+ * pairs are in the same row. If the pair is the first pair of its row, it is
+ * also added to the row table.
+ *
+ * @param stream
+ * @param index
+ * @param recordSize
+ */
+void Matrix::writeIndex(QDataStream& stream, const Index& index, qint8 recordSize)
+{
+   EDEBUG_FUNC(this,&stream,&index,recordSize);
+
+   // make sure this is new data object that can be written to
+   if ( _lastWrite == -2 )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Pairwise Matrix Logical Error"));
+      e.setDetails(tr("Attempting to write data to uninitialized object."));
+      throw e;
+   }
+
+   // make sure the new pair has a higher indent than the previous written so the list of
+   // all indents are sorted
+   qint64 indent {index.indent(0)};
+
+   if ( indent <= _lastWrite )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Pairwise Matrix Logical Error"));
+      e.setDetails(tr("Attempting to write indent %1 when last written is %2.")
+                   .arg(indent).arg(_lastWrite));
+      throw e;
+   }
+
+   // add a new chunk to the directory if this is the first pair of the chunk,
+   // which is encoded from the origin
+   if ( _chunkPairSize == 0 )
+   {
+      Chunk chunk;
+      chunk.offset = _chunkEnd;
+      chunk.size = 0;
+      chunk.codec = Codec::None;
+      chunk.pairSize = 0;
+      chunk.first = _chunks.isEmpty() ? 0 : _chunks.last().first + _chunks.last().pairSize;
+      chunk.index = index;
+
+      _chunks.append(chunk);
+      _chunkIndex = Index::fromUnchecked(0, 0);
+   }
+
+   // add an entry to the row table for each row up to the row of this pair
+   while ( _rows.size() <= index.getX() )
+   {
+      Row row;
+      row.chunk = _chunks.size() - 1;
+      row.offset = _chunkData.size();
+      row.previous = _chunkIndex.getX();
+      row.first = _chunks.last().first + _chunkPairSize;
+
+      _rows.append(row);
+   }
+
+   // write the delta-encoded index and the number of records
+   qint32 dx {index.getX() - _chunkIndex.getX()};
+   qint32 y {(dx == 0) ? index.getY() - _chunkIndex.getY() : index.getY()};
+
+   writeVarint(stream, dx);
+   writeVarint(stream, y);
+   stream << recordSize;
+
+   // update the chunk and set new last index
+   ++_chunkPairSize;
+   _chunkIndex = index;
+   _lastWrite = indent;
+}
+
+
+
+
+
+
+/*!
+ * Compress the chunk which is being written and write it to the data object
+ * file, and complete its entry in the chunk directory. The chunk is stored
+ * uncompressed if compression does not reduce its size. Chunks are written
+ * as 64-bit words, so the stored chunk is padded to a multiple of 8 bytes.
+ */
+void Matrix::writeChunk()
+{
+   EDEBUG_FUNC(this);
+
+   // make sure the chunk is not empty
+   if ( _chunkPairSize == 0 )
+   {
+      return;
+   }
+
+   // compress the chunk
+   QByteArray data {qCompress(_chunkData)};
+   Codec codec {Codec::Zlib};
+
+   if ( data.size() >= _chunkData.size() )
+   {
+      data = _chunkData;
+      codec = Codec::None;
+   }
+
+   // complete the directory entry of the chunk
+   Chunk& chunk {_chunks.last()};
+   chunk.size = data.size();
+   chunk.codec = codec;
+   chunk.pairSize = _chunkPairSize;
+
+   // write the chunk as 64-bit words
+   int wordSize {(data.size() + 7) / 8};
+   data.append(QByteArray(wordSize * 8 - data.size(), '\0'));
+
+   seek(_chunkEnd);
+
+   for ( int i = 0; i < wordSize; ++i )
+   {
+      qint64 word;
+      memcpy(&word, data.constData() + i * 8, sizeof(word));
+      stream() << word;
+   }
+
+   // start a new chunk
+   _chunkEnd += wordSize * 8;
+   _chunkData.clear();
+   _chunkPairSize = 0;
+}
+
+
+
+
+
+
+/*!
+ * Write the chunk directory and the row table to the data object file after
+ * the last chunk. The rows after the last pair are added to the row table
+ * first.
+ */
+void Matrix::writeDirectory()
+{
+   EDEBUG_FUNC(this);
+
+   // add an entry for each row after the last pair
+   while ( _rows.size() < _geneSize )
+   {
+      Row row;
+      row.chunk = _chunks.size();
+      row.offset = 0;
+      row.previous = 0;
+      row.first = _pairSize;
+
+      _rows.append(row);
+   }
+
+   seek(_chunkEnd);
+   stream() << static_cast<qint32>(_chunks.size());
+
+   for ( const auto& chunk : _chunks )
+   {
+      stream()
+         << chunk.offset
+         << chunk.size
+         << static_cast<qint8>(chunk.codec)
+         << chunk.pairSize
+         << chunk.index.getX()
+         << chunk.index.getY();
+   }
+
+   for ( const auto& row : _rows )
+   {
+      stream() << row.chunk << row.offset << row.previous << row.first;
+   }
+}
+
+
+
+
+
+
+/*!
+ * Read the chunk directory and the row table from the data object file.
+ */
+void Matrix::readDirectory()
+{
+   EDEBUG_FUNC(this);
+
+   seek(_chunkEnd);
+
+   qint32 size;
+   stream() >> size;
+
+   _chunks.resize(size);
+
+   qint64 first {0};
+
+   for ( auto& chunk : _chunks )
+   {
+      qint8 codec;
+      qint32 x;
+      qint32 y;
+
+      stream()
+         >> chunk.offset
+         >> chunk.size
+         >> codec
+         >> chunk.pairSize
+         >> x
+         >> y;
+
+      chunk.codec = static_cast<Codec>(codec);
+      chunk.first = first;
+      chunk.index = Index::fromUnchecked(x, y);
+
+      first += chunk.pairSize;
+   }
+
+   _rows.resize(_geneSize);
+
+   for ( auto& row : _rows )
+   {
+      stream() >> row.chunk >> row.offset >> row.previous >> row.first;
+   }
+}
+
+
+
+
+
+
+/*!
+ * Read a chunk from the data object file and return its uncompressed data.
+ *
+ * @param chunk
+ */
+QByteArray Matrix::readChunk(int chunk) const
+{
+   EDEBUG_FUNC(this,chunk);
+
+   // read the chunk as 64-bit words
+   const Chunk& entry {_chunks.at(chunk)};
+   int wordSize {(entry.size + 7) / 8};
+   QByteArray data(wordSize * 8, '\0');
+
+   seek(entry.offset);
+
+   for ( int i = 0; i < wordSize; ++i )
+   {
+      qint64 word;
+      stream() >> word;
+      memcpy(data.data() + i * 8, &word, sizeof(word));
+   }
+
+   data.resize(entry.size);
+
+   // uncompress the chunk
+   if ( entry.codec == Codec::Zlib )
+   {
+      data = qUncompress(data);
+
+      if ( data.isEmpty() )
+      {
+         E_MAKE_EXCEPTION(e);
+         e.setTitle(tr("File IO Error"));
+         e.setDetails(tr("Failed to uncompress chunk %1.").arg(chunk));
+         throw e;
+      }
+   }
+
+   return data;
+}
+
+
+
+
+
+
+/*!
+ * Return the chunk which contains the pair with the given pairwise index if
+ * it is in the matrix, which is the last chunk whose first pair is not after
+ * the given pair. Returns -1 if the pair is before the first chunk.
+ *
+ * @param index
+ */
+int Matrix::findChunk(const Index& index) const
+{
+   EDEBUG_FUNC(this,&index);
+
+   int first {0};
+   int last {_chunks.size()};
+
+   while ( first < last )
+   {
+      int pivot {first + (last - first) / 2};
+
+      if ( _chunks.at(pivot).index <= index )
+      {
+         first = pivot + 1;
+      }
+      else
+      {
+         last = pivot;
+      }
+   }
+
+   return first - 1;
 }
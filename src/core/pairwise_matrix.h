@@ -17,11 +17,25 @@ namespace Pairwise
     * This class stores matrix data as an ordered list of indexed pairs; therefore,
     * pairwise data must be written in order and it should be sparse for the
     * storage format to be efficient.
+    *
+    * New matrices are stored in the chunked layout, in which pairs are grouped
+    * into chunks of about CHUNK_SIZE bytes. Within a chunk, the row and column
+    * index of each pair are delta-encoded as variable-length integers and the
+    * clusters of each pair follow its index, and each chunk is compressed
+    * independently. A directory at the end of the file stores the position,
+    * size and first pair of each chunk, so that pairs can be streamed chunk by
+    * chunk or found with a binary search over the chunks. The directory is
+    * followed by a row table which stores the position of the first pair of
+    * each row within its chunk, so that a pair is found by decoding only the
+    * pairs before it in the same row. Matrices which were
+    * written in the older fixed layout, in which every cluster is a record of
+    * fixed size, are still read.
     */
    class Matrix : public EAbstractData
    {
    public:
       class Pair;
+      class Cursor;
    public:
       virtual qint64 dataEnd() const override final;
       virtual void readData() override final;
@@ -31,22 +45,155 @@ namespace Pairwise
       qint32 geneSize() const { return _geneSize; }
       qint32 maxClusterSize() const { return _maxClusterSize; }
       qint64 size() const { return _pairSize; }
+      /*!
+       * Return whether the matrix is stored in the chunked layout, in which
+       * case it can be read with a cursor.
+       */
+      bool isChunked() const { return _chunked; }
       EMetaArray geneNames() const;
+      void writeRecords(const qint32* indices, const qint8* clusterSizes, int pairSize, const char* data);
    protected:
       virtual void writeHeader() = 0;
       virtual void readHeader() = 0;
+      /*!
+       * Return the number of records which are stored for a pair with the
+       * given number of clusters. By default each cluster is stored as a
+       * separate record, but an inheriting class may store every cluster of a
+       * pair in a single record.
+       *
+       * @param clusterSize
+       */
+      virtual qint8 recordSize(qint8 clusterSize) const { return clusterSize; }
       void initialize(const EMetaArray& geneNames, qint32 maxClusterSize, qint32 dataSize, qint16 subHeaderSize);
+      /*!
+       * Return the size (in bytes) of the sub-header of this matrix, which may
+       * be smaller than the current sub-header size for files written by an
+       * older version.
+       */
+      qint16 subHeaderSize() const { return _subHeaderSize; }
    private:
+      /*!
+       * Defines the codecs which can be used to compress a chunk.
+       */
+      enum class Codec : qint8
+      {
+         /*!
+          * The chunk is not compressed.
+          */
+         None
+         /*!
+          * The chunk is compressed with zlib.
+          */
+         ,Zlib
+      };
+      /*!
+       * Defines an entry of the chunk directory.
+       */
+      struct Chunk
+      {
+         /*!
+          * The position of the chunk in the data object file.
+          */
+         qint64 offset;
+         /*!
+          * The size (in bytes) of the chunk as it is stored in the file.
+          */
+         qint32 size;
+         /*!
+          * The codec with which the chunk is compressed.
+          */
+         Codec codec;
+         /*!
+          * The number of pairs in the chunk.
+          */
+         qint32 pairSize;
+         /*!
+          * The position of the first pair of the chunk among all pairs.
+          */
+         qint64 first;
+         /*!
+          * The pairwise index of the first pair of the chunk.
+          */
+         Index index;
+      };
+      /*!
+       * Defines an entry of the row table, which refers to the first pair of
+       * a row, or to the first pair after the row if the row has no pairs.
+       */
+      struct Row
+      {
+         /*!
+          * The chunk which contains the pair, or the number of chunks if
+          * there are no pairs after the row.
+          */
+         qint32 chunk;
+         /*!
+          * The position of the pair within its uncompressed chunk.
+          */
+         qint32 offset;
+         /*!
+          * The row index of the previous pair in the chunk, from which the
+          * index of the pair is decoded, or 0 if it is the first pair of the
+          * chunk.
+          */
+         qint32 previous;
+         /*!
+          * The position of the pair among all pairs.
+          */
+         qint64 first;
+      };
       void write(const Index& index, qint8 cluster);
       Index getPair(qint64 index, qint8* cluster) const;
       qint64 findPair(qint64 indent, qint64 first, qint64 last) const;
       void seekPair(qint64 index) const;
+      static void prepareStream(QDataStream& stream);
+      static void writeVarint(QDataStream& stream, quint32 value);
+      static quint32 readVarint(QDataStream& stream);
+      void writeIndex(QDataStream& stream, const Index& index, qint8 recordSize);
+      void writeChunk();
+      void writeDirectory();
+      void readDirectory();
+      QByteArray readChunk(int chunk) const;
+      int findChunk(const Index& index) const;
+      /*!
+       * Return the position of the first pair in the data object file.
+       */
+      qint64 dataStart() const { return (_chunked ? _chunkedHeaderSize : _headerSize) + _subHeaderSize; }
+      /*!
+       * Return the number of records which can be read by a pairwise
+       * iterator, which is the number of clusters in the fixed layout and the
+       * number of pairs in the chunked layout.
+       */
+      qint64 recordCount() const { return _chunked ? _pairSize : _clusterSize; }
       /*!
        * The size (in bytes) of the header at the beginning of the file. The header
        * consists of the gene size, max cluster size, pairwise data size, total
        * number of pairs, total number of clusters, and sub-header offset.
        */
       constexpr static int _headerSize {30};
+      /*!
+       * The size (in bytes) of the header in the chunked layout, which has
+       * the position of the chunk directory after the header of the fixed
+       * layout. The chunked layout is denoted by a negative data size.
+       */
+      constexpr static int _chunkedHeaderSize {38};
+      /*!
+       * The size (in bytes) of an entry of the chunk directory, which
+       * consists of the position, size, codec, pair size, and the row and
+       * column index of the first pair of a chunk.
+       */
+      constexpr static int _chunkEntrySize {25};
+      /*!
+       * The size (in bytes) of an entry of the row table, which consists of
+       * the chunk, offset, previous row, and position of the first pair of a
+       * row.
+       */
+      constexpr static int _rowEntrySize {20};
+      /*!
+       * The uncompressed size (in bytes) at which a chunk is written to the
+       * file.
+       */
+      constexpr static int CHUNK_SIZE {1 << 18};
       /*!
        * The size (in bytes) of the pairwise header. The item header size consists
        * of the row and column index of the pair.
@@ -81,6 +228,37 @@ namespace Pairwise
        * The index of the last pair that was written to the matrix.
        */
       qint64 _lastWrite {-2};
+      /*!
+       * Whether the matrix is stored in the chunked layout.
+       */
+      bool _chunked {false};
+      /*!
+       * The directory of chunks in the chunked layout.
+       */
+      QVector<Chunk> _chunks;
+      /*!
+       * The row table in the chunked layout, which has an entry for each gene
+       * once the matrix is finished.
+       */
+      QVector<Row> _rows;
+      /*!
+       * The position in the file after the last chunk, which is also the
+       * position of the chunk directory.
+       */
+      qint64 _chunkEnd {0};
+      /*!
+       * The uncompressed data of the chunk which is being written.
+       */
+      QByteArray _chunkData;
+      /*!
+       * The number of pairs in the chunk which is being written.
+       */
+      qint32 _chunkPairSize {0};
+      /*!
+       * The pairwise index of the last pair in the chunk which is being
+       * written, from which the index of the next pair is encoded.
+       */
+      Index _chunkIndex;
    };
 }
 
@@ -0,0 +1,113 @@
+#include "pairwise_matrix_cursor.h"
+
+
+
+using namespace Pairwise;
+
+
+
+
+
+
+/*!
+ * Construct a new cursor for the given pairwise matrix, which must be stored
+ * in the chunked layout. The cursor is placed before the first pair.
+ *
+ * @param matrix
+ */
+Matrix::Cursor::Cursor(const Matrix* matrix):
+   _matrix(matrix)
+{
+   EDEBUG_FUNC(this,matrix);
+
+   if ( !matrix->_chunked )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Pairwise Logical Error"));
+      e.setDetails(tr("Cannot read a pairwise matrix with a cursor unless it is stored in the chunked layout."));
+      throw e;
+   }
+}
+
+
+
+
+
+
+/*!
+ * Advance the cursor to the next pair, reading the next chunk from the data
+ * object file once every pair of the stored chunk has been read. Returns
+ * false if there are no more pairs.
+ */
+bool Matrix::Cursor::next()
+{
+   // read the next chunk if every pair of the stored chunk has been read
+   while ( _position == _end )
+   {
+      if ( _chunk + 1 >= _matrix->_chunks.size() )
+      {
+         return false;
+      }
+
+      _data = _matrix->readChunk(++_chunk);
+      _position = reinterpret_cast<const uchar*>(_data.constData());
+      _end = _position + _data.size();
+      _index = Index::fromUnchecked(0, 0);
+   }
+
+   // decode the pairwise index and the number of records
+   qint32 dx {static_cast<qint32>(readVarint())};
+   qint32 y {static_cast<qint32>(readVarint())};
+
+   if ( dx == 0 )
+   {
+      y += _index.getY();
+   }
+
+   _index = Index::fromUnchecked(_index.getX() + dx, y);
+   _recordSize = (_position < _end) ? static_cast<qint8>(*_position++) : 0;
+
+   // make sure the records of the pair are within the chunk
+   _records = _position;
+   _position += static_cast<qint64>(_recordSize) * _matrix->_dataSize;
+
+   if ( _recordSize < 1 || _recordSize > _matrix->_maxClusterSize || _position > _end )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("File IO Error"));
+      e.setDetails(tr("Reading pair failed because chunk %1 is invalid.").arg(_chunk));
+      throw e;
+   }
+
+   return true;
+}
+
+
+
+
+
+
+/*!
+ * Read a variable-length unsigned integer from the stored chunk.
+ */
+quint32 Matrix::Cursor::readVarint()
+{
+   quint32 value {0};
+   int shift {0};
+   quint8 byte {0};
+
+   do
+   {
+      if ( _position == _end )
+      {
+         break;
+      }
+
+      byte = *_position++;
+      value |= static_cast<quint32>(byte & 0x7F) << shift;
+      shift += 7;
+   }
+   while ( (byte & 0x80) && shift < 35 );
+
+   return value;
+}
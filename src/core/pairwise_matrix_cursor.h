@@ -0,0 +1,77 @@
+#ifndef PAIRWISE_MATRIX_CURSOR_H
+#define PAIRWISE_MATRIX_CURSOR_H
+#include "pairwise_matrix.h"
+
+
+
+namespace Pairwise
+{
+   /*!
+    * This class implements the raw cursor for a pairwise matrix which is
+    * stored in the chunked layout. The cursor iterates through each pair by
+    * decoding its uncompressed chunk directly, and it exposes the records of
+    * each pair as read-only views into the chunk, so pairs are read without
+    * any stream operations or virtual calls. Each record is the pairwise data
+    * element of the inheriting matrix, which is stored in little-endian byte
+    * order. The cursor stores only one chunk in memory at a time.
+    */
+   class Matrix::Cursor
+   {
+   public:
+      Cursor(const Matrix* matrix);
+   public:
+      bool next();
+      /*!
+       * Return the pairwise index of the current pair.
+       */
+      const Index& index() const { return _index; }
+      /*!
+       * Return the number of records of the current pair.
+       */
+      int recordSize() const { return _recordSize; }
+      /*!
+       * Return a view of a record of the current pair.
+       *
+       * @param record
+       */
+      const uchar* record(int record) const { return _records + record * _matrix->_dataSize; }
+   private:
+      quint32 readVarint();
+      /*!
+       * Constant pointer to the parent pairwise matrix.
+       */
+      const Matrix* _matrix;
+      /*!
+       * The chunk which is stored by the cursor, or -1 if no chunk is stored.
+       */
+      int _chunk {-1};
+      /*!
+       * The uncompressed data of the stored chunk.
+       */
+      QByteArray _data;
+      /*!
+       * Pointer to the next pair in the stored chunk.
+       */
+      const uchar* _position {nullptr};
+      /*!
+       * Pointer to the end of the stored chunk.
+       */
+      const uchar* _end {nullptr};
+      /*!
+       * The pairwise index of the current pair.
+       */
+      Index _index;
+      /*!
+       * The number of records of the current pair.
+       */
+      int _recordSize {0};
+      /*!
+       * Pointer to the first record of the current pair.
+       */
+      const uchar* _records {nullptr};
+   };
+}
+
+
+
+#endif
@@ -30,8 +30,15 @@ void Matrix::Pair::write(const Index& index)
       throw e;
    }
 
-   // go through each cluster and write it to data object
-   for ( qint8 i = 0; i < clusterSize(); ++i )
+   // write the pair to the current chunk in the chunked layout
+   if ( _matrix->_chunked )
+   {
+      writeChunked(index);
+      return;
+   }
+
+   // go through each record of the pair and write it to data object
+   for ( qint8 i = 0; i < recordSize(); ++i )
    {
       _matrix->write(index,i);
       writeCluster(_matrix->stream(),i);
@@ -58,6 +65,13 @@ void Matrix::Pair::read(const Index& index) const
    // clear any existing clusters
    clearClusters();
 
+   // find the pair in its chunk in the chunked layout
+   if ( _cMatrix->_chunked )
+   {
+      readChunked(index);
+      return;
+   }
+
    // attempt to find cluster index within data object
    qint64 clusterIndex;
    if ( _cMatrix->_clusterSize > 0
@@ -81,6 +95,13 @@ void Matrix::Pair::readNext() const
 {
    EDEBUG_FUNC(this);
 
+   // read the next pair from its chunk in the chunked layout
+   if ( _cMatrix->_chunked )
+   {
+      readNextChunked();
+      return;
+   }
+
    // make sure read next index is not already at end of data object
    if ( _rawIndex < _cMatrix->_clusterSize )
    {
@@ -136,3 +157,269 @@ void Matrix::Pair::readNext() const
       }
    }
 }
+
+
+
+
+
+
+/*!
+ * Write the iterator's pairwise data to the current chunk of the data object
+ * with the given pairwise index. The chunk is written to the data object file
+ * once it is full. Pairs without any clusters are not stored.
+ *
+ * @param index
+ */
+void Matrix::Pair::writeChunked(const Index& index)
+{
+   EDEBUG_FUNC(this,&index);
+
+   // make sure the pair has clusters
+   if ( clusterSize() == 0 )
+   {
+      return;
+   }
+
+   // encode the pair at the end of the current chunk
+   {
+      QDataStream stream(&_matrix->_chunkData, QIODevice::WriteOnly | QIODevice::Append);
+      Matrix::prepareStream(stream);
+
+      _matrix->writeIndex(stream, index, recordSize());
+
+      for ( qint8 i = 0; i < recordSize(); ++i )
+      {
+         writeCluster(stream, i);
+      }
+   }
+
+   // increment pair size and cluster size of data object
+   ++(_matrix->_pairSize);
+   _matrix->_clusterSize += clusterSize();
+
+   // write the chunk if it is full
+   if ( _matrix->_chunkData.size() >= CHUNK_SIZE )
+   {
+      _matrix->writeChunk();
+   }
+}
+
+
+
+
+
+
+/*!
+ * Read the pair with the given pairwise index from its chunk. The pairs before
+ * it in the same row are decoded, starting from the first pair of the row
+ * from the row table, or from the last pair which was read if the given pair
+ * is after it in the stored chunk. The chunk is read from the data object file
+ * only if it is not stored. If the pair is not found the iterator has no
+ * clusters and is placed at the first pair after the given index.
+ *
+ * @param index
+ */
+void Matrix::Pair::readChunked(const Index& index) const
+{
+   EDEBUG_FUNC(this,&index);
+
+   // find the chunk which may contain the pair
+   int chunk {_cMatrix->findChunk(index)};
+
+   if ( chunk == -1 )
+   {
+      return;
+   }
+
+   // return if there are no pairs in or after the row of the pair
+   const Row& row {_cMatrix->_rows.at(index.getX())};
+
+   if ( row.chunk == _cMatrix->_chunks.size() )
+   {
+      _rawIndex = row.first;
+      _chunk = -1;
+      return;
+   }
+
+   // determine the first pair to decode, which is the first pair of the row
+   // if the row starts in this chunk or otherwise the first pair of the chunk
+   qint64 first {(row.chunk == chunk) ? row.first : _cMatrix->_chunks.at(chunk).first};
+
+   // start from the first pair unless the pair is ahead of the last pair
+   // which was read from the stored chunk
+   if ( chunk != _chunk || index <= _chunkIndex || _rawIndex < first )
+   {
+      loadChunk(chunk);
+
+      if ( row.chunk == chunk )
+      {
+         _chunkOffset = row.offset;
+         _chunkIndex = Index::fromUnchecked(row.previous, 0);
+         _rawIndex = row.first;
+      }
+   }
+
+   // decode pairs until the given pair is reached
+   const Chunk& entry {_cMatrix->_chunks.at(chunk)};
+   QDataStream stream(_chunkData);
+   Matrix::prepareStream(stream);
+   stream.device()->seek(_chunkOffset);
+
+   while ( _rawIndex < entry.first + entry.pairSize )
+   {
+      // save the position of the next pair
+      qint64 offset {_chunkOffset};
+      Index chunkIndex {_chunkIndex};
+
+      readPair(stream);
+
+      // return if the pair was found
+      if ( _index == index )
+      {
+         return;
+      }
+
+      // otherwise return to the position of the next pair if it is after
+      // the given pair
+      if ( index < _index )
+      {
+         clearClusters();
+         --_rawIndex;
+         _chunkOffset = offset;
+         _chunkIndex = chunkIndex;
+         return;
+      }
+   }
+
+   // the pair was not found
+   clearClusters();
+}
+
+
+
+
+
+
+/*!
+ * Read the next pair from its chunk, reading the next chunk from the data
+ * object file once every pair of the stored chunk has been read.
+ */
+void Matrix::Pair::readNextChunked() const
+{
+   EDEBUG_FUNC(this);
+
+   // make sure read next index is not already at end of data object
+   if ( _rawIndex >= _cMatrix->_pairSize )
+   {
+      return;
+   }
+
+   // read the chunk which contains the next pair if it is not stored
+   const auto& chunks {_cMatrix->_chunks};
+
+   if ( _chunk == -1 || _rawIndex >= chunks.at(_chunk).first + chunks.at(_chunk).pairSize )
+   {
+      // find the chunk which contains the next pair
+      int chunk {(_chunk == -1) ? 0 : _chunk + 1};
+
+      while ( _rawIndex >= chunks.at(chunk).first + chunks.at(chunk).pairSize )
+      {
+         ++chunk;
+      }
+
+      // read the chunk and skip to the next pair
+      qint64 rawIndex {_rawIndex};
+
+      loadChunk(chunk);
+
+      while ( _rawIndex < rawIndex )
+      {
+         readNextChunked();
+      }
+   }
+
+   // decode the next pair
+   QDataStream stream(_chunkData);
+   Matrix::prepareStream(stream);
+   stream.device()->seek(_chunkOffset);
+
+   readPair(stream);
+}
+
+
+
+
+
+
+/*!
+ * Read a chunk from the data object file and store it in this iterator, unless
+ * it is already stored. The iterator is placed at the first pair of the chunk.
+ *
+ * @param chunk
+ */
+void Matrix::Pair::loadChunk(int chunk) const
+{
+   EDEBUG_FUNC(this,chunk);
+
+   if ( chunk != _chunk )
+   {
+      _chunkData = _cMatrix->readChunk(chunk);
+      _chunk = chunk;
+   }
+
+   _chunkOffset = 0;
+   _chunkIndex = Index::fromUnchecked(0, 0);
+   _rawIndex = _cMatrix->_chunks.at(chunk).first;
+}
+
+
+
+
+
+
+/*!
+ * Decode the next pair of the stored chunk from a data stream which is
+ * placed at the pair, and advance the iterator to the following pair.
+ *
+ * @param stream
+ */
+void Matrix::Pair::readPair(QDataStream& stream) const
+{
+   // clear any existing clusters
+   clearClusters();
+
+   // decode the pairwise index and the number of records
+   qint32 dx {static_cast<qint32>(Matrix::readVarint(stream))};
+   qint32 y {static_cast<qint32>(Matrix::readVarint(stream))};
+   qint8 recordSize;
+
+   stream >> recordSize;
+
+   if ( dx == 0 )
+   {
+      y += _chunkIndex.getY();
+   }
+
+   _index = Index::fromUnchecked(_chunkIndex.getX() + dx, y);
+
+   // make sure the pair is valid
+   if ( stream.status() != QDataStream::Ok || recordSize < 1 || recordSize > _cMatrix->_maxClusterSize )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("File IO Error"));
+      e.setDetails(tr("Reading pair failed because chunk %1 is invalid.").arg(_chunk));
+      throw e;
+   }
+
+   // read in each record of the pair
+   for ( qint8 i = 0; i < recordSize; ++i )
+   {
+      addCluster();
+      readCluster(stream, i);
+   }
+
+   // advance to the next pair
+   _chunkOffset = stream.device()->pos();
+   _chunkIndex = _index;
+   ++_rawIndex;
+}
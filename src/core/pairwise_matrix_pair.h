@@ -10,7 +10,9 @@ namespace Pairwise
     * This class implements the pairwise iterator for the pairwise matrix
     * data object. The pairwise iterator can read from or write to any pair in
     * the pairwise matrix, or it can simply iterate through each pair. The
-    * iterator stores only one pair in memory at a time.
+    * iterator stores only one pair in memory at a time, and in the chunked
+    * layout it also stores the uncompressed chunk which contains that pair,
+    * so that the following pairs of the chunk are read from memory.
     */
    class Matrix::Pair
    {
@@ -33,16 +35,29 @@ namespace Pairwise
       virtual bool isEmpty() const = 0;
       void write(const Index& index);
       void read(const Index& index) const;
-      void reset() const { _rawIndex = 0; }
+      void reset() const { _rawIndex = 0; _chunk = -1; }
       void readNext() const;
-      bool hasNext() const { return _rawIndex != _cMatrix->_clusterSize; }
+      bool hasNext() const { return _rawIndex != _cMatrix->recordCount(); }
       const Index& index() const { return _index; }
       Pair& operator=(const Pair&) = default;
       Pair& operator=(Pair&&) = default;
    protected:
+      /*!
+       * Return the number of records which are written for this pair. By
+       * default each cluster is written as a separate record, but an
+       * inheriting class may write every cluster of a pair in a single record.
+       */
+      virtual int recordSize() const { return clusterSize(); }
       virtual void writeCluster(EDataStream& stream, int cluster) = 0;
       virtual void readCluster(const EDataStream& stream, int cluster) const = 0;
+      virtual void writeCluster(QDataStream& stream, int cluster) = 0;
+      virtual void readCluster(QDataStream& stream, int cluster) const = 0;
    private:
+      void writeChunked(const Index& index);
+      void readChunked(const Index& index) const;
+      void readNextChunked() const;
+      void loadChunk(int chunk) const;
+      void readPair(QDataStream& stream) const;
       /*!
        * Pointer to the parent pairwise matrix.
        */
@@ -59,6 +74,24 @@ namespace Pairwise
        * Pairwise index corresponding to the iterator's position.
        */
       mutable Index _index;
+      /*!
+       * The chunk which is stored by the iterator in the chunked layout, or
+       * -1 if no chunk is stored.
+       */
+      mutable int _chunk {-1};
+      /*!
+       * The uncompressed data of the stored chunk.
+       */
+      mutable QByteArray _chunkData;
+      /*!
+       * The position in the stored chunk of the next pair.
+       */
+      mutable qint64 _chunkOffset {0};
+      /*!
+       * The pairwise index of the last pair which was decoded from the
+       * stored chunk, from which the index of the next pair is decoded.
+       */
+      mutable Index _chunkIndex;
    };
 }
 
@@ -15,13 +15,15 @@ using namespace Pairwise;
  * @param x
  * @param y
  * @param labels
+ * @param N
  * @param cluster
  * @param minSamples
  */
 float Pearson::computeCluster(
    const float *x,
    const float *y,
-   const QVector<qint8>& labels,
+   const qint8 *labels,
+   int N,
    qint8 cluster,
    int minSamples)
 {
@@ -33,7 +35,7 @@ float Pearson::computeCluster(
    float sumy2 = 0;
    float sumxy = 0;
 
-   for ( int i = 0; i < labels.size(); ++i )
+   for ( int i = 0; i < N; ++i )
    {
       if ( labels[i] == cluster )
       {
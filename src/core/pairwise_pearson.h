@@ -13,7 +13,8 @@ namespace Pairwise
       virtual float computeCluster(
          const float *x,
          const float *y,
-         const QVector<qint8>& labels,
+         const qint8 *labels,
+         int N,
          qint8 cluster,
          int minSamples
       ) override final;
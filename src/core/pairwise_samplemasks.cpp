@@ -0,0 +1,177 @@
+#include "pairwise_samplemasks.h"
+
+
+
+using namespace Pairwise;
+
+
+
+
+
+
+/*!
+ * Construct empty sample validity masks for an expression matrix with the
+ * given size, whose genes are then computed with compute().
+ *
+ * @param geneSize
+ * @param sampleSize
+ */
+SampleMasks::SampleMasks(int geneSize, int sampleSize):
+   _sampleSize(sampleSize),
+   _words((sampleSize + 63) / 64),
+   _missing(static_cast<size_t>(geneSize) * _words, 0),
+   _threshold(static_cast<size_t>(geneSize) * _words, 0)
+{
+}
+
+
+
+
+
+
+/*!
+ * Construct the sample validity masks of an expression matrix which is given
+ * as a row-major array of gene expressions.
+ *
+ * @param expressions
+ * @param geneSize
+ * @param sampleSize
+ * @param minExpression
+ */
+SampleMasks::SampleMasks(const float *expressions, int geneSize, int sampleSize, float minExpression):
+   SampleMasks(geneSize, sampleSize)
+{
+   compute(expressions, 0, geneSize, minExpression);
+}
+
+
+
+
+
+
+/*!
+ * Compute the sample validity masks of a range of genes of an expression
+ * matrix which is given as a row-major array of gene expressions, of which
+ * only the given genes are read. Samples which are NAN are marked in the
+ * missing plane, and samples which are below the given minimum expression are
+ * marked in the threshold plane. The bits after the last sample of each gene
+ * are marked as missing, so that they are never counted as clean samples.
+ *
+ * @param expressions
+ * @param geneStart
+ * @param geneEnd
+ * @param minExpression
+ */
+void SampleMasks::compute(const float *expressions, int geneStart, int geneEnd, float minExpression)
+{
+   const int sampleSize {_sampleSize};
+
+   for ( int g = geneStart; g < geneEnd; ++g )
+   {
+      const float *x = &expressions[static_cast<size_t>(g) * sampleSize];
+      quint64 *missing = &_missing[g * _words];
+      quint64 *threshold = &_threshold[g * _words];
+
+      for ( int i = 0; i < sampleSize; ++i )
+      {
+         const quint64 bit = 1ULL << (i % 64);
+
+         if ( std::isnan(x[i]) )
+         {
+            missing[i / 64] |= bit;
+         }
+         else if ( x[i] < minExpression )
+         {
+            threshold[i / 64] |= bit;
+         }
+      }
+
+      // mark the padding bits of the last word as missing
+      if ( sampleSize % 64 != 0 )
+      {
+         missing[_words - 1] |= ~0ULL << (sampleSize % 64);
+      }
+   }
+}
+
+
+
+
+
+
+/*!
+ * Return the number of clean samples of a pair, which are the samples that
+ * are neither missing nor below the threshold in both genes.
+ *
+ * @param x
+ * @param y
+ */
+int SampleMasks::count(int x, int y) const
+{
+   const quint64 *missing_x = missing(x);
+   const quint64 *missing_y = missing(y);
+   const quint64 *threshold_x = threshold(x);
+   const quint64 *threshold_y = threshold(y);
+   int numSamples = 0;
+
+   for ( int w = 0; w < _words; ++w )
+   {
+      numSamples += qPopulationCount(~(missing_x[w] | missing_y[w] | threshold_x[w] | threshold_y[w]));
+   }
+
+   return numSamples;
+}
+
+
+
+
+
+
+/*!
+ * Compute the sample labels of a pair and return the number of clean samples.
+ * Samples which are missing in either gene are labeled -9, samples which fall
+ * below the threshold in either gene are labeled -6, and the remaining
+ * samples are labeled as cluster 0, which is the same labeling as a
+ * comparison of each sample. Words of 64 clean samples are labeled in a
+ * single fill.
+ *
+ * @param x
+ * @param y
+ * @param labels
+ */
+int SampleMasks::labels(int x, int y, qint8 *labels) const
+{
+   const quint64 *missing_x = missing(x);
+   const quint64 *missing_y = missing(y);
+   const quint64 *threshold_x = threshold(x);
+   const quint64 *threshold_y = threshold(y);
+   int numSamples = 0;
+
+   for ( int w = 0; w < _words; ++w )
+   {
+      const quint64 missing = missing_x[w] | missing_y[w];
+      const quint64 threshold = (threshold_x[w] | threshold_y[w]) & ~missing;
+      const quint64 clean = ~(missing | threshold);
+      const int start = w * 64;
+      const int end = std::min(start + 64, _sampleSize);
+
+      numSamples += qPopulationCount(clean);
+
+      // label a word of clean samples at once
+      if ( clean == ~0ULL )
+      {
+         std::fill(labels + start, labels + end, 0);
+         continue;
+      }
+
+      // otherwise label each sample of the word from its bits
+      for ( int i = start; i < end; ++i )
+      {
+         const int b = i - start;
+
+         labels[i] = ((missing >> b) & 1) ? -9 : ((threshold >> b) & 1) ? -6 : 0;
+      }
+   }
+
+   return numSamples;
+}
@@ -0,0 +1,67 @@
+#ifndef PAIRWISE_SAMPLEMASKS_H
+#define PAIRWISE_SAMPLEMASKS_H
+#include <ace/core/core.h>
+
+
+
+namespace Pairwise
+{
+   /*!
+    * This class implements the sample validity masks of an expression matrix.
+    * Each gene has two bit-planes with one bit per sample: the missing plane
+    * marks samples whose value is NAN, and the threshold plane marks samples
+    * which are not missing but fall below the minimum expression threshold.
+    * The masks of a pair are then computed with a few word operations per
+    * 64 samples instead of a comparison per sample for each gene of the pair.
+    * The masks can also be computed for a range of genes at a time, so that
+    * the expression data never has to be in memory all at once.
+    */
+   class SampleMasks
+   {
+   public:
+      SampleMasks() = default;
+      SampleMasks(int geneSize, int sampleSize);
+      SampleMasks(const float *expressions, int geneSize, int sampleSize, float minExpression = -INFINITY);
+   public:
+      /*!
+       * Return the number of 64-bit words in the bit-plane of each gene.
+       */
+      int words() const { return _words; }
+      /*!
+       * Return the missing bit-plane of a gene.
+       *
+       * @param gene
+       */
+      const quint64 * missing(int gene) const { return &_missing[gene * _words]; }
+      /*!
+       * Return the below-threshold bit-plane of a gene.
+       *
+       * @param gene
+       */
+      const quint64 * threshold(int gene) const { return &_threshold[gene * _words]; }
+      void compute(const float *expressions, int geneStart, int geneEnd, float minExpression = -INFINITY);
+      int count(int x, int y) const;
+      int labels(int x, int y, qint8 *labels) const;
+   private:
+      /*!
+       * The number of samples of each gene.
+       */
+      int _sampleSize {0};
+      /*!
+       * The number of 64-bit words in the bit-plane of each gene.
+       */
+      int _words {0};
+      /*!
+       * The missing bit-plane of every gene.
+       */
+      std::vector<quint64> _missing;
+      /*!
+       * The below-threshold bit-plane of every gene.
+       */
+      std::vector<quint64> _threshold;
+   };
+}
+
+
+
+#endif
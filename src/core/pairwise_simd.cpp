@@ -0,0 +1,56 @@
+#include "pairwise_simd.h"
+
+
+
+using namespace Pairwise;
+
+
+
+
+
+
+/*!
+ * Return whether the CPU supports the given instruction set. The scalar level
+ * is always supported.
+ *
+ * @param level
+ */
+bool Pairwise::simdSupported(SimdLevel level)
+{
+   switch ( level )
+   {
+   case SimdLevel::Scalar:
+      return true;
+#if defined(__x86_64__) || defined(__i386__)
+   case SimdLevel::SSE2:
+      return __builtin_cpu_supports("sse2");
+   case SimdLevel::AVX2:
+      return __builtin_cpu_supports("avx2");
+   case SimdLevel::AVX512:
+      return __builtin_cpu_supports("avx512f");
+#endif
+   default:
+      return false;
+   }
+}
+
+
+
+
+
+
+/*!
+ * Return the widest instruction set which is supported by the CPU. The result
+ * is determined once and reused by every subsequent call.
+ */
+SimdLevel Pairwise::simdLevel()
+{
+   static const SimdLevel level {
+      simdSupported(SimdLevel::AVX512) ? SimdLevel::AVX512
+      : simdSupported(SimdLevel::AVX2) ? SimdLevel::AVX2
+      : simdSupported(SimdLevel::SSE2) ? SimdLevel::SSE2
+      : SimdLevel::Scalar
+   };
+
+   return level;
+}
@@ -0,0 +1,356 @@
+#ifndef PAIRWISE_SIMD_H
+#define PAIRWISE_SIMD_H
+#include <ace/core/core.h>
+#include <cstring>
+
+/*!
+ * This file provides the vector types and vector math functions which are used
+ * by the SIMD kernels of the pairwise models. Each function is a template over
+ * the lane type, which is either float (one lane) or one of the GCC vector
+ * types Float4, Float8 and Float16 (four, eight and sixteen lanes), so that a
+ * kernel can be written once and instantiated for every instruction set. The
+ * wider vector types are only mapped to AVX2 and AVX-512 registers inside
+ * functions which are compiled for those targets, and the instruction set
+ * which is used at runtime is determined by simdLevel().
+ *
+ * The exponential and logarithm functions are polynomial approximations which
+ * use only basic floating-point operations, so every lane of every instruction
+ * set computes exactly the same value as the scalar version. This guarantee
+ * requires that the compiler does not contract multiplications and additions
+ * into fused multiply-add instructions, which is why the core library is built
+ * with -ffp-contract=off.
+ */
+namespace Pairwise
+{
+   typedef float Float4 __attribute__((vector_size(16)));
+   typedef float Float8 __attribute__((vector_size(32)));
+   typedef float Float16 __attribute__((vector_size(64)));
+   typedef qint32 Int4 __attribute__((vector_size(16)));
+   typedef qint32 Int8 __attribute__((vector_size(32)));
+   typedef qint32 Int16 __attribute__((vector_size(64)));
+
+   /*!
+    * Defines the instruction sets which are supported by the SIMD kernels.
+    */
+   enum class SimdLevel
+   {
+      /*!
+       * Scalar instructions only.
+       */
+      Scalar
+      /*!
+       * SSE2 instructions with four lanes.
+       */
+      ,SSE2
+      /*!
+       * AVX2 instructions with eight lanes.
+       */
+      ,AVX2
+      /*!
+       * AVX-512 instructions with sixteen lanes.
+       */
+      ,AVX512
+   };
+
+   SimdLevel simdLevel();
+   bool simdSupported(SimdLevel level);
+
+   /*!
+    * Defines the integer type and the number of lanes of a lane type.
+    */
+   template<typename T> struct SimdTraits;
+
+   template<> struct SimdTraits<float>
+   {
+      typedef qint32 Int;
+      constexpr static int LANES {1};
+   };
+
+   template<> struct SimdTraits<Float4>
+   {
+      typedef Int4 Int;
+      constexpr static int LANES {4};
+   };
+
+   template<> struct SimdTraits<Float8>
+   {
+      typedef Int8 Int;
+      constexpr static int LANES {8};
+   };
+
+   template<> struct SimdTraits<Float16>
+   {
+      typedef Int16 Int;
+      constexpr static int LANES {16};
+   };
+
+   /*!
+    * The number of partial sums which are used by every reduction over
+    * samples. A sample with index i is always added to the partial sum with
+    * index i % SIMD_STRIPES, and the partial sums are then combined in a fixed
+    * order, so that every instruction set computes the same sum.
+    */
+   constexpr int SIMD_STRIPES {16};
+
+
+
+   /*!
+    * Return a lane value with every lane set to the given scalar.
+    *
+    * @param a
+    */
+   template<typename T>
+   inline __attribute__((always_inline)) T simdSet(float a)
+   {
+      return T {} + a;
+   }
+
+
+
+   /*!
+    * Return a lane value with each lane set to its lane index.
+    */
+   template<typename T>
+   inline __attribute__((always_inline)) T simdIota()
+   {
+      T a;
+
+      for ( int j = 0; j < SimdTraits<T>::LANES; ++j )
+      {
+         reinterpret_cast<float*>(&a)[j] = j;
+      }
+
+      return a;
+   }
+
+
+
+   /*!
+    * Load a lane value from an unaligned array.
+    *
+    * @param p
+    */
+   template<typename T>
+   inline __attribute__((always_inline)) T simdLoad(const float *p)
+   {
+      T a;
+      memcpy(&a, p, sizeof(T));
+      return a;
+   }
+
+
+
+   /*!
+    * Store a lane value to an unaligned array.
+    *
+    * @param p
+    * @param a
+    */
+   template<typename T>
+   inline __attribute__((always_inline)) void simdStore(float *p, T a)
+   {
+      memcpy(p, &a, sizeof(T));
+   }
+
+
+
+   /*!
+    * Reinterpret the bits of a lane value as another lane type of the same
+    * size.
+    *
+    * @param a
+    */
+   template<typename U, typename T>
+   inline __attribute__((always_inline)) U simdBitcast(T a)
+   {
+      static_assert(sizeof(U) == sizeof(T), "lane types must have the same size");
+
+      U b;
+      memcpy(&b, &a, sizeof(U));
+      return b;
+   }
+
+
+
+   /*!
+    * Return a where the mask is set and b elsewhere. The mask is the result of
+    * a comparison of two lane values. Vector lanes are selected with bitwise
+    * operations rather than the vector conditional operator, which some
+    * versions of GCC cannot compile for AVX-512 masks.
+    *
+    * @param mask
+    * @param a
+    * @param b
+    */
+   inline __attribute__((always_inline)) float simdSelect(bool mask, float a, float b) { return mask ? a : b; }
+
+   template<typename M, typename T>
+   inline __attribute__((always_inline)) T simdSelect(M mask, T a, T b)
+   {
+      typedef typename SimdTraits<T>::Int I;
+
+      return simdBitcast<T>((simdBitcast<I>(a) & mask) | (simdBitcast<I>(b) & ~mask));
+   }
+
+
+
+   /*!
+    * Convert a lane value to integers by truncation.
+    *
+    * @param a
+    */
+   inline __attribute__((always_inline)) qint32 simdTruncate(float a) { return static_cast<qint32>(a); }
+   inline __attribute__((always_inline)) Int4 simdTruncate(Float4 a) { return __builtin_convertvector(a, Int4); }
+   inline __attribute__((always_inline)) Int8 simdTruncate(Float8 a) { return __builtin_convertvector(a, Int8); }
+   inline __attribute__((always_inline)) Int16 simdTruncate(Float16 a) { return __builtin_convertvector(a, Int16); }
+
+
+
+   /*!
+    * Convert integers to a lane value.
+    *
+    * @param a
+    */
+   inline __attribute__((always_inline)) float simdConvert(qint32 a) { return static_cast<float>(a); }
+   inline __attribute__((always_inline)) Float4 simdConvert(Int4 a) { return __builtin_convertvector(a, Float4); }
+   inline __attribute__((always_inline)) Float8 simdConvert(Int8 a) { return __builtin_convertvector(a, Float8); }
+   inline __attribute__((always_inline)) Float16 simdConvert(Int16 a) { return __builtin_convertvector(a, Float16); }
+
+
+
+   /*!
+    * Return the exponential of each lane. The argument is reduced to the range
+    * [-log(2)/2, log(2)/2] and the exponential is approximated by a polynomial
+    * of degree seven, with a relative error of about two units in the last
+    * place. Arguments above 88 return infinity, arguments below the smallest
+    * normal result return zero, and missing values are preserved.
+    *
+    * @param x
+    */
+   template<typename T>
+   inline __attribute__((always_inline)) T simdExp(T x)
+   {
+      typedef typename SimdTraits<T>::Int I;
+
+      const T MAX_ARG = simdSet<T>(88.0f);
+      const T MIN_ARG = simdSet<T>(-87.3365447504f);
+
+      // clamp argument to the range of the result
+      T a = simdSelect(x > MAX_ARG, MAX_ARG, x);
+      a = simdSelect(a < MIN_ARG, MIN_ARG, a);
+
+      // compute n = floor(x / log(2) + 1/2)
+      T fx = a * 1.44269504088896341f + 0.5f;
+      T n = simdConvert(simdTruncate(fx));
+      n = simdSelect(n > fx, n - 1.0f, n);
+
+      // compute r = x - n * log(2) in two parts for precision
+      T r = a - n * 0.693359375f;
+      r = r - n * -2.12194440e-4f;
+
+      // approximate exp(r)
+      T p = simdSet<T>(1.9875691500e-4f);
+      p = p * r + 1.3981999507e-3f;
+      p = p * r + 8.3334519073e-3f;
+      p = p * r + 4.1665795894e-2f;
+      p = p * r + 1.6666665459e-1f;
+      p = p * r + 5.0000001201e-1f;
+      p = p * (r * r) + r;
+      p = p + 1.0f;
+
+      // compute 2^n from the exponent bits
+      I e = (simdTruncate(n) + 127) << 23;
+      T y = p * simdBitcast<T>(e);
+
+      // handle overflow, underflow and missing values
+      y = simdSelect(x > MAX_ARG, simdSet<T>(INFINITY), y);
+      y = simdSelect(x < MIN_ARG, simdSet<T>(0.0f), y);
+      y = simdSelect(x != x, x, y);
+
+      return y;
+   }
+
+
+
+   /*!
+    * Return the natural logarithm of each lane. The argument is split into a
+    * mantissa in [sqrt(1/2), sqrt(2)) and an exponent, and the logarithm of the
+    * mantissa is approximated by a polynomial of degree nine, with a relative
+    * error of about two units in the last place. Zero returns negative
+    * infinity, negative arguments return NAN, and infinity and missing values
+    * are preserved. Denormal arguments are treated as zero.
+    *
+    * @param x
+    */
+   template<typename T>
+   inline __attribute__((always_inline)) T simdLog(T x)
+   {
+      typedef typename SimdTraits<T>::Int I;
+
+      // split x into mantissa m in [1/2, 1) and exponent e
+      I bits = simdBitcast<I>(x);
+      T e = simdConvert(((bits >> 23) & 0xff) - 126);
+      T m = simdBitcast<T>((bits & ~0x7f800000) | 0x3f000000);
+
+      // shift mantissa to [sqrt(1/2), sqrt(2)) and compute r = m - 1
+      auto small = (m < 0.707106781186547524f);
+      e = simdSelect(small, e - 1.0f, e);
+      T r = simdSelect(small, m + m - 1.0f, m - 1.0f);
+
+      // approximate log(1 + r)
+      T z = r * r;
+      T p = simdSet<T>(7.0376836292e-2f);
+      p = p * r + -1.1514610310e-1f;
+      p = p * r + 1.1676998740e-1f;
+      p = p * r + -1.2420140846e-1f;
+      p = p * r + 1.4249322787e-1f;
+      p = p * r + -1.6668057665e-1f;
+      p = p * r + 2.0000714765e-1f;
+      p = p * r + -2.4999993993e-1f;
+      p = p * r + 3.3333331174e-1f;
+
+      T y = p * r * z;
+      y = y + e * -2.12194440e-4f;
+      y = y - z * 0.5f;
+      y = r + y;
+      y = y + e * 0.693359375f;
+
+      // handle zero, negative, infinite and missing values
+      const T INF = simdSet<T>(INFINITY);
+
+      y = simdSelect(x < simdSet<T>(1.17549435e-38f), simdSet<T>(-INFINITY), y);
+      y = simdSelect(x < simdSet<T>(0.0f), simdSet<T>(NAN), y);
+      y = simdSelect(x == INF, INF, y);
+      y = simdSelect(x != x, x, y);
+
+      return y;
+   }
+
+
+
+   /*!
+    * Combine a set of striped partial sums into a single sum. The partial sums
+    * are added in halves, so the order of the additions does not depend on the
+    * lane type.
+    *
+    * @param acc
+    */
+   template<typename T>
+   inline __attribute__((always_inline)) float simdReduce(const T *acc)
+   {
+      float p[SIMD_STRIPES];
+      memcpy(p, acc, sizeof(p));
+
+      for ( int s = SIMD_STRIPES / 2; s > 0; s /= 2 )
+      {
+         for ( int j = 0; j < s; ++j )
+         {
+            p[j] += p[j + s];
+         }
+      }
+
+      return p[0];
+   }
+}
+
+#endif
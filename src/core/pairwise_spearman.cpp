@@ -10,16 +10,38 @@ using namespace Pairwise;
 
 
 /*!
- * Construct a Spearman correlation model.
+ * Construct a Spearman correlation model. The sort order of every gene in the
+ * given expression matrix is computed here so that it can be reused by every
+ * pair which contains the gene. If no expression data is given, the genes of
+ * each pair are sorted when the pair is computed.
  *
  * @param emx
+ * @param expressions
  */
-Spearman::Spearman(ExpressionMatrix* emx)
+Spearman::Spearman(ExpressionMatrix* emx, const float *expressions):
+   _sampleSize(emx->sampleSize())
 {
    // pre-allocate workspace
-   _x.resize(emx->sampleSize());
-   _y.resize(emx->sampleSize());
-   _rank.resize(emx->sampleSize());
+   _rank.resize(_sampleSize);
+
+   // sort the genes of each pair if there is no expression data
+   if ( !expressions )
+   {
+      _pairOrder.resize(2 * _sampleSize);
+      return;
+   }
+
+   // compute the sort order of each gene
+   std::vector<int>* order {new std::vector<int>(static_cast<qint64>(emx->geneSize()) * _sampleSize)};
+
+   for ( int i = 0; i < emx->geneSize(); ++i )
+   {
+      qint64 offset {static_cast<qint64>(i) * _sampleSize};
+
+      sortGene(&expressions[offset], _sampleSize, &(*order)[offset]);
+   }
+
+   _order.reset(order);
 }
 
 
@@ -28,58 +50,25 @@ Spearman::Spearman(ExpressionMatrix* emx)
 
 
 /*!
- * Compute the Spearman correlation of a cluster in a pairwise data array.
+ * Compute the sort order of a gene, which is the list of sample indices in
+ * ascending order of expression value. The sort is stable, so tied values are
+ * ordered by sample index, and missing values are placed at the end.
  *
  * @param x
- * @param y
- * @param labels
- * @param cluster
- * @param minSamples
+ * @param sampleSize
+ * @param order
  */
-float Spearman::computeCluster(
-   const float *x,
-   const float *y,
-   const QVector<qint8>& labels,
-   qint8 cluster,
-   int minSamples)
+void Spearman::sortGene(const float *x, int sampleSize, int *order)
 {
-   // extract samples in pairwise cluster
-   int n = 0;
-
-   for ( int i = 0; i < labels.size(); ++i )
+   for ( int i = 0; i < sampleSize; ++i )
    {
-      if ( labels[i] == cluster )
-      {
-         _x[n] = x[i];
-         _y[n] = y[i];
-         _rank[n] = n + 1;
-         ++n;
-      }
+      order[i] = i;
    }
 
-   // compute correlation only if there are enough samples
-   float result = NAN;
-
-   if ( n >= minSamples )
+   std::stable_sort(order, order + sampleSize, [x] (int a, int b)
    {
-      // execute two sorts that are the beginning of the spearman algorithm
-      heapSort(_x, _y, n);
-      heapSort(_y, _rank, n);
-
-      // go through spearman sorted rank list and calculate difference from 1,2,3,... list
-      int diff = 0;
-
-      for ( int i = 0; i < n; ++i )
-      {
-         int tmp = (i + 1) - _rank[i];
-         diff += tmp*tmp;
-      }
-
-      // compute spearman coefficient
-      result = 1.0f - 6.0f * diff / (n * (n*n - 1));
-   }
-
-   return result;
+      return (!std::isnan(x[a]) && std::isnan(x[b])) || x[a] < x[b];
+   });
 }
 
 
@@ -87,37 +76,43 @@ float Spearman::computeCluster(
 
 
 
-template<typename T>
-void Spearman::siftDown(QVector<float>& array, QVector<T>& extra, int start, int end)
+/*!
+ * Compute the correlation of each cluster in a pairwise data array. This
+ * implementation selects (or computes) the sort orders of the genes in the
+ * pair and then computes each cluster as usual.
+ *
+ * @param expressions
+ * @param index
+ * @param K
+ * @param labels
+ * @param N
+ * @param minSamples
+ * @param correlations
+ */
+void Spearman::compute(
+   const float *expressions,
+   const Index& index,
+   int K,
+   const qint8 *labels,
+   int N,
+   int minSamples,
+   float *correlations)
 {
-   int root = start;
-
-   while ( 2 * root + 1 <= end )
+   if ( _order )
    {
-      int child = 2 * root + 1;
-      int swp = root;
-
-      if ( array[swp] < array[child] )
-      {
-         swp = child;
-      }
-
-      if ( child + 1 <= end && array[swp] < array[child + 1] )
-      {
-         swp = child + 1;
-      }
+      _orderX = &(*_order)[static_cast<qint64>(index.getX()) * _sampleSize];
+      _orderY = &(*_order)[static_cast<qint64>(index.getY()) * _sampleSize];
+   }
+   else
+   {
+      sortGene(&expressions[static_cast<qint64>(index.getX()) * _sampleSize], _sampleSize, &_pairOrder[0]);
+      sortGene(&expressions[static_cast<qint64>(index.getY()) * _sampleSize], _sampleSize, &_pairOrder[_sampleSize]);
 
-      if ( swp == root )
-      {
-         return;
-      }
-      else
-      {
-         std::swap(array[root], array[swp]);
-         std::swap(extra[root], extra[swp]);
-         root = swp;
-      }
+      _orderX = &_pairOrder[0];
+      _orderY = &_pairOrder[_sampleSize];
    }
+
+   CorrelationModel::compute(expressions, index, K, labels, N, minSamples, correlations);
 }
 
 
@@ -126,33 +121,62 @@ void Spearman::siftDown(QVector<float>& array, QVector<T>& extra, int start, int
 
 
 /*!
- * Sort an array using heapsort, while also applying the same swap operations
- * to a second array of the same size.
+ * Compute the Spearman correlation of a cluster in a pairwise data array. The
+ * rank of each sample in the cluster is found by walking the sort order of the
+ * x gene and counting only the samples in the cluster, and the ranks of the y
+ * gene are found the same way while the squared rank differences are summed.
  *
- * @param array
- * @param extra
- * @param n
+ * @param x
+ * @param y
+ * @param labels
+ * @param N
+ * @param cluster
+ * @param minSamples
  */
-template<typename T>
-void Spearman::heapSort(QVector<float>& array, QVector<T>& extra, int n)
+float Spearman::computeCluster(
+   const float *,
+   const float *,
+   const qint8 *labels,
+   int,
+   qint8 cluster,
+   int minSamples)
 {
-   // heapify the array
-   int start = ((n-1) - 1) / 2;
+   // compute the rank of each sample in the cluster along the x axis
+   int n = 0;
 
-   while ( start >= 0 )
+   for ( int i = 0; i < _sampleSize; ++i )
    {
-      siftDown(array, extra, start, n - 1);
-      start -= 1;
+      int j = _orderX[i];
+
+      if ( labels[j] == cluster )
+      {
+         _rank[j] = ++n;
+      }
    }
 
-   // sort the array
-   int end = n - 1;
-   while ( end > 0 )
+   // compute correlation only if there are enough samples
+   float result = NAN;
+
+   if ( n >= minSamples )
    {
-      std::swap(array[end], array[0]);
-      std::swap(extra[end], extra[0]);
-      end -= 1;
+      // compute the sum of squared differences between the ranks of each axis
+      qint64 diff = 0;
+      int rank = 0;
 
-      siftDown(array, extra, 0, end);
+      for ( int i = 0; i < _sampleSize; ++i )
+      {
+         int j = _orderY[i];
+
+         if ( labels[j] == cluster )
+         {
+            qint64 tmp = ++rank - _rank[j];
+            diff += tmp*tmp;
+         }
+      }
+
+      // compute spearman coefficient
+      result = 1.0 - 6.0 * diff / (static_cast<double>(n) * (static_cast<double>(n)*n - 1));
    }
+
+   return result;
 }
@@ -6,32 +6,63 @@
 namespace Pairwise
 {
    /*!
-    * This class implements the Spearman correlation model.
+    * This class implements the Spearman correlation model. Each gene is sorted
+    * once when the model is constructed, so the ranks of a pairwise cluster
+    * are obtained by walking the sort order of each gene and skipping the
+    * samples which are not in the cluster, rather than by sorting the
+    * samples of every pair again. If the expression data is not in memory
+    * when the model is constructed, the genes of each pair are sorted when
+    * the pair is computed instead.
     */
    class Spearman : public CorrelationModel
    {
    public:
-      Spearman(ExpressionMatrix* emx);
+      Spearman(ExpressionMatrix* emx, const float *expressions);
+   public:
+      static void sortGene(const float *x, int sampleSize, int *order);
+      virtual void compute(
+         const float *expressions,
+         const Index& index,
+         int K,
+         const qint8 *labels,
+         int N,
+         int minSamples,
+         float *correlations
+      ) override final;
    protected:
       virtual float computeCluster(
          const float *x,
          const float *y,
-         const QVector<qint8>& labels,
+         const qint8 *labels,
+         int N,
          qint8 cluster,
          int minSamples
       ) override final;
    private:
-      template<typename T> void siftDown(QVector<float>& array, QVector<T>& extra, int start, int end);
-      template<typename T> void heapSort(QVector<float>& array, QVector<T>& extra, int n);
-   private:
       /*!
-       * Workspace for the x data.
+       * The number of samples in the expression matrix.
+       */
+      int _sampleSize;
+      /*!
+       * The sort order of each gene, which is a list of sample indices in
+       * ascending order of expression value for each gene. It is shared by
+       * copies of this model, since it does not change after construction.
+       */
+      std::shared_ptr<const std::vector<int>> _order;
+      /*!
+       * Workspace for the sort order of the x and y gene of the current pair,
+       * which is only used if the sort order of each gene is not computed
+       * beforehand.
+       */
+      std::vector<int> _pairOrder;
+      /*!
+       * Pointer to the sort order of the x gene of the current pair.
        */
-      QVector<float> _x;
+      const int *_orderX {nullptr};
       /*!
-       * Workspace for the y data.
+       * Pointer to the sort order of the y gene of the current pair.
        */
-      QVector<float> _y;
+      const int *_orderY {nullptr};
       /*!
        * Workspace for the rank data.
        */
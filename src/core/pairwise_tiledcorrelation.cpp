@@ -0,0 +1,329 @@
+#include <cblas.h>
+
+#include "pairwise_tiledcorrelation.h"
+#include "pairwise_spearman.h"
+
+
+
+using namespace Pairwise;
+
+
+
+
+
+
+/*!
+ * Construct a tiled correlation engine for an expression matrix. Each gene is
+ * centered and scaled to unit norm over its valid samples, which does not change
+ * any correlation but keeps the sums of the masked products small. The
+ * standardized row of a clean gene which is constant, or of any clean gene when
+ * there are fewer samples than the minimum, is filled with NAN so that its
+ * correlations are NAN just as they are for the pairwise correlation model. If
+ * ranks are used, each clean gene is ranked with the same stable sort that is
+ * used by the Spearman correlation model. The expression matrix is kept by
+ * pointer to derive the validity masks of each tile, so it must outlive the
+ * engine.
+ *
+ * @param expressions
+ * @param geneSize
+ * @param sampleSize
+ * @param minExpression
+ * @param minSamples
+ * @param rank
+ */
+TiledCorrelation::TiledCorrelation(
+   const float *expressions,
+   int geneSize,
+   int sampleSize,
+   float minExpression,
+   int minSamples,
+   bool rank):
+   _expressions(expressions),
+   _geneSize(geneSize),
+   _sampleSize(sampleSize),
+   _minExpression(minExpression),
+   _minSamples(minSamples),
+   _z(static_cast<qint64>(geneSize) * sampleSize, 0.0f),
+   _clean(geneSize, false)
+{
+   // determine which genes are clean
+   bool allClean = true;
+
+   for ( int g = 0; g < geneSize; ++g )
+   {
+      const float *x = &expressions[static_cast<qint64>(g) * sampleSize];
+      bool clean = true;
+
+      for ( int i = 0; i < sampleSize; ++i )
+      {
+         if ( std::isnan(x[i]) || x[i] < minExpression )
+         {
+            clean = false;
+            break;
+         }
+      }
+
+      _clean[g] = clean;
+      allClean = allClean && clean;
+   }
+
+   // use masked products only if they are needed
+   _masked = !allClean && !rank;
+
+   // initialize workspace for ranks
+   std::vector<int> order(rank ? sampleSize : 0);
+   std::vector<float> ranks(rank ? sampleSize : 0);
+
+   for ( int g = 0; g < geneSize; ++g )
+   {
+      const float *x = &expressions[static_cast<qint64>(g) * sampleSize];
+      float *z = &_z[static_cast<qint64>(g) * sampleSize];
+
+      // skip genes which are not clean if ranks are used
+      if ( rank && !_clean[g] )
+      {
+         continue;
+      }
+
+      // replace the gene with its ranks if ranks are used
+      if ( rank )
+      {
+         Spearman::sortGene(x, sampleSize, order.data());
+
+         for ( int i = 0; i < sampleSize; ++i )
+         {
+            ranks[order[i]] = i + 1;
+         }
+
+         x = ranks.data();
+      }
+
+      // compute the mean of the valid samples
+      int n = 0;
+      double mean = 0;
+
+      for ( int i = 0; i < sampleSize; ++i )
+      {
+         if ( !std::isnan(x[i]) && x[i] >= minExpression )
+         {
+            mean += x[i];
+            ++n;
+         }
+      }
+
+      mean = (n > 0) ? mean / n : 0;
+
+      // compute the norm of the centered valid samples
+      double norm = 0;
+
+      for ( int i = 0; i < sampleSize; ++i )
+      {
+         if ( !std::isnan(x[i]) && x[i] >= minExpression )
+         {
+            norm += (x[i] - mean) * (x[i] - mean);
+         }
+      }
+
+      norm = sqrt(norm);
+
+      // save the standardized gene
+      if ( _clean[g] )
+      {
+         float value = NAN;
+
+         for ( int i = 0; i < sampleSize; ++i )
+         {
+            if ( sampleSize >= minSamples && norm > 0 )
+            {
+               value = static_cast<float>((x[i] - mean) / norm);
+            }
+
+            z[i] = value;
+         }
+      }
+      else
+      {
+         double scale = (norm > 0) ? 1 / norm : 1;
+
+         for ( int i = 0; i < sampleSize; ++i )
+         {
+            if ( !std::isnan(x[i]) && x[i] >= minExpression )
+            {
+               z[i] = static_cast<float>((x[i] - mean) * scale);
+            }
+         }
+      }
+   }
+}
+
+
+
+
+
+
+/*!
+ * Compute a tile of correlations between the genes in the range [rowStart,
+ * rowEnd) and the genes in the range [colStart, colEnd). The tile is written
+ * to C in row-major order with a row stride of (colEnd - colStart). If every
+ * gene in the tile is clean, or if the engine does not use masks, then the
+ * tile is a single matrix product of the standardized genes. Otherwise, the
+ * validity masks and squares of the rows and columns of the tile are derived
+ * in the given workspace, and the sample counts and the masked sums, sums of
+ * squares and cross products of each pair are computed from them as separate
+ * matrix products and then combined into correlations.
+ *
+ * @param rowStart
+ * @param rowEnd
+ * @param colStart
+ * @param colEnd
+ * @param C
+ * @param workspace
+ */
+void TiledCorrelation::compute(
+   qint32 rowStart,
+   qint32 rowEnd,
+   qint32 colStart,
+   qint32 colEnd,
+   float *C,
+   std::vector<float>& workspace) const
+{
+   const int m = rowEnd - rowStart;
+   const int n = colEnd - colStart;
+
+   if ( m <= 0 || n <= 0 )
+   {
+      return;
+   }
+
+   // determine whether every gene in the tile is clean
+   bool clean = true;
+
+   for ( qint32 i = rowStart; clean && i < rowEnd; ++i )
+   {
+      clean = _clean[i];
+   }
+
+   for ( qint32 j = colStart; clean && j < colEnd; ++j )
+   {
+      clean = _clean[j];
+   }
+
+   const float *zRows = &_z[static_cast<qint64>(rowStart) * _sampleSize];
+   const float *zCols = &_z[static_cast<qint64>(colStart) * _sampleSize];
+
+   // compute C = Z_rows * Z_cols^T for a clean tile
+   if ( clean || !isMasked() )
+   {
+      multiply(zRows, m, zCols, n, C);
+      return;
+   }
+
+   // derive the masks and squares of the rows and columns of the tile
+   const qint64 size {static_cast<qint64>(m) * n};
+   const qint64 rowSize {static_cast<qint64>(m) * _sampleSize};
+   const qint64 colSize {static_cast<qint64>(n) * _sampleSize};
+
+   workspace.resize(5 * size + 2 * rowSize + 2 * colSize);
+
+   float *maskRows = &workspace[5 * size];
+   float *squareRows = maskRows + rowSize;
+   float *maskCols = squareRows + rowSize;
+   float *squareCols = maskCols + colSize;
+
+   computeMasks(rowStart, m, maskRows, squareRows);
+   computeMasks(colStart, n, maskCols, squareCols);
+
+   // compute the masked products
+   float *count = &workspace[0 * size];
+   float *sumx = &workspace[1 * size];
+   float *sumy = &workspace[2 * size];
+   float *sumx2 = &workspace[3 * size];
+   float *sumy2 = &workspace[4 * size];
+   float *sumxy = C;
+
+   multiply(maskRows, m, maskCols, n, count);
+   multiply(zRows, m, maskCols, n, sumx);
+   multiply(maskRows, m, zCols, n, sumy);
+   multiply(squareRows, m, maskCols, n, sumx2);
+   multiply(maskRows, m, squareCols, n, sumy2);
+   multiply(zRows, m, zCols, n, sumxy);
+
+   // combine the products into correlations
+   for ( qint64 k = 0; k < size; ++k )
+   {
+      float result = NAN;
+
+      if ( count[k] >= _minSamples )
+      {
+         float n_k = count[k];
+
+         result = (n_k*sumxy[k] - sumx[k]*sumy[k]) / sqrtf((n_k*sumx2[k] - sumx[k]*sumx[k]) * (n_k*sumy2[k] - sumy[k]*sumy[k]));
+      }
+
+      C[k] = result;
+   }
+}
+
+
+
+
+
+
+/*!
+ * Compute the validity mask and the squares of the standardized genes in the
+ * range [start, start + size). The mask is one for each sample that is
+ * neither missing nor below the expression threshold and zero otherwise.
+ *
+ * @param start
+ * @param size
+ * @param mask
+ * @param squares
+ */
+void TiledCorrelation::computeMasks(qint32 start, int size, float *mask, float *squares) const
+{
+   const qint64 offset {static_cast<qint64>(start) * _sampleSize};
+   const qint64 length {static_cast<qint64>(size) * _sampleSize};
+   const float *x = &_expressions[offset];
+   const float *z = &_z[offset];
+
+   for ( qint64 i = 0; i < length; ++i )
+   {
+      bool valid = !std::isnan(x[i]) && x[i] >= _minExpression;
+
+      mask[i] = valid ? 1.0f : 0.0f;
+      squares[i] = z[i] * z[i];
+   }
+}
+
+
+
+
+
+
+/*!
+ * Compute the matrix product C = A * B^T, where A has m rows and B has n rows
+ * of samples. The result is written to C in row-major order.
+ *
+ * @param A
+ * @param m
+ * @param B
+ * @param n
+ * @param C
+ */
+void TiledCorrelation::multiply(
+   const float *A,
+   int m,
+   const float *B,
+   int n,
+   float *C) const
+{
+   cblas_sgemm(
+      CblasRowMajor, CblasNoTrans, CblasTrans,
+      m, n, _sampleSize,
+      1.0f,
+      A, _sampleSize,
+      B, _sampleSize,
+      0.0f,
+      C, n
+   );
+}
@@ -0,0 +1,99 @@
+#ifndef PAIRWISE_TILEDCORRELATION_H
+#define PAIRWISE_TILEDCORRELATION_H
+#include <ace/core/core.h>
+
+namespace Pairwise
+{
+   /*!
+    * This class implements the tiled correlation engine, which computes the
+    * Pearson correlation of many gene pairs at once using matrix products. Each
+    * gene is standardized once (centered and scaled to unit norm) so that the
+    * correlation of two clean genes is simply the dot product of their standardized
+    * rows, and a tile of correlations is a single call to cblas_sgemm. A gene is
+    * clean if it has no missing values and no values below the expression
+    * threshold.
+    *
+    * Pairs which involve a gene that is not clean are computed from masked
+    * matrix products: each gene has a validity mask which excludes missing and
+    * below-threshold samples, and the sample count, sums, sums of squares and
+    * cross products over the joint mask of every pair in a tile are each
+    * computed with one matrix product. The result is the pairwise-complete
+    * Pearson correlation, which is the same quantity that is computed by the
+    * Pearson correlation model. The validity masks and the squares of the
+    * standardized genes are derived for the rows and columns of each tile as
+    * it is computed, so the engine only keeps one full copy of the expression
+    * matrix, which is the standardized matrix, in addition to the expression
+    * matrix that it is given.
+    *
+    * The engine can also compute Spearman correlations, in which case each
+    * clean gene is replaced by its ranks before it is standardized, so that the
+    * Spearman correlation of two clean genes is the Pearson correlation of
+    * their ranks. The ranks of a gene which is not clean depend on the joint
+    * mask of each pair, so such pairs are not computed by the engine in this
+    * mode.
+    */
+   class TiledCorrelation
+   {
+   public:
+      TiledCorrelation(const float *expressions, int geneSize, int sampleSize, float minExpression, int minSamples, bool rank = false);
+   public:
+      /*!
+       * Return whether a gene has no missing or below-threshold samples.
+       *
+       * @param gene
+       */
+      bool isClean(int gene) const { return _clean[gene]; }
+      /*!
+       * Return whether the engine computes the correlations of pairs which
+       * contain genes that are not clean.
+       */
+      bool isMasked() const { return _masked; }
+      void compute(qint32 rowStart, qint32 rowEnd, qint32 colStart, qint32 colEnd, float *C, std::vector<float>& workspace) const;
+      /*!
+       * The default number of rows and columns in a tile of correlations.
+       */
+      constexpr static int TILE_SIZE {128};
+   private:
+      void computeMasks(qint32 start, int size, float *mask, float *squares) const;
+      void multiply(const float *A, int m, const float *B, int n, float *C) const;
+   private:
+      /*!
+       * Pointer to the expression matrix, which must remain valid for the
+       * lifetime of the engine.
+       */
+      const float *_expressions;
+      /*!
+       * The number of genes in the expression matrix.
+       */
+      int _geneSize;
+      /*!
+       * The number of samples in the expression matrix.
+       */
+      int _sampleSize;
+      /*!
+       * The minimum expression value of a valid sample.
+       */
+      float _minExpression;
+      /*!
+       * The minimum number of valid samples required to compute a correlation.
+       */
+      int _minSamples;
+      /*!
+       * Whether the correlations of pairs which contain genes that are not
+       * clean are computed from masked matrix products, which is the case if
+       * some gene is not clean and ranks are not used.
+       */
+      bool _masked {false};
+      /*!
+       * The standardized expression matrix, in row-major order. Samples which
+       * are missing or below the expression threshold are zero.
+       */
+      std::vector<float> _z;
+      /*!
+       * Whether each gene is clean.
+       */
+      std::vector<char> _clean;
+   };
+}
+
+#endif
@@ -0,0 +1,543 @@
+#include "pairwise_vbgmm.h"
+#include "pairwise_gmm_kernels.h"
+
+
+
+using namespace Pairwise;
+
+
+
+
+
+
+/*!
+ * Construct a variational Bayesian Gaussian mixture model which uses the SIMD
+ * kernels of the given instruction set.
+ *
+ * @param emx
+ * @param maxClusters
+ * @param weightThreshold
+ * @param level
+ */
+VBGMM::VBGMM(ExpressionMatrix* emx, qint8 maxClusters, float weightThreshold, SimdLevel level):
+   _kernels(GMM::Kernels::get(level)),
+   _weightThreshold(weightThreshold)
+{
+   // pre-allocate workspace
+   const int stride = GMM::Kernels::stride(emx->sampleSize());
+
+   _x.resize(stride);
+   _y.resize(stride);
+   _logpx.resize(stride);
+   _labels.resize(emx->sampleSize());
+   _order.resize(emx->sampleSize());
+   _projection.resize(emx->sampleSize());
+   _components.resize(maxClusters);
+   _resp.resize(maxClusters * stride);
+}
+
+
+
+
+
+
+/*!
+ * Update the variational posterior of a mixture component from the weighted
+ * statistics of its samples, and return whether the resulting scale matrix
+ * is positive definite.
+ *
+ * @param xbar
+ * @param S
+ * @param N_k
+ * @param alpha0
+ * @param beta0
+ * @param nu0
+ * @param m0
+ * @param W0inv
+ */
+bool VBGMM::Component::update(const Vector2& xbar, const Matrix2x2& S, float N_k, float alpha0, float beta0, float nu0, const Vector2& m0, const Matrix2x2& W0inv)
+{
+   const int D = 2;
+
+   // update the parameters of the weight, mean and precision
+   _alpha = alpha0 + N_k;
+   _beta = beta0 + N_k;
+   _nu = nu0 + N_k;
+
+   // compute m = (beta0 * m0 + N_k * xbar) / beta
+   vectorInitZero(_m);
+   vectorAdd(_m, beta0, m0);
+   vectorAdd(_m, N_k, xbar);
+   vectorScale(_m, 1.0f / _beta);
+
+   // compute W^-1 = W0^-1 + N_k * S + beta0 * N_k / beta * (xbar - m0) (xbar - m0)^T
+   Matrix2x2 Winv = S;
+   matrixScale(Winv, N_k);
+
+   for ( int i = 0; i < 4; ++i )
+   {
+      Winv.s[i] += W0inv.s[i];
+   }
+
+   Vector2 diff = xbar;
+   vectorSubtract(diff, m0);
+   matrixAddOuterProduct(Winv, beta0 * N_k / _beta, diff);
+
+   // compute W and the expected log-determinant of the precision
+   float det;
+   matrixInverse(Winv, _W, &det);
+
+   if ( det <= 0 )
+   {
+      return false;
+   }
+
+   float logDetLambda = digamma(0.5f * _nu) + digamma(0.5f * (_nu - 1)) + D * logf(2.0f) - logf(det);
+
+   // pre-compute the expected precision and the normalizer term
+   _precision = _W;
+   matrixScale(_precision, _nu);
+
+   _normalizer = 0.5f * logDetLambda - 0.5f * D * logf(2.0f * M_PI) - 0.5f * D / _beta;
+
+   return true;
+}
+
+
+
+
+
+
+/*!
+ * Compute the log-responsibility of a component for each sample, without the
+ * expected log of the mixture weight:
+ *
+ *   log(rho) = 0.5 * E[log(det(Lambda))] - log(2pi)
+ *            - 0.5 * (D / beta + nu * (x - m)^T W (x - m))
+ *
+ * @param kernels
+ * @param x
+ * @param y
+ * @param N
+ * @param logRho
+ */
+void VBGMM::Component::computeLogRho(const GMM::Kernels& kernels, const float *x, const float *y, int N, float *logRho)
+{
+   kernels.logProbNorm(x, y, N, _m, _precision, _normalizer, logRho);
+}
+
+
+
+
+
+
+/*!
+ * Compute the digamma function, which is the derivative of the log of the
+ * gamma function, with the recurrence relation and an asymptotic series.
+ *
+ * @param x
+ */
+float VBGMM::digamma(float x)
+{
+   float result = 0;
+
+   // shift x with psi(x) = psi(x + 1) - 1/x until the series is accurate
+   while ( x < 6 )
+   {
+      result -= 1 / x;
+      x += 1;
+   }
+
+   // evaluate the asymptotic series
+   float f = 1 / (x * x);
+
+   return result + logf(x) - 0.5f / x
+      - f * (1.0f/12 - f * (1.0f/120 - f * (1.0f/252 - f * (1.0f/240 - f * (1.0f/132)))));
+}
+
+
+
+
+
+
+/*!
+ * Initialize the priors of the model from the clean samples. The prior mean
+ * is the mean of the data and the prior scale matrix of the precision is
+ * derived from the covariance of the data. Return false if the covariance is
+ * singular.
+ *
+ * @param N
+ * @param K
+ */
+bool VBGMM::initializePriors(int N, int K)
+{
+   // compute the mean of the data
+   std::fill(_resp.begin(), _resp.begin() + N, 1.0f);
+
+   float sums[3];
+   _kernels.moments(_resp.data(), _x.data(), _y.data(), N, sums);
+
+   _m0 = {{ sums[1] / N, sums[2] / N }};
+
+   // compute the covariance of the data
+   _kernels.covariance(_resp.data(), _x.data(), _y.data(), N, _m0, sums);
+
+   // use weak priors on the weights, means and precisions, and choose the
+   // prior scale matrix so that the prior expectation of the precision of a
+   // component, nu0 * W0, is the inverse covariance of the data
+   _alpha0 = 1.0f / K;
+   _beta0 = 1.0f;
+   _nu0 = 2.0f;
+
+   _W0inv = {{ sums[0] / N, sums[1] / N, sums[1] / N, sums[2] / N }};
+   matrixScale(_W0inv, _nu0);
+
+   return (_W0inv.s[0] * _W0inv.s[3] - _W0inv.s[1] * _W0inv.s[2] > 0);
+}
+
+
+
+
+
+
+/*!
+ * Initialize the responsibilities by dividing the samples into K groups of
+ * equal size along the first principal axis of the data. Each sample is
+ * assigned entirely to the component of its group. This initialization is
+ * deterministic, so the same pair always yields the same clustering.
+ *
+ * @param N
+ * @param K
+ */
+void VBGMM::initializeResponsibilities(int N, int K)
+{
+   // compute the first principal axis of the covariance
+   float a = _W0inv.s[0];
+   float b = _W0inv.s[1];
+   float c = _W0inv.s[3];
+   float lambda = 0.5f * (a + c) + sqrtf(0.25f * (a - c) * (a - c) + b * b);
+
+   Vector2 axis {{ b, lambda - a }};
+
+   if ( fabs(b) < 1e-12f )
+   {
+      axis = (a >= c) ? Vector2 {{ 1, 0 }} : Vector2 {{ 0, 1 }};
+   }
+
+   // sort the samples by their projection onto the axis
+   for ( int i = 0; i < N; ++i )
+   {
+      _order[i] = i;
+      _projection[i] = _x[i] * axis.s[0] + _y[i] * axis.s[1];
+   }
+
+   std::sort(_order.begin(), _order.begin() + N, [this] (int i, int j)
+   {
+      return _projection[i] < _projection[j] || (_projection[i] == _projection[j] && i < j);
+   });
+
+   // assign each group of samples to a component
+   const int stride = GMM::Kernels::stride(N);
+
+   std::fill(_resp.begin(), _resp.begin() + K * stride, 0.0f);
+
+   for ( int r = 0; r < N; ++r )
+   {
+      int k = static_cast<qint64>(r) * K / N;
+
+      _resp[k * stride + _order[r]] = 1;
+   }
+}
+
+
+
+
+
+
+/*!
+ * Perform the maximization step of the variational algorithm, which updates
+ * the posterior distribution of each component from the responsibilities.
+ * Return false if the scale matrix of any component is singular.
+ *
+ * @param N
+ * @param K
+ */
+bool VBGMM::computeMStep(int N, int K)
+{
+   const int stride = GMM::Kernels::stride(N);
+
+   for ( int k = 0; k < K; ++k )
+   {
+      const float *resp = &_resp[k * stride];
+
+      // compute N_k = sum(r_ki) and xbar_k = sum(r_ki * x_i) / N_k
+      float sums[3];
+      _kernels.moments(resp, _x.data(), _y.data(), N, sums);
+
+      float N_k = sums[0] + 10 * std::numeric_limits<float>::epsilon();
+      Vector2 xbar {{ sums[1] / N_k, sums[2] / N_k }};
+
+      // compute S_k = sum(r_ki * (x_i - xbar_k) (x_i - xbar_k)^T) / N_k
+      _kernels.covariance(resp, _x.data(), _y.data(), N, xbar, sums);
+
+      Matrix2x2 S {{ sums[0], sums[1], sums[1], sums[2] }};
+      matrixScale(S, 1.0f / N_k);
+
+      // update the posterior of the component
+      if ( !_components[k].update(xbar, S, N_k, _alpha0, _beta0, _nu0, _m0, _W0inv) )
+      {
+         return false;
+      }
+   }
+
+   return true;
+}
+
+
+
+
+
+
+/*!
+ * Perform the expectation step of the variational algorithm, which updates
+ * the responsibility of each component for each sample. Return the mean
+ * log-normalizer of the responsibilities, which is used to detect
+ * convergence.
+ *
+ * @param N
+ * @param K
+ */
+float VBGMM::computeEStep(int N, int K)
+{
+   const int stride = GMM::Kernels::stride(N);
+
+   // compute E[log(pi_k)] = psi(alpha_k) - psi(sum(alpha))
+   float alphaSum = 0;
+
+   for ( int k = 0; k < K; ++k )
+   {
+      alphaSum += _components[k]._alpha;
+   }
+
+   float logpi[K];
+
+   for ( int k = 0; k < K; ++k )
+   {
+      logpi[k] = digamma(_components[k]._alpha) - digamma(alphaSum);
+   }
+
+   // compute log(rho) for each component and each sample
+   for ( int k = 0; k < K; ++k )
+   {
+      _components[k].computeLogRho(_kernels, _x.data(), _y.data(), N, &_resp[k * stride]);
+   }
+
+   // compute the normalized responsibilities and the log-normalizers
+   _kernels.responsibilities(_resp.data(), stride, logpi, K, N, _logpx.data());
+
+   float sum = 0;
+
+   for ( int i = 0; i < N; ++i )
+   {
+      sum += _logpx[i];
+   }
+
+   return sum / N;
+}
+
+
+
+
+
+
+/*!
+ * Compute the cluster label of each sample. The components whose expected
+ * mixture weight is below the weight threshold are removed, except that the
+ * minClusters components with the highest weights are always kept. Each sample
+ * is assigned to the remaining component with the highest responsibility, and
+ * the components which are assigned at least one sample are numbered in order.
+ * Return the number of clusters, or zero if the fit is degenerate so that some
+ * sample has no kept component with a valid responsibility, which happens when
+ * the responsibilities are NAN.
+ *
+ * @param N
+ * @param K
+ * @param minClusters
+ * @param labels
+ */
+int VBGMM::computeLabels(int N, int K, int minClusters, QVector<qint8>& labels)
+{
+   // compute the expected mixture weights
+   float alphaSum = 0;
+
+   for ( int k = 0; k < K; ++k )
+   {
+      alphaSum += _components[k]._alpha;
+   }
+
+   // determine which components to keep
+   bool keep[K];
+
+   for ( int k = 0; k < K; ++k )
+   {
+      float weight = _components[k]._alpha / alphaSum;
+      int rank = 0;
+
+      for ( int j = 0; j < K; ++j )
+      {
+         rank += (_components[j]._alpha > _components[k]._alpha)
+            || (_components[j]._alpha == _components[k]._alpha && j < k);
+      }
+
+      keep[k] = (weight >= _weightThreshold || rank < minClusters);
+   }
+
+   // assign each sample to the kept component with the highest responsibility
+   const int stride = GMM::Kernels::stride(N);
+   int counts[K];
+
+   for ( int k = 0; k < K; ++k )
+   {
+      counts[k] = 0;
+   }
+
+   for ( int i = 0; i < N; ++i )
+   {
+      int max_k = -1;
+      float max_resp = -INFINITY;
+
+      for ( int k = 0; k < K; ++k )
+      {
+         if ( keep[k] && max_resp < _resp[k * stride + i] )
+         {
+            max_k = k;
+            max_resp = _resp[k * stride + i];
+         }
+      }
+
+      if ( max_k < 0 )
+      {
+         return 0;
+      }
+
+      labels[i] = max_k;
+      counts[max_k]++;
+   }
+
+   // number the components which have samples
+   qint8 map[K];
+   int numClusters = 0;
+
+   for ( int k = 0; k < K; ++k )
+   {
+      map[k] = (counts[k] > 0) ? numClusters++ : -1;
+   }
+
+   for ( int i = 0; i < N; ++i )
+   {
+      labels[i] = map[labels[i]];
+   }
+
+   return numClusters;
+}
+
+
+
+
+
+
+/*!
+ * Determine the number of clusters in a pairwise data array. A single model
+ * with maxClusters components is fit to the data, and the number of clusters
+ * is the number of components which remain after the components with small
+ * mixture weights are removed.
+ *
+ * @param expressions
+ * @param index
+ * @param numSamples
+ * @param labels
+ * @param minSamples
+ * @param minClusters
+ * @param maxClusters
+ * @param criterion
+ */
+qint8 VBGMM::compute(
+   const float *expressions,
+   const Index& index,
+   int numSamples,
+   QVector<qint8>& labels,
+   int minSamples,
+   qint8 minClusters,
+   qint8 maxClusters,
+   Criterion criterion)
+{
+   Q_UNUSED(criterion);
+
+   // index into gene expressions
+   const float *x = &expressions[static_cast<qint64>(index.getX()) * labels.size()];
+   const float *y = &expressions[static_cast<qint64>(index.getY()) * labels.size()];
+
+   // perform clustering only if there are enough samples
+   if ( numSamples < minSamples )
+   {
+      return 0;
+   }
+
+   // extract clean samples from data array
+   for ( int i = 0, j = 0; i < labels.size(); ++i )
+   {
+      if ( labels[i] >= 0 )
+      {
+         _x[j] = x[i];
+         _y[j] = y[i];
+         ++j;
+      }
+   }
+
+   // initialize the model
+   const int N = numSamples;
+   const int K = std::min(static_cast<int>(maxClusters), N);
+
+   if ( !initializePriors(N, K) )
+   {
+      return 0;
+   }
+
+   initializeResponsibilities(N, K);
+
+   // run the variational algorithm
+   float prevValue = -INFINITY;
+
+   for ( int t = 0; t < MAX_ITERATIONS; ++t )
+   {
+      // return failure if the scale matrix of any component is singular
+      if ( !computeMStep(N, K) )
+      {
+         return 0;
+      }
+
+      float currValue = computeEStep(N, K);
+
+      // check for convergence
+      if ( fabs(currValue - prevValue) < TOLERANCE )
+      {
+         break;
+      }
+
+      prevValue = currValue;
+   }
+
+   // save labels for clean samples
+   int numClusters = computeLabels(N, K, minClusters, _labels);
+
+   for ( int i = 0, j = 0; i < labels.size(); ++i )
+   {
+      if ( labels[i] >= 0 )
+      {
+         labels[i] = _labels[j];
+         ++j;
+      }
+   }
+
+   return numClusters;
+}
@@ -0,0 +1,161 @@
+#ifndef PAIRWISE_VBGMM_H
+#define PAIRWISE_VBGMM_H
+#include "pairwise_gmm.h"
+
+namespace Pairwise
+{
+   /*!
+    * This class implements the variational Bayesian Gaussian mixture model.
+    * Instead of fitting a sub-model for each number of clusters, a single
+    * model with the maximum number of clusters is fit to the data with a
+    * Dirichlet prior on the mixture weights, which drives the weights of
+    * unneeded components towards zero. The number of clusters is the number of
+    * components whose expected mixture weight is at least a given threshold.
+    * The criterion argument of compute() is therefore not used.
+    *
+    * The per-sample steps of the variational algorithm have the same form as
+    * the EM steps of the Gaussian mixture model, so they are computed by the
+    * SIMD kernels in GMM::Kernels.
+    */
+   class VBGMM : public ClusteringModel
+   {
+   public:
+      VBGMM(ExpressionMatrix* emx, qint8 maxClusters, float weightThreshold, SimdLevel level = simdLevel());
+   public:
+      class Component
+      {
+      public:
+         Component() = default;
+         bool update(const Vector2& xbar, const Matrix2x2& S, float N_k, float alpha0, float beta0, float nu0, const Vector2& m0, const Matrix2x2& W0inv);
+         void computeLogRho(const GMM::Kernels& kernels, const float *x, const float *y, int N, float *logRho);
+      public:
+         /*!
+          * The concentration parameter of the mixture weight.
+          */
+         float _alpha;
+         /*!
+          * The scale of the precision of the mean.
+          */
+         float _beta;
+         /*!
+          * The degrees of freedom of the Wishart distribution.
+          */
+         float _nu;
+         /*!
+          * The mean of the mean.
+          */
+         Vector2 _m;
+         /*!
+          * The scale matrix of the Wishart distribution.
+          */
+         Matrix2x2 _W;
+      private:
+         /*!
+          * The expected precision matrix, which is nu * W.
+          */
+         Matrix2x2 _precision;
+         /*!
+          * A normalization term which is pre-computed from the expected
+          * log-determinant of the precision matrix.
+          */
+         float _normalizer;
+      };
+   public:
+      virtual qint8 compute(
+         const float *expressions,
+         const Index& index,
+         int numSamples,
+         QVector<qint8>& labels,
+         int minSamples,
+         qint8 minClusters,
+         qint8 maxClusters,
+         Criterion criterion
+      ) override final;
+      /*!
+       * The maximum number of iterations of the variational algorithm.
+       */
+      constexpr static int MAX_ITERATIONS {100};
+      /*!
+       * The minimum change in the mean log-normalizer of the responsibilities
+       * between iterations, below which the algorithm has converged.
+       */
+      constexpr static float TOLERANCE {1e-7f};
+   private:
+      static float digamma(float x);
+      bool initializePriors(int N, int K);
+      void initializeResponsibilities(int N, int K);
+      bool computeMStep(int N, int K);
+      float computeEStep(int N, int K);
+      int computeLabels(int N, int K, int minClusters, QVector<qint8>& labels);
+   private:
+      /*!
+       * The SIMD kernels of the variational algorithm.
+       */
+      const GMM::Kernels& _kernels;
+      /*!
+       * The minimum expected mixture weight of a component which is counted as
+       * a cluster.
+       */
+      float _weightThreshold;
+      /*!
+       * Workspace for the x values of the clustering data, padded for the SIMD
+       * kernels.
+       */
+      std::vector<float> _x;
+      /*!
+       * Workspace for the y values of the clustering data, padded for the SIMD
+       * kernels.
+       */
+      std::vector<float> _y;
+      /*!
+       * Workspace for the log-normalizer of the responsibilities of each
+       * sample.
+       */
+      std::vector<float> _logpx;
+      /*!
+       * Workspace for the cluster labels.
+       */
+      QVector<qint8> _labels;
+      /*!
+       * Workspace for the order of samples along the first principal axis.
+       */
+      std::vector<int> _order;
+      /*!
+       * Workspace for the projection of each sample onto the first principal
+       * axis.
+       */
+      std::vector<float> _projection;
+      /*!
+       * The list of mixture components.
+       */
+      QVector<Component> _components;
+      /*!
+       * The responsibility of each component for each sample, which has one
+       * row of padded samples for each component.
+       */
+      std::vector<float> _resp;
+      /*!
+       * The prior concentration of the mixture weights.
+       */
+      float _alpha0;
+      /*!
+       * The prior scale of the precision of the means.
+       */
+      float _beta0;
+      /*!
+       * The prior degrees of freedom of the Wishart distribution.
+       */
+      float _nu0;
+      /*!
+       * The prior mean, which is the mean of the data.
+       */
+      Vector2 _m0;
+      /*!
+       * The inverse of the prior scale matrix of the Wishart distribution,
+       * which is proportional to the covariance of the data.
+       */
+      Matrix2x2 _W0inv;
+   };
+}
+
+#endif
@@ -42,7 +42,8 @@ void PowerLaw::process(const EAbstractAnalyticBlock*)
    QTextStream stream(_logfile);
 
    // load raw correlation data, row-wise maximums
-   std::vector<RawPair> pairs {_input->dumpRawData()};
+   CorrelationMatrix::RawData data {_input->dumpRawData()};
+   const std::vector<RawPair>& pairs = data.pairs;
    std::vector<float> maximums {computeMaximums(pairs)};
 
    // continue until network is sufficiently scale-free
@@ -166,7 +167,7 @@ std::vector<float> PowerLaw::computeMaximums(const std::vector<RawPair>& pairs)
    {
       int i = pair.index.getX();
 
-      for ( size_t k = 0; k < pair.correlations.size(); ++k )
+      for ( int k = 0; k < pair.clusterSize; ++k )
       {
          float correlation = fabs(pair.correlations[k]);
 
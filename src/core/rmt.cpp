@@ -90,7 +90,8 @@ void RMT::process(const EAbstractAnalyticBlock*)
    float threshold {_thresholdStart};
 
    // load raw correlation data, row-wise maximums
-   std::vector<RawPair> pairs {_input->dumpRawData()};
+   CorrelationMatrix::RawData data {_input->dumpRawData()};
+   const std::vector<RawPair>& pairs = data.pairs;
    std::vector<float> maximums {computeMaximums(pairs)};
 
    // continue while max chi is less than final threshold
@@ -248,7 +249,7 @@ std::vector<float> RMT::computeMaximums(const std::vector<RawPair>& pairs)
    {
       int i = pair.index.getX();
 
-      for ( size_t k = 0; k < pair.correlations.size(); ++k )
+      for ( int k = 0; k < pair.clusterSize; ++k )
       {
          float correlation = fabs(pair.correlations[k]);
 
@@ -331,7 +332,7 @@ std::vector<float> RMT::computePruneMatrix(const std::vector<RawPair>& pairs, co
       }
       case ReductionMethod::MaximumCorrelation:
       {
-         for ( size_t k = 0; k < pair.correlations.size(); k++ )
+         for ( int k = 0; k < pair.clusterSize; k++ )
          {
             float r = fabs(pair.correlations[k]);
 
@@ -351,7 +352,7 @@ std::vector<float> RMT::computePruneMatrix(const std::vector<RawPair>& pairs, co
       }
       case ReductionMethod::Random:
       {
-         int k = qrand() % pair.correlations.size();
+         int k = qrand() % pair.clusterSize;
          correlation = pair.correlations[k];
          break;
       }
@@ -3,12 +3,14 @@
 #include "similarity_resultblock.h"
 #include "similarity_serial.h"
 #include "similarity_workblock.h"
+#include "similarity_writer.h"
 #include "similarity_opencl.h"
 #include "similarity_cuda.h"
-#include "ccmatrix_pair.h"
-#include "correlationmatrix_pair.h"
+#include "pairwise_tiledcorrelation.h"
+#include "expressionmatrix_tilecache.h"
 #include <ace/core/ace_qmpi.h>
 #include <ace/core/elog.h>
+#include <unistd.h>
 
 
 
@@ -19,6 +21,23 @@ using namespace std;
 
 
 
+/*!
+ * Destruct this analytic. If the output writer still exists, which happens if
+ * the analytic stopped before the last result block, its thread is stopped
+ * and joined before the output data objects can be destroyed.
+ */
+Similarity::~Similarity()
+{
+   EDEBUG_FUNC(this);
+
+   _writer.reset();
+}
+
+
+
+
+
+
 /*!
  * Compute the next power of 2 which occurs after a number.
  *
@@ -40,6 +59,77 @@ int Similarity::nextPower2(int n)
 
 
 
+/*!
+ * Compute the first and third quartiles of an array of values, which are the
+ * values at positions n/4 and 3n/4 of the sorted array, as used by the Tukey
+ * method of outlier removal. The array is partially reordered by selection
+ * instead of being sorted.
+ *
+ * @param values
+ * @param n
+ * @param Q1
+ * @param Q3
+ */
+void Similarity::computeQuartiles(float *values, int n, float *Q1, float *Q3)
+{
+   const int k1 = n * 1 / 4;
+   const int k3 = n * 3 / 4;
+
+   // select the first quartile
+   std::nth_element(values, values + k1, values + n);
+   *Q1 = values[k1];
+
+   // select the third quartile from the values above the first quartile
+   if ( k3 > k1 )
+   {
+      std::nth_element(values + k1 + 1, values + k3, values + n);
+   }
+
+   *Q3 = values[k3];
+}
+
+
+
+
+
+
+/*!
+ * Compute the first and third quartiles of each gene over all samples, which
+ * are the quartiles used by pre-clustering outlier removal for any pair with
+ * no missing or below-threshold samples. The quartiles of each gene are saved
+ * as a pair of values. Genes with missing values are given NAN quartiles,
+ * since they can not occur in such a pair.
+ *
+ * @param expressions
+ * @param geneSize
+ * @param sampleSize
+ */
+std::vector<float> Similarity::computeGeneQuartiles(const float *expressions, int geneSize, int sampleSize)
+{
+   std::vector<float> quartiles(2 * geneSize, NAN);
+   std::vector<float> values(sampleSize);
+
+   for ( int i = 0; i < geneSize; ++i )
+   {
+      const float *x = &expressions[static_cast<qint64>(i) * sampleSize];
+
+      if ( std::any_of(x, x + sampleSize, [](float value) { return std::isnan(value); }) )
+      {
+         continue;
+      }
+
+      std::copy(x, x + sampleSize, values.begin());
+      computeQuartiles(values.data(), sampleSize, &quartiles[2 * i + 0], &quartiles[2 * i + 1]);
+   }
+
+   return quartiles;
+}
+
+
+
+
+
+
 /*!
  * Return the total number of pairs that must be processed for a given
  * expression matrix.
@@ -59,12 +149,19 @@ qint64 Similarity::totalPairs(const ExpressionMatrix* emx)
 
 
 /*!
- * Return the total number of work blocks this analytic must process.
+ * Return the total number of work blocks this analytic must process. In the
+ * tiled and owner work orders, there is one work block for each tile in the
+ * lower triangle of the pairwise matrix, including the tiles on the diagonal.
  */
 int Similarity::size() const
 {
    EDEBUG_FUNC(this);
 
+   if ( _workOrder != WorkOrder::Linear )
+   {
+      return Pairwise::Index::tileCount(_input->geneSize(), _tileSize);
+   }
+
    return (totalPairs(_input) + _workBlockSize - 1) / _workBlockSize;
 }
 
@@ -76,7 +173,8 @@ int Similarity::size() const
 /*!
  * Create and return a work block for this analytic with the given index. This
  * implementation creates a work block with a start index and size denoting the
- * number of pairs to process.
+ * number of pairs to process, or a work block with a tile of rows and columns
+ * in the tiled work order.
  *
  * @param index
  */
@@ -89,10 +187,7 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::makeWork(int index) const
       ELog() << tr("Making work index %1 of %2.\n").arg(index).arg(size());
    }
 
-   qint64 start {index * static_cast<qint64>(_workBlockSize)};
-   qint64 size {min(totalPairs(_input) - start, static_cast<qint64>(_workBlockSize))};
-
-   return unique_ptr<EAbstractAnalyticBlock>(new WorkBlock(index, start, size));
+   return makeWorkBlock(index);
 }
 
 
@@ -133,7 +228,12 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::makeResult() const
 /*!
  * Read in a block of results made from a block of work with the corresponding
  * index. This implementation takes the Pair objects in the result block and
- * saves them to the output correlation matrix and cluster matrix.
+ * saves them to the output correlation matrix and cluster matrix. Since the
+ * output data objects must be written in pairwise order, the pairs of a tile
+ * in the tiled work order are held until every tile in the same row of tiles
+ * has been processed, at which point they are sorted and written. The pairs
+ * are written by the output writer on its own thread, which only needs to be
+ * waited on after the last block.
  *
  * @param result
  */
@@ -148,49 +248,307 @@ void Similarity::process(const EAbstractAnalyticBlock* result)
 
    const ResultBlock* resultBlock {result->cast<ResultBlock>()};
 
-   // iterate through all pairs in result block
-   Pairwise::Index index {resultBlock->start()};
+   // accumulate the statistics of the clustering models
+   _agreement.pairs += resultBlock->agreement().pairs;
+   _agreement.sameK += resultBlock->agreement().sameK;
+   _agreement.sumARI += resultBlock->agreement().sumARI;
+
+   const QVector<qint64>& iterations {resultBlock->iterations()};
+
+   if ( _iterations.size() < iterations.size() )
+   {
+      _iterations.resize(iterations.size());
+   }
+
+   for ( int i = 0; i < iterations.size(); ++i )
+   {
+      _iterations[i] += iterations[i];
+   }
+
+   const QVector<qint64>& skipped {resultBlock->skipped()};
+
+   if ( _skipped.size() < skipped.size() )
+   {
+      _skipped.resize(skipped.size());
+   }
+
+   for ( int i = 0; i < skipped.size(); ++i )
+   {
+      _skipped[i] += skipped[i];
+   }
+
+   // accumulate the counts of local and remote reads of gene expressions
+   _numaAccess.local += resultBlock->numaAccess().local;
+   _numaAccess.remote += resultBlock->numaAccess().remote;
 
-   for ( auto& pair : resultBlock->pairs() )
+   // accumulate the access statistics of the tile cache
+   _tileAccess.hits += resultBlock->tileAccess().hits;
+   _tileAccess.misses += resultBlock->tileAccess().misses;
+   _tileAccess.reads += resultBlock->tileAccess().reads;
+   _tileAccess.evictions += resultBlock->tileAccess().evictions;
+
+   // report the statistics of the clustering models after the last block
+   if ( result->index() == size() - 1 )
    {
-      // save correlations that are within thresholds
-      CCMatrix::Pair ccmPair(_ccm);
-      CorrelationMatrix::Pair cmxPair(_cmx);
+      if ( _clusMethod == ClusteringMethod::VBGMM && _vbCompare )
+      {
+         reportAgreement();
+      }
+
+      if ( !_iterations.isEmpty() )
+      {
+         reportIterations();
+      }
 
-      for ( qint8 k = 0; k < pair.K; ++k )
+      if ( !_skipped.isEmpty() && _selection != Pairwise::Selection::Full )
       {
-         // determine whether correlation is within thresholds
-         float corr = pair.correlations[k];
-
-         if ( !isnan(corr) && _minCorrelation <= abs(corr) && abs(corr) <= _maxCorrelation )
-         {
-            // save sample string
-            ccmPair.addCluster();
-
-            for ( int i = 0; i < _input->sampleSize(); ++i )
-            {
-               ccmPair.at(ccmPair.clusterSize() - 1, i) = (pair.labels[i] >= 0)
-                  ? (k == pair.labels[i])
-                  : -pair.labels[i];
-            }
-
-            // save correlation
-            cmxPair.addCluster();
-            cmxPair.at(cmxPair.clusterSize() - 1) = corr;
-         }
+         reportSkipped();
       }
 
-      if ( ccmPair.clusterSize() > 0 )
+      if ( _numaAccess.local + _numaAccess.remote > 0 )
       {
-         ccmPair.write(index);
+         reportNumaAccess();
       }
 
-      if ( cmxPair.clusterSize() > 0 )
+      if ( _tileAccess.hits + _tileAccess.misses > 0 )
+      {
+         reportTileAccess();
+      }
+   }
+
+   // initialize the output writer on the first result block
+   if ( !_writer )
+   {
+      _writer.reset(new Writer(_ccm, _cmx));
+   }
+
+   // save pairs of a linear work block in the order they were processed,
+   // which only contains the pairs within the thresholds
+   if ( _workOrder == WorkOrder::Linear )
+   {
+      for ( int i = 0; i < resultBlock->size(); ++i )
+      {
+         _writer->append(resultBlock->index(i), resultBlock->pair(i));
+      }
+   }
+   else
+   {
+      processTiled(resultBlock);
+   }
+
+   // write the pairs of this block while the next block is collected, and
+   // wait for all pairs to be written after the last block
+   _writer->submit();
+
+   if ( result->index() == size() - 1 )
+   {
+      _writer->flush();
+      _writer.reset();
+   }
+}
+
+
+
+
+
+
+/*!
+ * Save the pairs of a result block in the tiled work order. The pairs of a
+ * row of tiles are saved until the last tile of the row, which lies on the
+ * diagonal, and are then written in pairwise order.
+ *
+ * @param resultBlock
+ */
+void Similarity::processTiled(const ResultBlock* resultBlock)
+{
+   EDEBUG_FUNC(this,resultBlock);
+
+   // save pairs of a tile, which are all within the thresholds
+   for ( int i = 0; i < resultBlock->size(); ++i )
+   {
+      Pair pair {resultBlock->pair(i)};
+
+      _tiledPairs.push_back({ resultBlock->index(i), static_cast<qint64>(_tiledK.size()) });
+      _tiledK.push_back(pair.K);
+      _tiledLabels.insert(_tiledLabels.end(), pair.labels, pair.labels + _input->sampleSize());
+      _tiledCorrelations.insert(_tiledCorrelations.end(), pair.correlations, pair.correlations + _maxClusters);
+   }
+
+   // write the pairs of a row of tiles in pairwise order after its last tile
+   unique_ptr<WorkBlock> workBlock {makeWorkBlock(resultBlock->index())};
+
+   if ( workBlock->colStart() == workBlock->rowStart() )
+   {
+      std::sort(_tiledPairs.begin(), _tiledPairs.end(), [] (const std::pair<Pairwise::Index,qint64>& a, const std::pair<Pairwise::Index,qint64>& b)
+      {
+         return a.first.getX() < b.first.getX()
+            || (a.first.getX() == b.first.getX() && a.first.getY() < b.first.getY());
+      });
+
+      for ( auto& tiledPair : _tiledPairs )
       {
-         cmxPair.write(index);
+         qint64 i {tiledPair.second};
+         Pair pair {
+            _tiledK[i],
+            &_tiledLabels[i * _input->sampleSize()],
+            &_tiledCorrelations[i * _maxClusters]
+         };
+
+         _writer->append(tiledPair.first, pair);
       }
 
-      ++index;
+      _tiledPairs.clear();
+      _tiledK.clear();
+      _tiledLabels.clear();
+      _tiledCorrelations.clear();
+   }
+}
+
+
+
+
+
+
+/*!
+ * Create the work block with the given index. In the tiled work order, the
+ * tiles are numbered as in Pairwise::Index::tileAt(), so the tiles of each row
+ * of tiles have consecutive indices and the last tile of each row lies on the
+ * diagonal. In the owner work order, the tiles of each row of tiles are
+ * permuted by Pairwise::Index::ownedTile(), which keeps both properties.
+ *
+ * @param index
+ */
+std::unique_ptr<Similarity::WorkBlock> Similarity::makeWorkBlock(int index) const
+{
+   EDEBUG_FUNC(this,index);
+
+   if ( _workOrder != WorkOrder::Linear )
+   {
+      qint64 position {index};
+
+      if ( _workOrder == WorkOrder::Owner )
+      {
+         position = Pairwise::Index::ownedTile(index, _numOwners);
+      }
+
+      Pairwise::Index::Tile tile {Pairwise::Index::tileAt(position, _input->geneSize(), _tileSize)};
+
+      return unique_ptr<WorkBlock>(new WorkBlock(index, tile.rowStart, tile.rowEnd, tile.colStart, tile.colEnd));
+   }
+
+   qint64 start {index * static_cast<qint64>(_workBlockSize)};
+   qint64 size {min(totalPairs(_input) - start, static_cast<qint64>(_workBlockSize))};
+
+   return unique_ptr<WorkBlock>(new WorkBlock(index, start, size));
+}
+
+
+
+
+
+
+/*!
+ * Report the agreement statistics of the variational Bayesian clustering model
+ * and the Gaussian mixture model over all pairs which were clustered by both
+ * models.
+ */
+void Similarity::reportAgreement() const
+{
+   EDEBUG_FUNC(this);
+
+   qint64 pairs {max(_agreement.pairs, 1LL)};
+
+   qInfo("\n");
+   qInfo("agreement of VBGMM with GMM:");
+   qInfo("pairs clustered:          %lld", _agreement.pairs);
+   qInfo("same number of clusters:  %lld (%0.1f%%)", _agreement.sameK, 100.0 * _agreement.sameK / pairs);
+   qInfo("mean adjusted Rand index: %0.3f", _agreement.sumARI / pairs);
+}
+
+
+
+
+
+
+/*!
+ * Report the histogram of the number of EM iterations of the Gaussian mixture
+ * model over all sub-models which were fit successfully. The iterations are
+ * grouped into bins of ten iterations, and the last bin contains the fits
+ * which reached the maximum number of iterations.
+ */
+void Similarity::reportIterations() const
+{
+   EDEBUG_FUNC(this);
+
+   const int BIN_SIZE {10};
+   const int numBins {(_iterations.size() - 2) / BIN_SIZE + 2};
+
+   // compute the number of fits in each bin
+   QVector<qint64> bins(numBins, 0);
+   qint64 fits {0};
+   qint64 total {0};
+
+   for ( int i = 0; i < _iterations.size(); ++i )
+   {
+      int bin {(i == _iterations.size() - 1) ? numBins - 1 : i / BIN_SIZE};
+
+      bins[bin] += _iterations[i];
+      fits += _iterations[i];
+      total += i * _iterations[i];
+   }
+
+   qint64 maxCount {max(*std::max_element(bins.begin(), bins.end()), 1LL)};
+
+   // visualize the histogram
+   qInfo("\n");
+   qInfo("EM iterations: %lld fits, %0.1f iterations per fit", fits, static_cast<double>(total) / max(fits, 1LL));
+
+   for ( int b = 0; b < numBins; ++b )
+   {
+      int start {b * BIN_SIZE};
+      int end {(b == numBins - 1) ? _iterations.size() - 1 : min(start + BIN_SIZE, _iterations.size() - 1) - 1};
+      QString bar(static_cast<int>(50 * bins[b] / maxCount), '#');
+
+      qInfo(" %3d-%3d | %10lld | %s", start, end, bins[b], bar.toStdString().c_str());
+   }
+}
+
+
+
+
+
+
+/*!
+ * Report the histogram of the number of sub-models of each pair which were
+ * abandoned or skipped by the model selection strategy of the Gaussian mixture
+ * model, and the fraction of all sub-models which were skipped.
+ */
+void Similarity::reportSkipped() const
+{
+   EDEBUG_FUNC(this);
+
+   // compute the total number of pairs and skipped sub-models
+   qint64 pairs {0};
+   qint64 total {0};
+
+   for ( int i = 0; i < _skipped.size(); ++i )
+   {
+      pairs += _skipped[i];
+      total += i * _skipped[i];
+   }
+
+   qint64 fits {pairs * (_maxClusters - _minClusters + 1)};
+   qint64 maxCount {max(*std::max_element(_skipped.begin(), _skipped.end()), 1LL)};
+
+   // visualize the histogram
+   qInfo("\n");
+   qInfo("Skipped fits: %lld of %lld fits (%0.1f%%) over %lld pairs", total, fits, 100.0 * total / max(fits, 1LL), pairs);
+
+   for ( int i = 0; i < _skipped.size(); ++i )
+   {
+      QString bar(static_cast<int>(50 * _skipped[i] / maxCount), '#');
+
+      qInfo(" %7d | %10lld | %s", i, _skipped[i], bar.toStdString().c_str());
    }
 }
 
@@ -230,12 +588,20 @@ EAbstractAnalyticSerial* Similarity::makeSerial()
 
 
 /*!
- * Make a new OpenCL object and return its pointer.
+ * Make a new OpenCL object and return its pointer. The OpenCL implementation
+ * does not support the variational Bayesian clustering model or the
+ * out-of-core tile cache, so no object is returned in those cases and the
+ * serial implementation is used instead.
  */
 EAbstractAnalyticOpenCL* Similarity::makeOpenCL()
 {
    EDEBUG_FUNC(this);
 
+   if ( _clusMethod == ClusteringMethod::VBGMM || isOutOfCore() )
+   {
+      return nullptr;
+   }
+
    return new OpenCL(this);
 }
 
@@ -245,12 +611,20 @@ EAbstractAnalyticOpenCL* Similarity::makeOpenCL()
 
 
 /*!
- * Make a new CUDA object and return its pointer.
+ * Make a new CUDA object and return its pointer. The CUDA implementation does
+ * not support the variational Bayesian clustering model or the out-of-core
+ * tile cache, so no object is returned in those cases and the serial
+ * implementation is used instead.
  */
 EAbstractAnalyticCUDA* Similarity::makeCUDA()
 {
    EDEBUG_FUNC(this);
 
+   if ( _clusMethod == ClusteringMethod::VBGMM || isOutOfCore() )
+   {
+      return nullptr;
+   }
+
    return new CUDA(this);
 }
 
@@ -294,12 +668,78 @@ void Similarity::initialize()
       throw e;
    }
 
+   // make sure the execution engine supports the given methods
+   if ( _engine == Engine::BLAS
+        && (_clusMethod != ClusteringMethod::None || _removePreOutliers) )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Invalid Argument"));
+      e.setDetails(tr("The BLAS engine requires no clustering and no pre-clustering outlier removal."));
+      throw e;
+   }
+
+   if ( _engine == Engine::BLAS && isOutOfCore() )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Invalid Argument"));
+      e.setDetails(tr("The BLAS engine requires the entire expression matrix in memory."));
+      throw e;
+   }
+
    // initialize work block size
    if ( _workBlockSize == 0 )
    {
       int numWorkers = max(1, mpi.size() - 1);
 
-      _workBlockSize = min(32768LL, totalPairs(_input) / numWorkers);
+      // use blocks which span several rows of the pairwise matrix for the BLAS engine
+      qint64 maxBlockSize {32768LL};
+
+      if ( _engine == Engine::BLAS )
+      {
+         maxBlockSize = min(
+            static_cast<qint64>(Pairwise::TiledCorrelation::TILE_SIZE) * _input->geneSize(),
+            static_cast<qint64>(numeric_limits<int>::max())
+         );
+      }
+
+      _workBlockSize = min(maxBlockSize, totalPairs(_input) / numWorkers);
+   }
+
+   // initialize tile size so that two tiles of genes fit in the L2 cache
+   if ( _workOrder == WorkOrder::Tiled && _tileSize == 0 )
+   {
+      qint64 cacheSize {sysconf(_SC_LEVEL2_CACHE_SIZE)};
+
+      if ( cacheSize <= 0 )
+      {
+         cacheSize = 256 * 1024;
+      }
+
+      qint64 geneBytes {_input->sampleSize() * static_cast<qint64>(sizeof(float))};
+
+      _tileSize = max(16LL, cacheSize / (2 * geneBytes));
+   }
+
+   // initialize tile size so that each worker owns several column tiles of
+   // whole tiles of the tile cache, and deal the tiles to the workers
+   if ( _workOrder == WorkOrder::Owner )
+   {
+      int numWorkers = max(1, mpi.size() - 1);
+
+      if ( _tileSize == 0 )
+      {
+         int cacheTileSize {ExpressionMatrix::TileCache::selectTileSize(_input)};
+         int cacheTiles {(_input->geneSize() + cacheTileSize - 1) / cacheTileSize};
+
+         _tileSize = cacheTileSize * max(1, cacheTiles / (OWNER_TILES * numWorkers));
+      }
+
+      _numOwners = numWorkers;
+   }
+
+   if ( _workOrder != WorkOrder::Linear )
+   {
+      _tileSize = min(_tileSize, _input->geneSize());
    }
 }
 
@@ -324,9 +764,61 @@ void Similarity::initializeOutputs()
       throw e;
    }
 
-   // initialize cluster matrix
-   _ccm->initialize(_input->geneNames(), _maxClusters, _input->sampleNames());
+   // initialize cluster matrix, using the label format if it can represent
+   // every pair
+   CCMatrix::Format format {(_maxClusters <= CCMatrix::MAX_LABEL_CLUSTERS)
+      ? CCMatrix::Format::Labels
+      : CCMatrix::Format::Masks};
+
+   _ccm->initialize(_input->geneNames(), _maxClusters, _input->sampleNames(), format);
 
    // initialize correlation matrix
    _cmx->initialize(_input->geneNames(), _maxClusters, _corrName);
 }
+
+
+
+
+
+
+/*!
+ * Report the counts of reads of gene expressions from the local NUMA node and
+ * from remote NUMA nodes over all pairs which were processed by the serial
+ * worker.
+ */
+void Similarity::reportNumaAccess() const
+{
+   EDEBUG_FUNC(this);
+
+   qint64 total {max(_numaAccess.local + _numaAccess.remote, 1LL)};
+
+   qInfo("\n");
+   qInfo("NUMA access of gene expressions:");
+   qInfo("local reads:  %lld (%0.1f%%)", _numaAccess.local, 100.0 * _numaAccess.local / total);
+   qInfo("remote reads: %lld (%0.1f%%)", _numaAccess.remote, 100.0 * _numaAccess.remote / total);
+}
+
+
+
+
+
+
+/*!
+ * Report the access statistics of the out-of-core tile cache over all pairs
+ * which were processed by the serial workers. A high miss rate means that the
+ * memory limit holds too few tiles for the work order, in which case the
+ * tiled work order or a larger memory limit should be used.
+ */
+void Similarity::reportTileAccess() const
+{
+   EDEBUG_FUNC(this);
+
+   qint64 total {max(_tileAccess.hits + _tileAccess.misses, 1LL)};
+
+   qInfo("\n");
+   qInfo("Tile cache of gene expressions:");
+   qInfo("hits:       %lld (%0.1f%%)", _tileAccess.hits, 100.0 * _tileAccess.hits / total);
+   qInfo("misses:     %lld (%0.1f%%)", _tileAccess.misses, 100.0 * _tileAccess.misses / total);
+   qInfo("tiles read: %lld", _tileAccess.reads);
+   qInfo("evictions:  %lld", _tileAccess.evictions);
+}
@@ -24,14 +24,16 @@
  *
  * This analytic can use MPI and it has both CPU and GPU implementations, as the
  * pairwise clustering significantly increases the amount of computations required
- * for a large expression matrix.
+ * for a large expression matrix. The CPU implementation can also stream tiles of
+ * genes from an expression matrix which does not fit in memory.
  */
 class Similarity : public EAbstractAnalytic
 {
    Q_OBJECT
 public:
    /*!
-    * Defines the pair structure used to send results in result blocks.
+    * Defines a view of the results of a pair, which are stored in the arrays
+    * of a result block.
     */
    struct Pair
    {
@@ -40,23 +42,88 @@ public:
        */
       qint8 K;
       /*!
-       * The cluster labels for a pair.
+       * Pointer to the cluster labels for a pair.
        */
-      QVector<qint8> labels;
+      const qint8 *labels;
       /*!
-       * The correlation for each cluster in a pair.
+       * Pointer to the correlation for each cluster in a pair.
        */
-      QVector<float> correlations;
+      const float *correlations;
+   };
+   /*!
+    * Defines the agreement statistics between the variational Bayesian
+    * clustering model and the reference clustering model, which is the
+    * Gaussian mixture model with model selection.
+    */
+   struct Agreement
+   {
+      /*!
+       * The number of pairs which were clustered by both models.
+       */
+      qint64 pairs {0};
+      /*!
+       * The number of pairs for which both models found the same number of
+       * clusters.
+       */
+      qint64 sameK {0};
+      /*!
+       * The sum of the adjusted Rand index of the labels of both models.
+       */
+      double sumARI {0};
+   };
+   /*!
+    * Defines the counts of reads of gene expressions from memory on the NUMA
+    * node of the reading thread and from memory on another NUMA node. Each
+    * pair reads the expressions of two genes.
+    */
+   struct NumaAccess
+   {
+      /*!
+       * The number of gene reads from the local NUMA node.
+       */
+      qint64 local {0};
+      /*!
+       * The number of gene reads from a remote NUMA node.
+       */
+      qint64 remote {0};
+   };
+   /*!
+    * Defines the access statistics of the out-of-core tile cache of gene
+    * expressions.
+    */
+   struct TileAccess
+   {
+      /*!
+       * The number of acquired tiles which were already in memory.
+       */
+      qint64 hits {0};
+      /*!
+       * The number of acquired tiles which had to be read first.
+       */
+      qint64 misses {0};
+      /*!
+       * The number of tiles which were read from the expression matrix.
+       */
+      qint64 reads {0};
+      /*!
+       * The number of tiles which were evicted from memory.
+       */
+      qint64 evictions {0};
    };
    class Input;
    class WorkBlock;
    class ResultBlock;
    class Serial;
+   class ThreadPool;
+   class Writer;
    class OpenCL;
    class CUDA;
 public:
+   ~Similarity();
    static int nextPower2(int n);
    static qint64 totalPairs(const ExpressionMatrix* emx);
+   static void computeQuartiles(float *values, int n, float *Q1, float *Q3);
+   static std::vector<float> computeGeneQuartiles(const float *expressions, int geneSize, int sampleSize);
 public:
    virtual int size() const override final;
    virtual std::unique_ptr<EAbstractAnalyticBlock> makeWork(int index) const override final;
@@ -83,6 +150,10 @@ private:
        * Gaussian mixture models
        */
       ,GMM
+      /*!
+       * Variational Bayesian Gaussian mixture models
+       */
+      ,VBGMM
    };
    /*!
     * Defines the correlation methods this analytic supports.
@@ -98,7 +169,80 @@ private:
        */
       ,Spearman
    };
+   /*!
+    * Defines the execution engines this analytic supports.
+    */
+   enum class Engine
+   {
+      /*!
+       * Process each pair independently
+       */
+      Pairwise
+      /*!
+       * Compute tiles of correlations with BLAS matrix products
+       */
+      ,BLAS
+   };
+   /*!
+    * Defines the orders in which the pairwise matrix can be divided into work
+    * blocks.
+    */
+   enum class WorkOrder
+   {
+      /*!
+       * Contiguous ranges of pairwise indices
+       */
+      Linear
+      /*!
+       * Square tiles of rows and columns
+       */
+      ,Tiled
+      /*!
+       * Square tiles of rows and columns which are ordered so that each
+       * worker keeps the tiles of the same columns
+       */
+      ,Owner
+   };
+   /*!
+    * Defines the NUMA policies for the expression data and the threads of the
+    * serial worker.
+    */
+   enum class NumaPolicy
+   {
+      /*!
+       * Do not place the expression data or pin the threads
+       */
+      None
+      /*!
+       * Keep a copy of the expression data on each NUMA node and pin each
+       * thread to a core, so that every thread reads its local copy
+       */
+      ,Replicate
+      /*!
+       * Interleave the pages of the expression data across all NUMA nodes
+       * and pin each thread to a core
+       */
+      ,Interleave
+   };
 private:
+   /*!
+    * Return whether the serial worker reads the expression data through the
+    * out-of-core tile cache.
+    */
+   bool isOutOfCore() const { return _memoryLimit > 0 || _workOrder == WorkOrder::Owner; }
+   std::unique_ptr<WorkBlock> makeWorkBlock(int index) const;
+   void reportAgreement() const;
+   void reportIterations() const;
+   void reportSkipped() const;
+   void reportNumaAccess() const;
+   void reportTileAccess() const;
+   void processTiled(const ResultBlock* resultBlock);
+private:
+   /*!
+    * The number of column tiles which each worker owns by default in the
+    * owner work order.
+    */
+   constexpr static int OWNER_TILES {4};
    /*!
     * Pointer to the input expression matrix.
     */
@@ -119,6 +263,10 @@ private:
     * The correlation method to use.
     */
    CorrelationMethod _corrMethod {CorrelationMethod::Pearson};
+   /*!
+    * The execution engine to use.
+    */
+   Engine _engine {Engine::Pairwise};
    /*!
     * The name of the correlation method.
     */
@@ -143,6 +291,35 @@ private:
     * The model selection criterion to use in the clustering model.
     */
    Pairwise::Criterion _criterion {Pairwise::Criterion::ICL};
+   /*!
+    * The strategy to select the number of clusters in the clustering model.
+    */
+   Pairwise::Selection _selection {Pairwise::Selection::Full};
+   /*!
+    * The minimum mixture weight of a cluster in the variational Bayesian
+    * clustering model.
+    */
+   float _vbThreshold {0.05};
+   /*!
+    * Whether to compare the variational Bayesian clustering model with the
+    * Gaussian mixture model.
+    */
+   bool _vbCompare {false};
+   /*!
+    * The agreement statistics of the result blocks which have been
+    * processed.
+    */
+   Agreement _agreement;
+   /*!
+    * The histogram of the number of EM iterations of the Gaussian mixture
+    * model over the result blocks which have been processed.
+    */
+   QVector<qint64> _iterations;
+   /*!
+    * The histogram of the number of skipped sub-models of each pair over the
+    * result blocks which have been processed.
+    */
+   QVector<qint64> _skipped;
    /*!
     * Whether to remove outliers before clustering.
     */
@@ -159,10 +336,56 @@ private:
     * The maximum (absolute) correlation threshold to save a correlation.
     */
    float _maxCorrelation {1.0};
+   /*!
+    * The number of threads to use in each serial worker.
+    */
+   int _numThreads {1};
    /*!
     * The number of pairs to process in each work block.
     */
    int _workBlockSize {0};
+   /*!
+    * The order in which the pairwise matrix is divided into work blocks.
+    */
+   WorkOrder _workOrder {WorkOrder::Linear};
+   /*!
+    * The number of rows and columns in each tile of the tiled and owner work
+    * orders.
+    */
+   int _tileSize {0};
+   /*!
+    * The number of workers among which the owner work order deals the tiles
+    * of each row of tiles.
+    */
+   int _numOwners {1};
+   /*!
+    * The pairs of the current row of tiles which are within the correlation
+    * thresholds. Since the pairs of a row of tiles are interleaved in pairwise
+    * order, the index of each pair and its position in the arrays below are
+    * saved here until the last tile of the row is processed, and then the
+    * pairs are written to the output data objects in pairwise order.
+    */
+   std::vector<std::pair<Pairwise::Index,qint64>> _tiledPairs;
+   /*!
+    * The number of clusters of each saved pair of the current row of tiles.
+    */
+   std::vector<qint8> _tiledK;
+   /*!
+    * The cluster labels of each saved pair of the current row of tiles, with
+    * one row of samples for each pair.
+    */
+   std::vector<qint8> _tiledLabels;
+   /*!
+    * The correlations of each saved pair of the current row of tiles, with
+    * one row of the maximum number of clusters for each pair.
+    */
+   std::vector<float> _tiledCorrelations;
+   /*!
+    * Pointer to the output writer, which is created for the first result
+    * block and deleted after the last result block has been written, or
+    * when this analytic is destroyed if it stops before the last block.
+    */
+   std::unique_ptr<Writer> _writer;
    /*!
     * The global work size for each OpenCL worker.
     */
@@ -171,6 +394,31 @@ private:
     * The local work size for each OpenCL worker.
     */
    int _localWorkSize {32};
+   /*!
+    * Whether to request huge pages for the shared view of the expression
+    * matrix.
+    */
+   bool _hugePages {false};
+   /*!
+    * The NUMA policy for the expression data and the threads of the serial
+    * worker.
+    */
+   NumaPolicy _numaPolicy {NumaPolicy::None};
+   /*!
+    * The counts of local and remote reads of gene expressions over the result
+    * blocks which have been processed.
+    */
+   NumaAccess _numaAccess;
+   /*!
+    * The maximum amount of memory in MiB for the expression data of each
+    * serial worker, or zero if the entire expression matrix is loaded.
+    */
+   int _memoryLimit {0};
+   /*!
+    * The access statistics of the tile cache over the result blocks which
+    * have been processed.
+    */
+   TileAccess _tileAccess;
 };
 
 
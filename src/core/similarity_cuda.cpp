@@ -1,5 +1,6 @@
 #include "similarity_cuda.h"
 #include "similarity_cuda_worker.h"
+#include "expressionmatrix_view.h"
 
 
 
@@ -67,11 +68,20 @@ void Similarity::CUDA::initialize(::CUDA::Context* context)
    _program = new ::CUDA::Program(paths, this);
 
    // create buffer for expression data
-   std::vector<float> rawData = _base->_input->dumpRawData();
-   _expressions = ::CUDA::Buffer<float>(rawData.size());
+   std::shared_ptr<const ExpressionMatrix::View> rawData {_base->_input->mapRawData(_base->_hugePages)};
+   _expressions = ::CUDA::Buffer<float>(rawData->size());
 
    // copy expression data to device
-   memcpy(_expressions.hostData(), rawData.data(), rawData.size() * sizeof(float));
+   memcpy(_expressions.hostData(), rawData->data(), rawData->size() * sizeof(float));
 
    _expressions.write().wait();
+
+   // create buffer for the quartiles of each gene
+   std::vector<float> quartiles = computeGeneQuartiles(rawData->data(), _base->_input->geneSize(), _base->_input->sampleSize());
+   _quartiles = ::CUDA::Buffer<float>(quartiles.size());
+
+   // copy quartiles to device
+   memcpy(_quartiles.hostData(), quartiles.data(), quartiles.size() * sizeof(float));
+
+   _quartiles.write().wait();
 }
@@ -39,6 +39,10 @@ private:
     * CUDA buffer for this object's expression matrix.
     */
    ::CUDA::Buffer<float> _expressions;
+   /*!
+    * CUDA buffer for the quartiles of each gene.
+    */
+   ::CUDA::Buffer<float> _quartiles;
 };
 
 
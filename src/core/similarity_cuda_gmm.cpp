@@ -40,6 +40,7 @@ Similarity::CUDA::GMM::GMM(::CUDA::Program* program):
  * @param minClusters
  * @param maxClusters
  * @param criterion
+ * @param selection
  * @param work_xy
  * @param work_N
  * @param work_labels
@@ -62,6 +63,7 @@ Similarity::CUDA::GMM::GMM(::CUDA::Program* program):
    char minClusters,
    char maxClusters,
    int criterion,
+   int selection,
    ::CUDA::Buffer<float>* work_xy,
    ::CUDA::Buffer<int>* work_N,
    ::CUDA::Buffer<qint8>* work_labels,
@@ -85,6 +87,7 @@ Similarity::CUDA::GMM::GMM(::CUDA::Program* program):
       minClusters,
       maxClusters,
       criterion,
+      selection,
       work_xy,
       work_N,
       work_labels,
@@ -105,6 +108,7 @@ Similarity::CUDA::GMM::GMM(::CUDA::Program* program):
    setArgument(MinClusters, minClusters);
    setArgument(MaxClusters, maxClusters);
    setArgument(Criterion, criterion);
+   setArgument(Selection, selection);
    setBuffer(WorkXY, work_xy);
    setBuffer(WorkN, work_N);
    setBuffer(WorkLabels, work_labels);
@@ -39,6 +39,7 @@ public:
       ,MinClusters
       ,MaxClusters
       ,Criterion
+      ,Selection
       ,WorkXY
       ,WorkN
       ,WorkLabels
@@ -62,6 +63,7 @@ public:
       char minClusters,
       char maxClusters,
       int criterion,
+      int selection,
       ::CUDA::Buffer<float>* work_xy,
       ::CUDA::Buffer<int>* work_N,
       ::CUDA::Buffer<qint8>* work_labels,
@@ -39,6 +39,7 @@ Similarity::CUDA::Outlier::Outlier(::CUDA::Program* program):
  * @param in_N
  * @param in_labels
  * @param in_K
+ * @param in_quartiles
  * @param marker
  * @param work_xy
  */
@@ -52,6 +53,7 @@ Similarity::CUDA::Outlier::Outlier(::CUDA::Program* program):
    ::CUDA::Buffer<int>* in_N,
    ::CUDA::Buffer<qint8>* in_labels,
    ::CUDA::Buffer<qint8>* in_K,
+   ::CUDA::Buffer<float>* in_quartiles,
    qint8 marker,
    ::CUDA::Buffer<float>* work_xy
 )
@@ -66,6 +68,7 @@ Similarity::CUDA::Outlier::Outlier(::CUDA::Program* program):
       in_N,
       in_labels,
       in_K,
+      in_quartiles,
       marker,
       work_xy);
 
@@ -77,6 +80,7 @@ Similarity::CUDA::Outlier::Outlier(::CUDA::Program* program):
    setBuffer(InN, in_N);
    setBuffer(InLabels, in_labels);
    setBuffer(InK, in_K);
+   setBuffer(InQuartiles, in_quartiles);
    setArgument(Marker, marker);
    setBuffer(WorkXY, work_xy);
 
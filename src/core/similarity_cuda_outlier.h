@@ -22,6 +22,7 @@ public:
       ,InN
       ,InLabels
       ,InK
+      ,InQuartiles
       ,Marker
       ,WorkXY
    };
@@ -36,6 +37,7 @@ public:
       ::CUDA::Buffer<int>* in_N,
       ::CUDA::Buffer<qint8>* in_labels,
       ::CUDA::Buffer<qint8>* in_K,
+      ::CUDA::Buffer<float>* in_quartiles,
       qint8 marker,
       ::CUDA::Buffer<float>* work_xy
    );
@@ -80,13 +80,15 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::CUDA::Worker::execute(const
    const WorkBlock* workBlock {block->cast<const WorkBlock>()};
 
    // initialize result block
-   ResultBlock* resultBlock {new ResultBlock(workBlock->index(), workBlock->start())};
+   ResultBlock* resultBlock {new ResultBlock(workBlock->index(), workBlock->start(), _base->_maxClusters, _base->_input->sampleSize())};
+
+   resultBlock->resize(workBlock->size());
 
    // bind cuda context to current thread
    _baseCuda->_context->setCurrent();
 
    // iterate through all pairs
-   Pairwise::Index index {workBlock->start()};
+   Pairwise::Index index {workBlock->begin()};
 
    for ( int i = 0; i < workBlock->size(); i += _base->_globalWorkSize )
    {
@@ -96,7 +98,7 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::CUDA::Worker::execute(const
       for ( int j = 0; j < globalWorkSize; ++j )
       {
          _buffers.in_index[j] = { index.getX(), index.getY() };
-         ++index;
+         workBlock->increment(index);
       }
 
       _buffers.in_index.write(_stream);
@@ -127,6 +129,7 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::CUDA::Worker::execute(const
             &_buffers.work_N,
             &_buffers.out_labels,
             &_buffers.out_K,
+            &_baseCuda->_quartiles,
             -7,
             &_buffers.work_xy
          );
@@ -146,6 +149,7 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::CUDA::Worker::execute(const
             _base->_minClusters,
             _base->_maxClusters,
             (int) _base->_criterion,
+            (int) _base->_selection,
             &_buffers.work_xy,
             &_buffers.work_N,
             &_buffers.work_labels,
@@ -182,6 +186,7 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::CUDA::Worker::execute(const
             &_buffers.work_N,
             &_buffers.out_labels,
             &_buffers.out_K,
+            &_baseCuda->_quartiles,
             -8,
             &_buffers.work_xy
          );
@@ -236,22 +241,21 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::CUDA::Worker::execute(const
          const qint8 *labels = &_buffers.out_labels.at(j * _base->_input->sampleSize());
          const float *correlations = &_buffers.out_correlations.at(j * _base->_maxClusters);
 
-         Pair pair;
-
          // save the number of clusters
-         pair.K = _buffers.out_K.at(j);
+         resultBlock->K(i + j) = _buffers.out_K.at(j);
 
          // save the cluster labels and correlations (if the pair was able to be processed)
-         if ( pair.K > 0 )
+         if ( resultBlock->K(i + j) > 0 )
          {
-            pair.labels = ResultBlock::makeVector(labels, _base->_input->sampleSize());
-            pair.correlations = ResultBlock::makeVector(correlations, _base->_maxClusters);
+            std::copy(labels, labels + _base->_input->sampleSize(), resultBlock->labels(i + j));
+            std::copy(correlations, correlations + _base->_maxClusters, resultBlock->correlations(i + j));
          }
-
-         resultBlock->append(pair);
       }
    }
 
+   // remove the results which are not within the correlation thresholds
+   resultBlock->filter(workBlock, _base->_minCorrelation, _base->_maxCorrelation);
+
    // return result block
    return unique_ptr<EAbstractAnalyticBlock>(resultBlock);
 }
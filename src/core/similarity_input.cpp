@@ -15,6 +15,7 @@ const QStringList Similarity::Input::CLUSTERING_NAMES
 {
    "none"
    ,"gmm"
+   ,"vbgmm"
 };
 
 
@@ -55,6 +56,73 @@ const QStringList Similarity::Input::CRITERION_NAMES
 
 
 
+/*!
+ * String list of model selection strategies for this analytic that correspond
+ * exactly to its enumeration. Used for handling the selection argument for this
+ * input object.
+ */
+const QStringList Similarity::Input::SELECTION_NAMES
+{
+   "full"
+   ,"extrapolate"
+   ,"first"
+};
+
+
+
+
+
+
+/*!
+ * String list of execution engines for this analytic that correspond exactly
+ * to its enumeration. Used for handling the engine argument for this input
+ * object.
+ */
+const QStringList Similarity::Input::ENGINE_NAMES
+{
+   "pairwise"
+   ,"blas"
+};
+
+
+
+
+
+
+/*!
+ * String list of work orders for this analytic that correspond exactly to its
+ * enumeration. Used for handling the work order argument for this input
+ * object.
+ */
+const QStringList Similarity::Input::WORK_ORDER_NAMES
+{
+   "linear"
+   ,"tiled"
+   ,"owner"
+};
+
+
+
+
+
+
+/*!
+ * String list of NUMA policies for this analytic that correspond exactly to
+ * its enumeration. Used for handling the NUMA policy argument for this input
+ * object.
+ */
+const QStringList Similarity::Input::NUMA_NAMES
+{
+   "none"
+   ,"replicate"
+   ,"interleave"
+};
+
+
+
+
+
+
 /*!
  * Construct a new input object with the given analytic as its parent.
  *
@@ -108,13 +176,23 @@ EAbstractAnalyticInput::Type Similarity::Input::type(int index) const
    case MinClusters: return Type::Integer;
    case MaxClusters: return Type::Integer;
    case CriterionType: return Type::Selection;
+   case SelectionType: return Type::Selection;
+   case VBThreshold: return Type::Double;
+   case VBCompare: return Type::Boolean;
    case RemovePreOutliers: return Type::Boolean;
    case RemovePostOutliers: return Type::Boolean;
    case MinCorrelation: return Type::Double;
    case MaxCorrelation: return Type::Double;
+   case EngineType: return Type::Selection;
+   case NumThreads: return Type::Integer;
    case WorkBlockSize: return Type::Integer;
+   case WorkOrderType: return Type::Selection;
+   case TileSize: return Type::Integer;
    case GlobalWorkSize: return Type::Integer;
    case LocalWorkSize: return Type::Integer;
+   case HugePages: return Type::Boolean;
+   case NumaPolicyType: return Type::Selection;
+   case MemoryLimit: return Type::Integer;
    default: return Type::Boolean;
    }
 }
@@ -237,6 +315,36 @@ QVariant Similarity::Input::data(int index, Role role) const
       case Role::Default: return "ICL";
       default: return QVariant();
       }
+   case SelectionType:
+      switch (role)
+      {
+      case Role::CommandLineName: return QString("select");
+      case Role::Title: return tr("Model Selection:");
+      case Role::WhatsThis: return tr("Strategy to select the number of clusters in the GMM clustering method. Full fits every number of clusters and gives the exact selection. The other strategies are heuristics which can change the selected clusters of some pairs. Extrapolate abandons a fit when an extrapolation of its log-likelihood suggests that it cannot have the best criterion value. First also stops at the first number of clusters which does not improve the criterion value, which is faster but less accurate.");
+      case Role::SelectionValues: return SELECTION_NAMES;
+      case Role::Default: return "full";
+      default: return QVariant();
+      }
+   case VBThreshold:
+      switch (role)
+      {
+      case Role::CommandLineName: return QString("vbthresh");
+      case Role::Title: return tr("VBGMM Weight Threshold:");
+      case Role::WhatsThis: return tr("Minimum mixture weight of a cluster in the VBGMM clustering method. Components with smaller weights are removed.");
+      case Role::Default: return 0.05;
+      case Role::Minimum: return 0;
+      case Role::Maximum: return 1;
+      default: return QVariant();
+      }
+   case VBCompare:
+      switch (role)
+      {
+      case Role::CommandLineName: return QString("vbcompare");
+      case Role::Title: return tr("Compare VBGMM with GMM:");
+      case Role::WhatsThis: return tr("Whether to also cluster each pair with GMM and the selected criterion when using the VBGMM clustering method, and report how often both methods agree. This option is intended for evaluation and makes clustering slower.");
+      case Role::Default: return false;
+      default: return QVariant();
+      }
    case RemovePreOutliers:
       switch (role)
       {
@@ -277,6 +385,27 @@ QVariant Similarity::Input::data(int index, Role role) const
       case Role::Maximum: return 1;
       default: return QVariant();
       }
+   case EngineType:
+      switch (role)
+      {
+      case Role::CommandLineName: return QString("engine");
+      case Role::Title: return tr("Execution Engine:");
+      case Role::WhatsThis: return tr("Engine to use for the serial worker. The BLAS engine computes tiles of correlations with matrix products and can only be used with no clustering and no pre-clustering outlier removal.");
+      case Role::SelectionValues: return ENGINE_NAMES;
+      case Role::Default: return "pairwise";
+      default: return QVariant();
+      }
+   case NumThreads:
+      switch (role)
+      {
+      case Role::CommandLineName: return QString("threads");
+      case Role::Title: return tr("Number of Threads:");
+      case Role::WhatsThis: return tr("The number of threads to use in each serial worker.");
+      case Role::Default: return 1;
+      case Role::Minimum: return 1;
+      case Role::Maximum: return std::numeric_limits<int>::max();
+      default: return QVariant();
+      }
    case WorkBlockSize:
       switch (role)
       {
@@ -288,6 +417,27 @@ QVariant Similarity::Input::data(int index, Role role) const
       case Role::Maximum: return std::numeric_limits<int>::max();
       default: return QVariant();
       }
+   case WorkOrderType:
+      switch (role)
+      {
+      case Role::CommandLineName: return QString("order");
+      case Role::Title: return tr("Work Order:");
+      case Role::WhatsThis: return tr("Order in which pairs are divided into work blocks. The linear order uses contiguous ranges of pairs; the tiled order uses square tiles of genes which fit in the L2 cache; the owner order uses larger tiles of genes and deals them so that each MPI worker reuses the same column tiles in every row, which each worker reads through the tile cache of the memory limit.");
+      case Role::SelectionValues: return WORK_ORDER_NAMES;
+      case Role::Default: return "linear";
+      default: return QVariant();
+      }
+   case TileSize:
+      switch (role)
+      {
+      case Role::CommandLineName: return QString("tsize");
+      case Role::Title: return tr("Tile Size:");
+      case Role::WhatsThis: return tr("Number of genes in each row and column of a tile in the tiled and owner work orders. If zero, the tile size is determined from the size of the L2 cache in the tiled order and from the number of workers in the owner order.");
+      case Role::Default: return 0;
+      case Role::Minimum: return 0;
+      case Role::Maximum: return std::numeric_limits<int>::max();
+      default: return QVariant();
+      }
    case GlobalWorkSize:
       switch (role)
       {
@@ -310,6 +460,36 @@ QVariant Similarity::Input::data(int index, Role role) const
       case Role::Maximum: return std::numeric_limits<int>::max();
       default: return QVariant();
       }
+   case HugePages:
+      switch (role)
+      {
+      case Role::CommandLineName: return QString("hugepages");
+      case Role::Title: return tr("Use Huge Pages:");
+      case Role::WhatsThis: return tr("Whether to request huge pages for the expression data. The expression data is shared by every worker on a node, and huge pages reduce TLB misses when it is large.");
+      case Role::Default: return false;
+      default: return QVariant();
+      }
+   case NumaPolicyType:
+      switch (role)
+      {
+      case Role::CommandLineName: return QString("numa");
+      case Role::Title: return tr("NUMA Policy:");
+      case Role::WhatsThis: return tr("NUMA placement of the expression data for the serial worker. The replicate policy keeps a copy of the expression data on each NUMA node and pins each thread to a core, so that every thread reads from local memory. The interleave policy spreads the pages of a single copy across all NUMA nodes and also pins each thread. The counts of local and remote reads are reported at the end of the analytic.");
+      case Role::SelectionValues: return NUMA_NAMES;
+      case Role::Default: return "none";
+      default: return QVariant();
+      }
+   case MemoryLimit:
+      switch (role)
+      {
+      case Role::CommandLineName: return QString("memory");
+      case Role::Title: return tr("Memory Limit (MiB):");
+      case Role::WhatsThis: return tr("Maximum amount of memory in MiB for the expression data of each worker. If zero, the entire expression matrix is loaded into memory. Otherwise tiles of genes are read from the expression matrix as the work blocks need them, which allows expression matrices that are larger than memory. This mode uses the serial worker with the pairwise engine, and it works best with the tiled or owner work order.");
+      case Role::Default: return 0;
+      case Role::Minimum: return 0;
+      case Role::Maximum: return std::numeric_limits<int>::max();
+      default: return QVariant();
+      }
    default: return QVariant();
    }
 }
@@ -353,6 +533,15 @@ void Similarity::Input::set(int index, const QVariant& value)
    case CriterionType:
       _base->_criterion = static_cast<Pairwise::Criterion>(CRITERION_NAMES.indexOf(value.toString()));
       break;
+   case SelectionType:
+      _base->_selection = static_cast<Pairwise::Selection>(SELECTION_NAMES.indexOf(value.toString()));
+      break;
+   case VBThreshold:
+      _base->_vbThreshold = value.toFloat();
+      break;
+   case VBCompare:
+      _base->_vbCompare = value.toBool();
+      break;
    case RemovePreOutliers:
       _base->_removePreOutliers = value.toBool();
       break;
@@ -365,15 +554,36 @@ void Similarity::Input::set(int index, const QVariant& value)
    case MaxCorrelation:
       _base->_maxCorrelation = value.toFloat();
       break;
+   case EngineType:
+      _base->_engine = static_cast<Engine>(ENGINE_NAMES.indexOf(value.toString()));
+      break;
+   case NumThreads:
+      _base->_numThreads = value.toInt();
+      break;
    case WorkBlockSize:
       _base->_workBlockSize = value.toInt();
       break;
+   case WorkOrderType:
+      _base->_workOrder = static_cast<WorkOrder>(WORK_ORDER_NAMES.indexOf(value.toString()));
+      break;
+   case TileSize:
+      _base->_tileSize = value.toInt();
+      break;
    case GlobalWorkSize:
       _base->_globalWorkSize = value.toInt();
       break;
    case LocalWorkSize:
       _base->_localWorkSize = value.toInt();
       break;
+   case HugePages:
+      _base->_hugePages = value.toBool();
+      break;
+   case NumaPolicyType:
+      _base->_numaPolicy = static_cast<NumaPolicy>(NUMA_NAMES.indexOf(value.toString()));
+      break;
+   case MemoryLimit:
+      _base->_memoryLimit = value.toInt();
+      break;
    }
 }
 
@@ -26,13 +26,23 @@ public:
       ,MinClusters
       ,MaxClusters
       ,CriterionType
+      ,SelectionType
+      ,VBThreshold
+      ,VBCompare
       ,RemovePreOutliers
       ,RemovePostOutliers
       ,MinCorrelation
       ,MaxCorrelation
+      ,EngineType
+      ,NumThreads
       ,WorkBlockSize
+      ,WorkOrderType
+      ,TileSize
       ,GlobalWorkSize
       ,LocalWorkSize
+      ,HugePages
+      ,NumaPolicyType
+      ,MemoryLimit
       ,Total
    };
    explicit Input(Similarity* parent);
@@ -46,6 +56,10 @@ private:
    static const QStringList CLUSTERING_NAMES;
    static const QStringList CORRELATION_NAMES;
    static const QStringList CRITERION_NAMES;
+   static const QStringList SELECTION_NAMES;
+   static const QStringList ENGINE_NAMES;
+   static const QStringList WORK_ORDER_NAMES;
+   static const QStringList NUMA_NAMES;
    /*!
     * Pointer to the base analytic for this object.
     */
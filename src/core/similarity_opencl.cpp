@@ -1,5 +1,6 @@
 #include "similarity_opencl.h"
 #include "similarity_opencl_worker.h"
+#include "expressionmatrix_view.h"
 
 
 
@@ -70,13 +71,24 @@ void Similarity::OpenCL::initialize(::OpenCL::Context* context)
    _queue = new ::OpenCL::CommandQueue(context, context->devices().first(), this);
 
    // create buffer for expression data
-   std::vector<float> rawData = _base->_input->dumpRawData();
-   _expressions = ::OpenCL::Buffer<cl_float>(context,rawData.size());
+   std::shared_ptr<const ExpressionMatrix::View> rawData {_base->_input->mapRawData(_base->_hugePages)};
+   _expressions = ::OpenCL::Buffer<cl_float>(context,rawData->size());
 
    // copy expression data to device
    _expressions.mapWrite(_queue).wait();
 
-   memcpy(_expressions.data(), rawData.data(), rawData.size() * sizeof(float));
+   memcpy(_expressions.data(), rawData->data(), rawData->size() * sizeof(float));
 
    _expressions.unmap(_queue).wait();
+
+   // create buffer for the quartiles of each gene
+   std::vector<float> quartiles = computeGeneQuartiles(rawData->data(), _base->_input->geneSize(), _base->_input->sampleSize());
+   _quartiles = ::OpenCL::Buffer<cl_float>(context, quartiles.size());
+
+   // copy quartiles to device
+   _quartiles.mapWrite(_queue).wait();
+
+   memcpy(_quartiles.data(), quartiles.data(), quartiles.size() * sizeof(float));
+
+   _quartiles.unmap(_queue).wait();
 }
@@ -43,6 +43,10 @@ private:
     * Pointer to this object's OpenCL buffer for the expression matrix.
     */
    ::OpenCL::Buffer<cl_float> _expressions;
+   /*!
+    * Pointer to this object's OpenCL buffer for the quartiles of each gene.
+    */
+   ::OpenCL::Buffer<cl_float> _quartiles;
 };
 
 
@@ -41,6 +41,7 @@ Similarity::OpenCL::GMM::GMM(::OpenCL::Program* program, QObject* parent):
  * @param minClusters
  * @param maxClusters
  * @param criterion
+ * @param selection
  * @param work_xy
  * @param work_N
  * @param work_labels
@@ -63,6 +64,7 @@ Similarity::OpenCL::GMM::GMM(::OpenCL::Program* program, QObject* parent):
    cl_char minClusters,
    cl_char maxClusters,
    cl_int criterion,
+   cl_int selection,
    ::OpenCL::Buffer<cl_float>* work_xy,
    ::OpenCL::Buffer<cl_int>* work_N,
    ::OpenCL::Buffer<cl_char>* work_labels,
@@ -86,6 +88,7 @@ Similarity::OpenCL::GMM::GMM(::OpenCL::Program* program, QObject* parent):
       minClusters,
       maxClusters,
       &criterion,
+      &selection,
       work_xy,
       work_N,
       work_labels,
@@ -109,6 +112,7 @@ Similarity::OpenCL::GMM::GMM(::OpenCL::Program* program, QObject* parent):
    setArgument(MinClusters, minClusters);
    setArgument(MaxClusters, maxClusters);
    setArgument(Criterion, criterion);
+   setArgument(Selection, selection);
    setBuffer(WorkXY, work_xy);
    setBuffer(WorkN, work_N);
    setBuffer(WorkLabels, work_labels);
@@ -40,6 +40,7 @@ public:
       ,MinClusters
       ,MaxClusters
       ,Criterion
+      ,Selection
       ,WorkXY
       ,WorkN
       ,WorkLabels
@@ -63,6 +64,7 @@ public:
       cl_char minClusters,
       cl_char maxClusters,
       cl_int criterion,
+      cl_int selection,
       ::OpenCL::Buffer<cl_float>* work_xy,
       ::OpenCL::Buffer<cl_int>* work_N,
       ::OpenCL::Buffer<cl_char>* work_labels,
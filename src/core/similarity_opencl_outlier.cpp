@@ -40,6 +40,7 @@ Similarity::OpenCL::Outlier::Outlier(::OpenCL::Program* program, QObject* parent
  * @param in_N
  * @param in_labels
  * @param in_K
+ * @param in_quartiles
  * @param marker
  * @param work_xy
  */
@@ -53,6 +54,7 @@ Similarity::OpenCL::Outlier::Outlier(::OpenCL::Program* program, QObject* parent
    ::OpenCL::Buffer<cl_int>* in_N,
    ::OpenCL::Buffer<cl_char>* in_labels,
    ::OpenCL::Buffer<cl_char>* in_K,
+   ::OpenCL::Buffer<cl_float>* in_quartiles,
    cl_char marker,
    ::OpenCL::Buffer<cl_float>* work_xy
 )
@@ -67,6 +69,7 @@ Similarity::OpenCL::Outlier::Outlier(::OpenCL::Program* program, QObject* parent
       in_N,
       in_labels,
       in_K,
+      in_quartiles,
       marker,
       work_xy);
 
@@ -81,6 +84,7 @@ Similarity::OpenCL::Outlier::Outlier(::OpenCL::Program* program, QObject* parent
    setBuffer(InN, in_N);
    setBuffer(InLabels, in_labels);
    setBuffer(InK, in_K);
+   setBuffer(InQuartiles, in_quartiles);
    setArgument(Marker, marker);
    setBuffer(WorkXY, work_xy);
 
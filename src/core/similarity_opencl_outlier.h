@@ -23,6 +23,7 @@ public:
       ,InN
       ,InLabels
       ,InK
+      ,InQuartiles
       ,Marker
       ,WorkXY
    };
@@ -37,6 +38,7 @@ public:
       ::OpenCL::Buffer<cl_int>* in_N,
       ::OpenCL::Buffer<cl_char>* in_labels,
       ::OpenCL::Buffer<cl_char>* in_K,
+      ::OpenCL::Buffer<cl_float>* in_quartiles,
       cl_char marker,
       ::OpenCL::Buffer<cl_float>* work_xy
    );
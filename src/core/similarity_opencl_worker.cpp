@@ -82,10 +82,12 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::OpenCL::Worker::execute(cons
    const WorkBlock* workBlock {block->cast<const WorkBlock>()};
 
    // initialize result block
-   ResultBlock* resultBlock {new ResultBlock(workBlock->index(), workBlock->start())};
+   ResultBlock* resultBlock {new ResultBlock(workBlock->index(), workBlock->start(), _base->_maxClusters, _base->_input->sampleSize())};
+
+   resultBlock->resize(workBlock->size());
 
    // iterate through all pairs
-   Pairwise::Index index {workBlock->start()};
+   Pairwise::Index index {workBlock->begin()};
 
    for ( int i = 0; i < workBlock->size(); i += _base->_globalWorkSize )
    {
@@ -97,7 +99,7 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::OpenCL::Worker::execute(cons
       for ( int j = 0; j < globalWorkSize; ++j )
       {
          _buffers.in_index[j] = { index.getX(), index.getY() };
-         ++index;
+         workBlock->increment(index);
       }
 
       _buffers.in_index.unmap(_queue).wait();
@@ -128,6 +130,7 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::OpenCL::Worker::execute(cons
             &_buffers.work_N,
             &_buffers.out_labels,
             &_buffers.out_K,
+            &_baseOpenCL->_quartiles,
             -7,
             &_buffers.work_xy
          ).wait();
@@ -147,6 +150,7 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::OpenCL::Worker::execute(cons
             _base->_minClusters,
             _base->_maxClusters,
             (cl_int) _base->_criterion,
+            (cl_int) _base->_selection,
             &_buffers.work_xy,
             &_buffers.work_N,
             &_buffers.work_labels,
@@ -185,6 +189,7 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::OpenCL::Worker::execute(cons
             &_buffers.work_N,
             &_buffers.out_labels,
             &_buffers.out_K,
+            &_baseOpenCL->_quartiles,
             -8,
             &_buffers.work_xy
          ).wait();
@@ -240,19 +245,15 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::OpenCL::Worker::execute(cons
          const qint8 *labels = &_buffers.out_labels.at(j * _base->_input->sampleSize());
          const float *correlations = &_buffers.out_correlations.at(j * _base->_maxClusters);
 
-         Pair pair;
-
          // save the number of clusters
-         pair.K = _buffers.out_K.at(j);
+         resultBlock->K(i + j) = _buffers.out_K.at(j);
 
          // save the cluster labels and correlations (if the pair was able to be processed)
-         if ( pair.K > 0 )
+         if ( resultBlock->K(i + j) > 0 )
          {
-            pair.labels = ResultBlock::makeVector(labels, _base->_input->sampleSize());
-            pair.correlations = ResultBlock::makeVector(correlations, _base->_maxClusters);
+            std::copy(labels, labels + _base->_input->sampleSize(), resultBlock->labels(i + j));
+            std::copy(correlations, correlations + _base->_maxClusters, resultBlock->correlations(i + j));
          }
-
-         resultBlock->append(pair);
       }
 
       auto e4 {_buffers.out_K.unmap(_queue)};
@@ -264,6 +265,9 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::OpenCL::Worker::execute(cons
       e6.wait();
    }
 
+   // remove the results which are not within the correlation thresholds
+   resultBlock->filter(workBlock, _base->_minCorrelation, _base->_maxCorrelation);
+
    // return result block
    return unique_ptr<EAbstractAnalyticBlock>(resultBlock);
 }
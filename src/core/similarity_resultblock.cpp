@@ -1,4 +1,9 @@
 #include "similarity_resultblock.h"
+#include "similarity_workblock.h"
+
+
+
+using namespace std;
 
 
 
@@ -6,16 +11,86 @@
 
 
 /*!
- * Construct a new block with the given index and starting pairwise index.
+ * Construct a new block with the given index and starting pairwise index,
+ * with rows of correlations and labels of the given lengths.
  *
  * @param index
  * @param start
+ * @param maxClusters
+ * @param sampleSize
  */
-Similarity::ResultBlock::ResultBlock(int index, qint64 start):
+Similarity::ResultBlock::ResultBlock(int index, qint64 start, int maxClusters, int sampleSize):
    EAbstractAnalyticBlock(index),
-   _start(start)
+   _start(start),
+   _maxClusters(maxClusters),
+   _sampleSize(sampleSize)
+{
+   EDEBUG_FUNC(this,index,start,maxClusters,sampleSize);
+}
+
+
+
+
+
+
+/*!
+ * Return a view of the results of a pair in this block.
+ *
+ * @param i
+ */
+Similarity::Pair Similarity::ResultBlock::pair(int i) const
+{
+   return {
+      _K[i],
+      _labels.data() + static_cast<qint64>(_rows[i]) * _sampleSize,
+      _correlations.data() + static_cast<qint64>(i) * _maxClusters
+   };
+}
+
+
+
+
+
+
+/*!
+ * Resize this block to the given number of pairs, with a row of labels for
+ * each pair. The number of clusters of each pair is initialized to zero.
+ *
+ * @param size
+ */
+void Similarity::ResultBlock::resize(int size)
+{
+   EDEBUG_FUNC(this,size);
+
+   resize(size, size);
+
+   for ( int i = 0; i < size; ++i )
+   {
+      _rows[i] = i;
+   }
+}
+
+
+
+
+
+
+/*!
+ * Resize this block to the given number of pairs and the given number of rows
+ * of labels. The number of clusters of each pair is initialized to zero, and
+ * the row offset of each pair must be set with setRow().
+ *
+ * @param size
+ * @param numRows
+ */
+void Similarity::ResultBlock::resize(int size, int numRows)
 {
-   EDEBUG_FUNC(this,index,start);
+   EDEBUG_FUNC(this,size,numRows);
+
+   _K.fill(0, size);
+   _correlations.resize(static_cast<qint64>(size) * _maxClusters);
+   _rows.fill(0, size);
+   _labels.resize(static_cast<qint64>(numRows) * _sampleSize);
 }
 
 
@@ -24,15 +99,16 @@ Similarity::ResultBlock::ResultBlock(int index, qint64 start):
 
 
 /*!
- * Append a pair to the result block's list of pairs.
+ * Resize the rows of labels of this block to the given number of rows, without
+ * changing the pairs or their row offsets. New rows are initialized to zero.
  *
- * @param pair
+ * @param numRows
  */
-void Similarity::ResultBlock::append(const Pair& pair)
+void Similarity::ResultBlock::resizeRows(int numRows)
 {
-   EDEBUG_FUNC(this,&pair);
+   EDEBUG_FUNC(this,numRows);
 
-   _pairs.append(pair);
+   _labels.resize(static_cast<qint64>(numRows) * _sampleSize);
 }
 
 
@@ -41,7 +117,86 @@ void Similarity::ResultBlock::append(const Pair& pair)
 
 
 /*!
- * Write this block's data to the given data stream.
+ * Remove the results which are not within the given correlation thresholds
+ * from this block. The correlation of each cluster which is not within the
+ * thresholds is set to NAN, every pair without any remaining cluster is
+ * removed, and the pairwise index of each remaining pair is saved from the
+ * given work block. The rows of labels which are still referenced are kept in
+ * their original order, so a row which is shared by several pairs remains
+ * shared.
+ *
+ * @param workBlock
+ * @param minCorrelation
+ * @param maxCorrelation
+ */
+void Similarity::ResultBlock::filter(const WorkBlock* workBlock, float minCorrelation, float maxCorrelation)
+{
+   EDEBUG_FUNC(this,workBlock,minCorrelation,maxCorrelation);
+
+   std::vector<qint32> rowMap(_labels.size() / max(1, _sampleSize), -1);
+   std::vector<qint8> filteredLabels;
+   Pairwise::Index index {workBlock->begin()};
+   int size = 0;
+
+   _indices.clear();
+
+   for ( int i = 0; i < _K.size(); ++i, workBlock->increment(index) )
+   {
+      // remove the clusters which are not within the thresholds
+      float *correlations {this->correlations(i)};
+      bool keep = false;
+
+      for ( qint8 k = 0; k < _K[i]; ++k )
+      {
+         if ( isWithin(correlations[k], minCorrelation, maxCorrelation) )
+         {
+            keep = true;
+         }
+         else
+         {
+            correlations[k] = NAN;
+         }
+      }
+
+      if ( !keep )
+      {
+         continue;
+      }
+
+      // move the pair to the next position of the filtered block
+      qint32& row {rowMap[_rows[i]]};
+
+      if ( row == -1 )
+      {
+         row = filteredLabels.size() / _sampleSize;
+         filteredLabels.insert(filteredLabels.end(), labels(i), labels(i) + _sampleSize);
+      }
+
+      _K[size] = _K[i];
+      _rows[size] = row;
+      std::copy(correlations, correlations + _K[i], this->correlations(size));
+      _indices.append(index.getX());
+      _indices.append(index.getY());
+
+      ++size;
+   }
+
+   _K.resize(size);
+   _correlations.resize(static_cast<qint64>(size) * _maxClusters);
+   _rows.resize(size);
+   _labels.swap(filteredLabels);
+}
+
+
+
+
+
+
+/*!
+ * Write this block's data to the given data stream. Only the correlations of
+ * the remaining clusters of each pair are written, with a bit mask of the
+ * remaining clusters of each pair, and the labels are packed into 4 bits per
+ * sample if the maximum number of clusters allows it.
  *
  * @param stream
  */
@@ -50,14 +205,68 @@ void Similarity::ResultBlock::write(QDataStream& stream) const
    EDEBUG_FUNC(this,&stream);
 
    stream << _start;
-   stream << _pairs.size();
+   stream << _maxClusters;
+   stream << _sampleSize;
+   stream << _indices;
+   stream << _K;
 
-   for ( auto& pair : _pairs )
+   // write the correlations of the remaining clusters of each pair
+   QVector<quint64> masks(_K.size(), 0);
+   QVector<float> correlations;
+
+   for ( int i = 0; i < _K.size(); ++i )
    {
-      stream << pair.K;
-      stream << pair.labels;
-      stream << pair.correlations;
+      for ( qint8 k = 0; k < _K[i]; ++k )
+      {
+         float corr = _correlations[static_cast<qint64>(i) * _maxClusters + k];
+
+         if ( !isnan(corr) )
+         {
+            masks[i] |= 1ULL << k;
+            correlations.append(corr);
+         }
+      }
    }
+
+   stream << masks;
+   stream << correlations;
+
+   // write each row of labels
+   qint32 numRows = _labels.size() / max(1, _sampleSize);
+   std::vector<quint8> packed((_sampleSize + 1) / 2);
+
+   stream << _rows;
+   stream << numRows;
+
+   for ( qint32 r = 0; r < numRows; ++r )
+   {
+      const qint8 *row = &_labels[static_cast<qint64>(r) * _sampleSize];
+
+      if ( _maxClusters > MAX_PACKED_CLUSTERS )
+      {
+         stream.writeRawData(reinterpret_cast<const char*>(row), _sampleSize);
+         continue;
+      }
+
+      for ( int j = 0; j < _sampleSize; j += 2 )
+      {
+         packed[j / 2] = packLabel(row[j]) | ((j + 1 < _sampleSize) ? packLabel(row[j + 1]) << 4 : 0);
+      }
+
+      stream.writeRawData(reinterpret_cast<const char*>(packed.data()), packed.size());
+   }
+
+   stream << _agreement.pairs;
+   stream << _agreement.sameK;
+   stream << _agreement.sumARI;
+   stream << _iterations;
+   stream << _skipped;
+   stream << _numaAccess.local;
+   stream << _numaAccess.remote;
+   stream << _tileAccess.hits;
+   stream << _tileAccess.misses;
+   stream << _tileAccess.reads;
+   stream << _tileAccess.evictions;
 }
 
 
@@ -66,7 +275,8 @@ void Similarity::ResultBlock::write(QDataStream& stream) const
 
 
 /*!
- * Read this block's data from the given data stream.
+ * Read this block's data from the given data stream. The correlations of the
+ * clusters which were removed are restored as NAN.
  *
  * @param stream
  */
@@ -75,16 +285,67 @@ void Similarity::ResultBlock::read(QDataStream& stream)
    EDEBUG_FUNC(this,&stream);
 
    stream >> _start;
+   stream >> _maxClusters;
+   stream >> _sampleSize;
+   stream >> _indices;
+   stream >> _K;
+
+   // read the correlations of the remaining clusters of each pair
+   QVector<quint64> masks;
+   QVector<float> correlations;
 
-   int size;
-   stream >> size;
+   stream >> masks;
+   stream >> correlations;
 
-   _pairs.resize(size);
+   _correlations.assign(static_cast<qint64>(_K.size()) * _maxClusters, NAN);
 
-   for ( auto& pair : _pairs )
+   for ( int i = 0, j = 0; i < _K.size(); ++i )
    {
-      stream >> pair.K;
-      stream >> pair.labels;
-      stream >> pair.correlations;
+      for ( qint8 k = 0; k < _K[i]; ++k )
+      {
+         if ( masks[i] & (1ULL << k) )
+         {
+            _correlations[static_cast<qint64>(i) * _maxClusters + k] = correlations[j++];
+         }
+      }
    }
+
+   // read each row of labels
+   qint32 numRows;
+   std::vector<quint8> packed((_sampleSize + 1) / 2);
+
+   stream >> _rows;
+   stream >> numRows;
+
+   _labels.resize(static_cast<qint64>(numRows) * _sampleSize);
+
+   for ( qint32 r = 0; r < numRows; ++r )
+   {
+      qint8 *row = &_labels[static_cast<qint64>(r) * _sampleSize];
+
+      if ( _maxClusters > MAX_PACKED_CLUSTERS )
+      {
+         stream.readRawData(reinterpret_cast<char*>(row), _sampleSize);
+         continue;
+      }
+
+      stream.readRawData(reinterpret_cast<char*>(packed.data()), packed.size());
+
+      for ( int j = 0; j < _sampleSize; ++j )
+      {
+         row[j] = unpackLabel((packed[j / 2] >> (4 * (j % 2))) & 0xF);
+      }
+   }
+
+   stream >> _agreement.pairs;
+   stream >> _agreement.sameK;
+   stream >> _agreement.sumARI;
+   stream >> _iterations;
+   stream >> _skipped;
+   stream >> _numaAccess.local;
+   stream >> _numaAccess.remote;
+   stream >> _tileAccess.hits;
+   stream >> _tileAccess.misses;
+   stream >> _tileAccess.reads;
+   stream >> _tileAccess.evictions;
 }
@@ -1,11 +1,26 @@
 #ifndef SIMILARITY_RESULTBLOCK_H
 #define SIMILARITY_RESULTBLOCK_H
+#include <cmath>
+
 #include "similarity.h"
 
 
 
 /*!
- * This class implements the result block of the similarity analytic.
+ * This class implements the result block of the similarity analytic. The
+ * results of every pair are stored in a few flat arrays rather than in an
+ * array of pairs with their own buffers, so that a block is filled without any
+ * allocation per pair. The number of clusters of each pair is stored in one
+ * array, the correlations of each pair are stored in a row of the maximum
+ * number of clusters, and the labels of each pair are stored in a row of
+ * samples which is given by the row offset of the pair. Several pairs may
+ * share a row of labels.
+ *
+ * Before a block is sent back to the master, the worker removes the pairs
+ * which have no correlation within the correlation thresholds and saves the
+ * pairwise index of every remaining pair. Only the remaining clusters are
+ * written to a data stream, and the labels are packed into 4 bits per sample
+ * when the maximum number of clusters allows it.
  */
 class Similarity::ResultBlock : public EAbstractAnalyticBlock
 {
@@ -15,47 +30,146 @@ public:
     * Construct a new result block in an uninitialized null state.
     */
    explicit ResultBlock() = default;
-   explicit ResultBlock(int index, qint64 start);
-   template<class T> static QVector<T> makeVector(const T* data, int size);
+   explicit ResultBlock(int index, qint64 start, int maxClusters, int sampleSize);
+   /*!
+    * Return whether a correlation is within the given correlation thresholds.
+    *
+    * @param corr
+    * @param minCorrelation
+    * @param maxCorrelation
+    */
+   static bool isWithin(float corr, float minCorrelation, float maxCorrelation) { return !std::isnan(corr) && minCorrelation <= std::abs(corr) && std::abs(corr) <= maxCorrelation; }
    qint64 start() const { return _start; }
-   const QVector<Pair>& pairs() const { return _pairs; }
-   QVector<Pair>& pairs() { return _pairs; }
-   void append(const Pair& pair);
+   int size() const { return _K.size(); }
+   Pair pair(int i) const;
+   /*!
+    * Return the pairwise index of a pair, which is only saved by filter().
+    *
+    * @param i
+    */
+   Pairwise::Index index(int i) const { return Pairwise::Index::fromUnchecked(_indices[2 * i], _indices[2 * i + 1]); }
+   /*!
+    * Return the number of clusters of a pair.
+    *
+    * @param i
+    */
+   qint8& K(int i) { return _K[i]; }
+   /*!
+    * Return the row of correlations of a pair.
+    *
+    * @param i
+    */
+   float * correlations(int i) { return _correlations.data() + static_cast<qint64>(i) * _maxClusters; }
+   /*!
+    * Return the row of labels of a pair.
+    *
+    * @param i
+    */
+   qint8 * labels(int i) { return _labels.data() + static_cast<qint64>(_rows[i]) * _sampleSize; }
+   /*!
+    * Return the row of labels with the given row offset.
+    *
+    * @param row
+    */
+   qint8 * row(int row) { return _labels.data() + static_cast<qint64>(row) * _sampleSize; }
+   /*!
+    * Set the row offset of the labels of a pair.
+    *
+    * @param i
+    * @param row
+    */
+   void setRow(int i, int row) { _rows[i] = row; }
+   const Agreement& agreement() const { return _agreement; }
+   Agreement& agreement() { return _agreement; }
+   const QVector<qint64>& iterations() const { return _iterations; }
+   QVector<qint64>& iterations() { return _iterations; }
+   const QVector<qint64>& skipped() const { return _skipped; }
+   QVector<qint64>& skipped() { return _skipped; }
+   const NumaAccess& numaAccess() const { return _numaAccess; }
+   NumaAccess& numaAccess() { return _numaAccess; }
+   const TileAccess& tileAccess() const { return _tileAccess; }
+   TileAccess& tileAccess() { return _tileAccess; }
+   void resize(int size);
+   void resize(int size, int numRows);
+   void resizeRows(int numRows);
+   void filter(const WorkBlock* workBlock, float minCorrelation, float maxCorrelation);
 protected:
    virtual void write(QDataStream& stream) const override final;
    virtual void read(QDataStream& stream) override final;
+private:
+   /*!
+    * The largest maximum number of clusters for which labels are packed into
+    * 4 bits, since the four negative labels take the highest 4-bit values.
+    */
+   constexpr static int MAX_PACKED_CLUSTERS {12};
+   static quint8 packLabel(qint8 label) { return (label >= 0) ? label : 6 - label; }
+   static qint8 unpackLabel(quint8 value) { return (value < MAX_PACKED_CLUSTERS) ? value : 6 - value; }
 private:
    /*!
     * The pairwise index of the first pair in the result block.
     */
    qint64 _start;
    /*!
-    * The list of pairs that were processed.
+    * The maximum number of clusters, which is the length of each row of
+    * correlations.
+    */
+   int _maxClusters {0};
+   /*!
+    * The number of samples, which is the length of each row of labels.
+    */
+   int _sampleSize {0};
+   /*!
+    * The pairwise index of each pair after the block is filtered, which is
+    * stored as the x and y index of each pair.
+    */
+   QVector<qint32> _indices;
+   /*!
+    * The number of clusters of each pair.
+    */
+   QVector<qint8> _K;
+   /*!
+    * The correlations of each pair, with one row for each pair, which may
+    * also exceed the size limit of a QVector for large blocks.
+    */
+   std::vector<float> _correlations;
+   /*!
+    * The row offset of the labels of each pair.
+    */
+   QVector<qint32> _rows;
+   /*!
+    * The rows of cluster labels, which may exceed the size limit of a
+    * QVector for large blocks of the tiled correlation engine.
+    */
+   std::vector<qint8> _labels;
+   /*!
+    * The agreement statistics of the pairs in the result block, which are
+    * only computed when the variational Bayesian clustering model is compared
+    * with the Gaussian mixture model.
+    */
+   Agreement _agreement;
+   /*!
+    * The histogram of the number of EM iterations of the Gaussian mixture
+    * model for the pairs in the result block, which is empty if it was not
+    * recorded.
+    */
+   QVector<qint64> _iterations;
+   /*!
+    * The histogram of the number of skipped sub-models of each pair in the
+    * result block, which is empty if it was not recorded.
+    */
+   QVector<qint64> _skipped;
+   /*!
+    * The counts of local and remote reads of gene expressions for the pairs
+    * in the result block, which are zero if they were not recorded.
     */
-   QVector<Pair> _pairs;
+   NumaAccess _numaAccess;
+   /*!
+    * The access statistics of the tile cache while the result block was
+    * computed, which are zero if the tile cache was not used.
+    */
+   TileAccess _tileAccess;
 };
 
 
 
-
-
-
-/*!
- * Create a vector from the given pointer and size. The contents of the
- * pointer are copied into the vector.
- *
- * @param data
- * @param size
- */
-template<class T>
-QVector<T> Similarity::ResultBlock::makeVector(const T* data, int size)
-{
-   QVector<T> v(size);
-
-   memcpy(v.data(), data, size * sizeof(T));
-   return v;
-}
-
-
-
 #endif
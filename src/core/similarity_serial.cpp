@@ -1,10 +1,18 @@
+#include <cblas.h>
+#include <numa.h>
+#include <numeric>
+#include <sched.h>
+
 #include "similarity_serial.h"
 #include "similarity_resultblock.h"
 #include "similarity_workblock.h"
 #include "expressionmatrix_gene.h"
+#include "expressionmatrix_view.h"
 #include "pairwise_gmm.h"
+#include "pairwise_vbgmm.h"
 #include "pairwise_pearson.h"
 #include "pairwise_spearman.h"
+#include <ace/core/ace_qmpi.h>
 #include <ace/core/elog.h>
 
 
@@ -17,40 +25,375 @@ using namespace std;
 
 
 /*!
- * Construct a new serial object with the given analytic as its parent.
+ * Construct a new serial object with the given analytic as its parent. Each
+ * thread of the serial object is given its own clustering model and
+ * correlation model, since the models contain workspace which is modified
+ * by each computation.
  *
  * @param parent
  */
 Similarity::Serial::Serial(Similarity* parent):
    EAbstractAnalyticSerial(parent),
-   _base(parent)
+   _base(parent),
+   _threadPool(parent->_numThreads, selectCpus(parent->_numThreads, parent->_numaPolicy))
 {
    EDEBUG_FUNC(this,parent);
 
-   // initialize clustering model
-   switch ( _base->_clusMethod )
+   // initialize the tile cache of the expression matrix if the memory is
+   // limited or the worker owns tiles of genes
+   if ( _base->isOutOfCore() )
+   {
+      initializeCache();
+   }
+   else
+   {
+      // initialize the view of the expression matrix of each thread, which is
+      // the copy on the NUMA node of the thread if the expression matrix is
+      // replicated
+      for ( int t = 0; t < _threadPool.size(); ++t )
+      {
+         int node {ExpressionMatrix::View::ANY_NODE};
+
+         if ( _base->_numaPolicy == NumaPolicy::Replicate && _threadPool.cpu(t) >= 0 )
+         {
+            node = numa_node_of_cpu(_threadPool.cpu(t));
+         }
+         else if ( _base->_numaPolicy == NumaPolicy::Interleave )
+         {
+            node = ExpressionMatrix::View::ALL_NODES;
+         }
+
+         _views.push_back(_base->_input->mapRawData(_base->_hugePages, node));
+         _expressions.push_back(_views.back()->data());
+      }
+
+      // initialize quartiles of each gene for pre-clustering outlier removal
+      _quartiles = computeGeneQuartiles(_expressions[0], _base->_input->geneSize(), _base->_input->sampleSize());
+
+      // initialize sample validity masks of each gene
+      _masks = Pairwise::SampleMasks(_expressions[0], _base->_input->geneSize(), _base->_input->sampleSize(), _base->_minExpression);
+   }
+
+   _numaAccess.resize(_threadPool.size());
+
+   // initialize outlier removal workspace
+   _outlierWork.resize(_threadPool.size(), std::vector<float>(2 * _base->_input->sampleSize()));
+
+   for ( int t = 0; t < _threadPool.size(); ++t )
+   {
+      // initialize clustering model
+      Pairwise::ClusteringModel* clusModel {nullptr};
+
+      switch ( _base->_clusMethod )
+      {
+      case ClusteringMethod::None:
+         clusModel = nullptr;
+         break;
+      case ClusteringMethod::GMM:
+         clusModel = new Pairwise::GMM(_base->_input, _base->_maxClusters, Pairwise::simdLevel(), _base->_selection);
+         break;
+      case ClusteringMethod::VBGMM:
+         clusModel = new Pairwise::VBGMM(_base->_input, _base->_maxClusters, _base->_vbThreshold);
+         break;
+      }
+
+      // initialize correlation model
+      Pairwise::CorrelationModel* corrModel {nullptr};
+
+      switch ( _base->_corrMethod )
+      {
+      case CorrelationMethod::Pearson:
+         corrModel = new Pairwise::Pearson();
+         break;
+      case CorrelationMethod::Spearman:
+         corrModel = (t == 0)
+            ? new Pairwise::Spearman(_base->_input, _cache ? nullptr : _expressions[0])
+            : new Pairwise::Spearman(*static_cast<Pairwise::Spearman*>(_corrModels[0]));
+         break;
+      }
+
+      _clusModels.push_back(clusModel);
+      _corrModels.push_back(corrModel);
+
+      // initialize reference clustering model
+      if ( _base->_clusMethod == ClusteringMethod::VBGMM && _base->_vbCompare )
+      {
+         _refModels.push_back(new Pairwise::GMM(_base->_input, _base->_maxClusters));
+      }
+   }
+
+   _agreements.resize(_threadPool.size());
+
+   // initialize label workspace of each thread
+   _labels.resize(_threadPool.size(), QVector<qint8>(_base->_input->sampleSize()));
+   _refLabels.resize(_threadPool.size(), QVector<qint8>(_base->_input->sampleSize()));
+
+   // initialize tiled correlation engine
+   if ( _base->_engine == Engine::BLAS )
+   {
+      _tiledModel = new Pairwise::TiledCorrelation(
+         _expressions[0],
+         _base->_input->geneSize(),
+         _base->_input->sampleSize(),
+         _base->_minExpression,
+         _base->_minSamples,
+         _base->_corrMethod == CorrelationMethod::Spearman
+      );
+
+      // use single-threaded BLAS if the tiles are computed by several threads
+      if ( _threadPool.size() > 1 )
+      {
+         openblas_set_num_threads(1);
+      }
+   }
+}
+
+
+
+
+
+
+/*!
+ * Destruct this serial object, deleting the models of each thread and the
+ * tiled correlation engine.
+ */
+Similarity::Serial::~Serial()
+{
+   EDEBUG_FUNC(this);
+
+   for ( auto clusModel : _clusModels )
+   {
+      delete clusModel;
+   }
+
+   for ( auto corrModel : _corrModels )
+   {
+      delete corrModel;
+   }
+
+   for ( auto refModel : _refModels )
+   {
+      delete refModel;
+   }
+
+   delete _tiledModel;
+}
+
+
+
+
+
+
+/*!
+ * Return the CPU of each thread of the thread pool for the given NUMA policy,
+ * or an empty list if the threads should not be pinned. The threads are
+ * assigned to the NUMA nodes of the CPUs on which this process may run in
+ * turn, so that the memory bandwidth of every node is used, and to the CPUs
+ * of each node in order.
+ *
+ * @param numThreads
+ * @param policy
+ */
+std::vector<int> Similarity::Serial::selectCpus(int numThreads, NumaPolicy policy)
+{
+   if ( policy == NumaPolicy::None || numa_available() < 0 )
+   {
+      return {};
+   }
+
+   // group the CPUs on which this process may run by NUMA node
+   cpu_set_t allowed;
+
+   if ( sched_getaffinity(0, sizeof(allowed), &allowed) != 0 )
+   {
+      return {};
+   }
+
+   std::vector<std::vector<int>> nodes(numa_max_node() + 1);
+
+   for ( int cpu = 0; cpu < CPU_SETSIZE; ++cpu )
+   {
+      int node {CPU_ISSET(cpu, &allowed) ? numa_node_of_cpu(cpu) : -1};
+
+      if ( node >= 0 && node < static_cast<int>(nodes.size()) )
+      {
+         nodes[node].push_back(cpu);
+      }
+   }
+
+   nodes.erase(std::remove_if(nodes.begin(), nodes.end(), [] (const std::vector<int>& cpus) { return cpus.empty(); }), nodes.end());
+
+   if ( nodes.empty() )
+   {
+      return {};
+   }
+
+   // assign each thread to the next node in turn
+   std::vector<int> cpus;
+
+   for ( int t = 0; t < max(numThreads, 1); ++t )
+   {
+      const std::vector<int>& node {nodes[t % nodes.size()]};
+
+      cpus.push_back(node[(t / nodes.size()) % node.size()]);
+   }
+
+   return cpus;
+}
+
+
+
+
+
+
+/*!
+ * Initialize the tile cache of the expression matrix, which every thread
+ * reads through the same pointer, and compute the quartiles and sample
+ * validity masks of each gene in a single pass over the tiles. The memory
+ * limit must hold the tiles which every thread acquires for a chunk, which
+ * are the tile of the first gene and the tiles spanned by the second genes,
+ * and one more tile for read-ahead. If no memory limit is given in the owner
+ * work order, the cache holds twice the share of the tiles of each worker in
+ * addition to the tiles of the threads, since each worker keeps its own
+ * column tiles and reads the row tiles which it shares with the others.
+ */
+void Similarity::Serial::initializeCache()
+{
+   EDEBUG_FUNC(this);
+
+   ExpressionMatrix* emx {_base->_input};
+
+   // determine the number of tiles which every thread acquires for a chunk
+   int chunkSize {CHUNK_SIZE};
+   int tileSize {ExpressionMatrix::TileCache::selectTileSize(emx)};
+   int required {_threadPool.size() * (2 + (chunkSize + tileSize - 1) / tileSize) + 1};
+   qint64 memoryLimit {static_cast<qint64>(_base->_memoryLimit) << 20};
+
+   if ( memoryLimit == 0 )
+   {
+      auto& mpi {Ace::QMPI::instance()};
+      int numWorkers = max(1, mpi.size() - 1);
+      int numTiles {(emx->geneSize() + tileSize - 1) / tileSize};
+      qint64 tileBytes {tileSize * (max(1, emx->sampleSize()) * static_cast<qint64>(sizeof(float)))};
+
+      memoryLimit = (required + (2 * numTiles + numWorkers - 1) / numWorkers) * tileBytes;
+   }
+
+   _cache.reset(new ExpressionMatrix::TileCache(emx, memoryLimit));
+
+   // make sure that the tiles of a chunk of every thread fit in the cache
+   required = min(required, _cache->size());
+
+   if ( _cache->capacity() < required )
+   {
+      E_MAKE_EXCEPTION(e);
+      e.setTitle(tr("Invalid Argument"));
+      e.setDetails(tr("The memory limit of %1 MiB holds %2 tiles of %3 genes, but %4 threads require at least %5 tiles.")
+                   .arg(memoryLimit >> 20)
+                   .arg(_cache->capacity())
+                   .arg(tileSize)
+                   .arg(_threadPool.size())
+                   .arg(required));
+      throw e;
+   }
+
+   _expressions.assign(_threadPool.size(), _cache->data());
+
+   // read every tile in order to compute the quartiles and sample masks of
+   // each gene
+   std::vector<int> tiles(_cache->size());
+
+   std::iota(tiles.begin(), tiles.end(), 0);
+   _cache->prefetch(tiles);
+
+   _quartiles.reserve(2 * static_cast<size_t>(emx->geneSize()));
+   _masks = Pairwise::SampleMasks(emx->geneSize(), emx->sampleSize());
+
+   for ( int t = 0; t < _cache->size(); ++t )
+   {
+      int start {t * tileSize};
+      int end {min(start + tileSize, emx->geneSize())};
+
+      _cache->acquire(t);
+
+      std::vector<float> quartiles {computeGeneQuartiles(&_cache->data()[static_cast<qint64>(start) * emx->sampleSize()], end - start, emx->sampleSize())};
+
+      _quartiles.insert(_quartiles.end(), quartiles.begin(), quartiles.end());
+      _masks.compute(_cache->data(), start, end, _base->_minExpression);
+
+      _cache->release(t);
+   }
+
+   _cache->takeStatistics();
+}
+
+
+
+
+
+
+/*!
+ * Return the tiles of the tile cache which are read by a chunk of pairs,
+ * which are the tile of the first gene of the chunk followed by each tile
+ * spanned by its second genes.
+ *
+ * @param start
+ * @param size
+ */
+std::vector<int> Similarity::Serial::chunkTiles(const Pairwise::Index& start, qint64 size) const
+{
+   std::vector<int> tiles {_cache->tile(start.getX())};
+
+   for ( int tile = _cache->tile(start.getY()); tile <= _cache->tile(start.getY() + size - 1); ++tile )
+   {
+      if ( tile != tiles[0] )
+      {
+         tiles.push_back(tile);
+      }
+   }
+
+   return tiles;
+}
+
+
+
+
+
+
+/*!
+ * Count the reads of gene expressions of a chunk of pairs on the given thread
+ * as local or remote, according to the NUMA node of the thread and the NUMA
+ * nodes of the genes in the view of the thread. Each pair of the chunk reads
+ * the first gene of the chunk and its own second gene.
+ *
+ * @param thread
+ * @param start
+ * @param size
+ */
+void Similarity::Serial::countAccess(int thread, const Pairwise::Index& start, qint64 size)
+{
+   if ( _views.empty() )
    {
-   case ClusteringMethod::None:
-      _clusModel = nullptr;
-      break;
-   case ClusteringMethod::GMM:
-      _clusModel = new Pairwise::GMM(_base->_input, _base->_maxClusters);
-      break;
+      return;
    }
 
-   // initialize correlation model
-   switch ( _base->_corrMethod )
+   const ExpressionMatrix::View& view {*_views[thread]};
+   int cpu {_threadPool.cpu(thread) >= 0 ? _threadPool.cpu(thread) : sched_getcpu()};
+   int node {(cpu >= 0 && numa_available() >= 0) ? numa_node_of_cpu(cpu) : -1};
+
+   if ( node < 0 || view.node(start.getX()) < 0 )
    {
-   case CorrelationMethod::Pearson:
-      _corrModel = new Pairwise::Pearson();
-      break;
-   case CorrelationMethod::Spearman:
-      _corrModel = new Pairwise::Spearman(_base->_input);
-      break;
+      return;
    }
 
-   // initialize expression matrix
-   _expressions = _base->_input->dumpRawData();
+   NumaAccess& access {_numaAccess[thread]};
+
+   ((view.node(start.getX()) == node) ? access.local : access.remote) += size;
+
+   for ( qint64 i = 0; i < size; ++i )
+   {
+      ((view.node(start.getY() + i) == node) ? access.local : access.remote) += 1;
+   }
 }
 
 
@@ -61,7 +404,10 @@ Similarity::Serial::Serial(Similarity* parent):
 /*!
  * Read in the given work block and save the results in a new result block. This
  * implementation takes the starting pairwise index and pair size from the work
- * block and processes those pairs.
+ * block and processes those pairs. Each row of the work block is divided into
+ * chunks of pairs which are processed by the thread pool, and each chunk saves
+ * its pairs directly into its own range of the result block, so the pairs
+ * remain in the order of the work block.
  *
  * @param block
  */
@@ -77,33 +423,213 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::Serial::execute(const EAbstr
    // cast block to work block
    const WorkBlock* workBlock {block->cast<WorkBlock>()};
 
+   // use the tiled correlation engine if it was selected
+   if ( _tiledModel )
+   {
+      return executeTiled(workBlock);
+   }
+
    // initialize result block
-   ResultBlock* resultBlock {new ResultBlock(workBlock->index(), workBlock->start())};
+   ResultBlock* resultBlock {new ResultBlock(workBlock->index(), workBlock->start(), _base->_maxClusters, _base->_input->sampleSize())};
+
+   resultBlock->resize(workBlock->size());
+
+   // divide each row of the work block into chunks
+   struct Chunk
+   {
+      Pairwise::Index index;
+      qint64 size;
+      qint64 offset;
+   };
+
+   QVector<Chunk> chunks;
+
+   for ( qint32 x = workBlock->rowStart(); x < workBlock->rowEnd(); ++x )
+   {
+      qint32 yStart = workBlock->columnBegin(x);
+      qint32 yEnd = workBlock->columnEnd(x);
+      qint64 offset {workBlock->offset(x)};
+
+      for ( qint32 y = yStart; y < yEnd; y += CHUNK_SIZE )
+      {
+         chunks.append({ Pairwise::Index(x, y), min(yEnd - y, static_cast<qint32>(CHUNK_SIZE)), offset + (y - yStart) });
+      }
+   }
+
+   // read ahead the tiles of the chunks in the order in which the chunks are
+   // processed
+   if ( _cache )
+   {
+      std::vector<int> tiles;
+      std::vector<bool> queued(_cache->size(), false);
+
+      for ( const Chunk& chunk : chunks )
+      {
+         for ( int tile : chunkTiles(chunk.index, chunk.size) )
+         {
+            if ( !queued[tile] )
+            {
+               queued[tile] = true;
+               tiles.push_back(tile);
+            }
+         }
+      }
+
+      _cache->prefetch(tiles);
+   }
+
+   // process each chunk of pairs with the thread pool
+   std::fill(_agreements.begin(), _agreements.end(), Agreement());
+   std::fill(_numaAccess.begin(), _numaAccess.end(), NumaAccess());
+
+   _threadPool.run(chunks.size(), [this, &chunks, resultBlock] (int thread, int i)
+   {
+      const Chunk& chunk {chunks[i]};
+
+      // acquire the tiles of the chunk
+      std::vector<int> tiles;
+
+      if ( _cache )
+      {
+         tiles = chunkTiles(chunk.index, chunk.size);
+
+         for ( int tile : tiles )
+         {
+            _cache->acquire(tile);
+         }
+      }
+
+      countAccess(thread, chunk.index, chunk.size);
+
+      executePairs(thread, chunk.index, chunk.size, resultBlock, chunk.offset);
+
+      for ( int tile : tiles )
+      {
+         _cache->release(tile);
+      }
+   });
+
+   // save the agreement statistics of all threads
+   Agreement& agreement {resultBlock->agreement()};
+
+   for ( auto& threadAgreement : _agreements )
+   {
+      agreement.pairs += threadAgreement.pairs;
+      agreement.sameK += threadAgreement.sameK;
+      agreement.sumARI += threadAgreement.sumARI;
+   }
+
+   // save the counts of local and remote reads of all threads
+   NumaAccess& numaAccess {resultBlock->numaAccess()};
+
+   for ( auto& threadAccess : _numaAccess )
+   {
+      numaAccess.local += threadAccess.local;
+      numaAccess.remote += threadAccess.remote;
+   }
+
+   // save the access statistics of the tile cache
+   if ( _cache )
+   {
+      ExpressionMatrix::TileCache::Statistics statistics {_cache->takeStatistics()};
+      TileAccess& tileAccess {resultBlock->tileAccess()};
+
+      tileAccess.hits = statistics.hits;
+      tileAccess.misses = statistics.misses;
+      tileAccess.reads = statistics.reads;
+      tileAccess.evictions = statistics.evictions;
+   }
+
+   // save the histograms of EM iterations and skipped sub-models of all
+   // threads
+   if ( _base->_clusMethod == ClusteringMethod::GMM )
+   {
+      QVector<qint64>& iterations {resultBlock->iterations()};
+      QVector<qint64>& skipped {resultBlock->skipped()};
+
+      iterations.fill(0, Pairwise::GMM::MAX_ITERATIONS + 1);
+      skipped.fill(0, _base->_maxClusters + 1);
+
+      for ( int t = 0; t < _threadPool.size(); ++t )
+      {
+         Pairwise::GMM* model {static_cast<Pairwise::GMM*>(_clusModels[t])};
+         const QVector<qint64>& counts {model->iterations()};
+
+         for ( int i = 0; i < counts.size(); ++i )
+         {
+            iterations[i] += counts[i];
+         }
+
+         const QVector<qint64>& skips {model->skipped()};
+
+         for ( int i = 0; i < skips.size(); ++i )
+         {
+            skipped[i] += skips[i];
+         }
+
+         model->resetIterations();
+      }
+   }
+
+   // remove the results which are not within the correlation thresholds
+   resultBlock->filter(workBlock, _base->_minCorrelation, _base->_maxCorrelation);
+
+   // return result block
+   return unique_ptr<EAbstractAnalyticBlock>(resultBlock);
+}
+
+
+
+
+
+
+/*!
+ * Process a contiguous range of pairs on the given thread and save the results
+ * to the given result block, starting at the given offset in the block.
+ *
+ * @param thread
+ * @param start
+ * @param size
+ * @param resultBlock
+ * @param offset
+ */
+void Similarity::Serial::executePairs(int thread, const Pairwise::Index& start, qint64 size, ResultBlock* resultBlock, int offset)
+{
+   EDEBUG_FUNC(this,thread,&start,size,resultBlock,offset);
 
    // initialize workspace
-   QVector<qint8> labels(_base->_input->sampleSize());
+   Pairwise::ClusteringModel* clusModel {_clusModels[thread]};
+   Pairwise::CorrelationModel* corrModel {_corrModels[thread]};
+   Pairwise::ClusteringModel* refModel {_refModels.empty() ? nullptr : _refModels[thread]};
+   QVector<qint8>& labels {_labels[thread]};
+   QVector<qint8>& refLabels {_refLabels[thread]};
 
    // iterate through all pairs
-   Pairwise::Index index {workBlock->start()};
+   Pairwise::Index index {start};
 
-   for ( int i = 0; i < workBlock->size(); ++i )
+   for ( qint64 i = 0; i < size; ++i )
    {
       // fetch pairwise input data
-      int numSamples = fetchPair(index, labels);
+      int numSamples = fetchPair(index, labels.data());
 
       // remove pre-clustering outliers
       if ( _base->_removePreOutliers )
       {
-         numSamples = removeOutliers(index, numSamples, labels, 1, -7);
+         numSamples = removeOutliers(thread, index, numSamples, labels, 1, -7);
       }
 
       // compute clusters
       qint8 K {1};
 
+      if ( refModel )
+      {
+         std::copy(labels.constBegin(), labels.constEnd(), refLabels.begin());
+      }
+
       if ( _base->_clusMethod != ClusteringMethod::None )
       {
-         K = _clusModel->compute(
-            _expressions,
+         K = clusModel->compute(
+            _expressions[thread],
             index,
             numSamples,
             labels,
@@ -114,39 +640,58 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::Serial::execute(const EAbstr
          );
       }
 
+      // compare clusters with the reference clustering model
+      if ( refModel )
+      {
+         qint8 refK = refModel->compute(
+            _expressions[thread],
+            index,
+            numSamples,
+            refLabels,
+            _base->_minSamples,
+            _base->_minClusters,
+            _base->_maxClusters,
+            _base->_criterion
+         );
+
+         if ( K > 0 && refK > 0 )
+         {
+            Agreement& agreement {_agreements[thread]};
+
+            agreement.pairs++;
+            agreement.sameK += (K == refK);
+            agreement.sumARI += adjustedRandIndex(labels, K, refLabels, refK);
+         }
+      }
+
       // remove post-clustering outliers
       if ( _base->_removePostOutliers )
       {
-         numSamples = removeOutliers(index, numSamples, labels, K, -8);
+         numSamples = removeOutliers(thread, index, numSamples, labels, K, -8);
       }
 
       // compute correlations
-      QVector<float> correlations = _corrModel->compute(
-         _expressions,
+      corrModel->compute(
+         _expressions[thread],
          index,
          K,
-         labels,
-         _base->_minSamples
+         labels.constData(),
+         labels.size(),
+         _base->_minSamples,
+         resultBlock->correlations(offset + i)
       );
 
       // save pairwise output data
-      Pair pair;
-      pair.K = K;
+      resultBlock->K(offset + i) = K;
 
       if ( K > 0 )
       {
-         pair.labels = labels;
-         pair.correlations = correlations;
+         std::copy(labels.constBegin(), labels.constEnd(), resultBlock->labels(offset + i));
       }
 
-      resultBlock->append(pair);
-
       // increment to next pair
       ++index;
    }
-
-   // return result block
-   return unique_ptr<EAbstractAnalyticBlock>(resultBlock);
 }
 
 
@@ -155,49 +700,171 @@ std::unique_ptr<EAbstractAnalyticBlock> Similarity::Serial::execute(const EAbstr
 
 
 /*!
- * Compute the initial labels for a gene pair in an expression matrix. Samples
- * with missing values and samples that fall below the expression threshold are
- * labeled as such, all other samples are labeled as cluster 0. The number of
- * clean samples is returned.
+ * Process a work block with the tiled correlation engine. The rows spanned by
+ * the work block are divided into tiles, and the correlations of each tile are
+ * computed with matrix products. Pairs in which either gene is not clean are
+ * computed over their joint validity mask by the engine, or otherwise (as with
+ * Spearman) by the pairwise correlation model. Since the pairs of a tile do not
+ * arrive in pairwise order, the result block is sized beforehand and each pair
+ * is saved at its offset from the start of the block. The tiles are processed
+ * by the thread pool, and each thread has its own tile buffers.
  *
- * @param index
- * @param labels
+ * Pairs of clean genes share a single row of labels. Every other pair needs its
+ * own row, but most pairs of a large work block are removed by the correlation
+ * thresholds, so a row of labels is only allocated and fetched for each such
+ * pair whose correlation is within the thresholds, after all of the tiles are
+ * computed.
+ *
+ * @param workBlock
  */
-int Similarity::Serial::fetchPair(const Pairwise::Index& index, QVector<qint8>& labels)
+std::unique_ptr<EAbstractAnalyticBlock> Similarity::Serial::executeTiled(const WorkBlock* workBlock)
 {
-   EDEBUG_FUNC(this,&index,&labels);
+   EDEBUG_FUNC(this,workBlock);
 
-   // index into gene expressions
-   const float *x = &_expressions[index.getX() * _base->_input->sampleSize()];
-   const float *y = &_expressions[index.getY() * _base->_input->sampleSize()];
+   // initialize result block with the shared row of clean labels
+   ResultBlock* resultBlock {new ResultBlock(workBlock->index(), workBlock->start(), _base->_maxClusters, _base->_input->sampleSize())};
 
-   // label the pairwise samples
-   int numSamples = 0;
+   resultBlock->resize(workBlock->size(), 1);
+
+   // initialize workspace
+   const int TILE_SIZE {Pairwise::TiledCorrelation::TILE_SIZE};
+
+   std::vector<std::vector<float>> tiles(_threadPool.size(), std::vector<float>(TILE_SIZE * TILE_SIZE));
+   std::vector<std::vector<float>> tileWorkspaces(_threadPool.size());
+   std::vector<char> ownRows(workBlock->size(), false);
+
+   // enumerate each tile of rows and each tile of columns spanned by the work
+   // block which lies below the diagonal
+   QVector<QPair<qint32,qint32>> tileStarts;
 
-   for ( int i = 0; i < _base->_input->sampleSize(); ++i )
+   for ( qint32 rowStart = workBlock->rowStart(); rowStart < workBlock->rowEnd(); rowStart += TILE_SIZE )
    {
-      // label samples with missing values
-      if ( std::isnan(x[i]) || std::isnan(y[i]) )
+      qint32 rowEnd = min(rowStart + TILE_SIZE, workBlock->rowEnd());
+
+      for ( qint32 colStart = workBlock->colStart(); colStart < min(rowEnd - 1, workBlock->colEnd()); colStart += TILE_SIZE )
       {
-         labels[i] = -9;
+         tileStarts.append({ rowStart, colStart });
       }
+   }
 
-      // label samples which fall below the expression threshold
-      else if ( x[i] < _base->_minExpression || y[i] < _base->_minExpression )
+   // process each tile with the thread pool
+   _threadPool.run(tileStarts.size(), [&] (int thread, int t)
+   {
+      qint32 rowStart = tileStarts[t].first;
+      qint32 rowEnd = min(rowStart + TILE_SIZE, workBlock->rowEnd());
+      qint32 colStart = tileStarts[t].second;
+      qint32 colEnd = min(colStart + TILE_SIZE, min(rowEnd - 1, workBlock->colEnd()));
+
+      std::vector<float>& tile {tiles[thread]};
+
+      // compute the correlations of the tile
+      _tiledModel->compute(rowStart, rowEnd, colStart, colEnd, tile.data(), tileWorkspaces[thread]);
+
+      // save each pair in the tile which belongs to the work block
+      for ( qint32 x = rowStart; x < rowEnd; ++x )
       {
-         labels[i] = -6;
+         qint32 rowBegin = workBlock->columnBegin(x);
+         qint64 rowOffset {workBlock->offset(x)};
+         qint32 yStart = max(colStart, rowBegin);
+         qint32 yEnd = min(colEnd, workBlock->columnEnd(x));
+
+         for ( qint32 y = yStart; y < yEnd; ++y )
+         {
+            int i = rowOffset + y - rowBegin;
+            bool clean {_tiledModel->isClean(x) && _tiledModel->isClean(y)};
+            float *correlations {resultBlock->correlations(i)};
+
+            resultBlock->K(i) = 1;
+
+            // compute the correlation of a pair with a gene which is not clean
+            // from its labels if the engine does not compute it
+            if ( clean || _tiledModel->isMasked() )
+            {
+               correlations[0] = tile[(x - rowStart) * (colEnd - colStart) + (y - colStart)];
+            }
+            else
+            {
+               Pairwise::Index index(x, y);
+               qint8 *labels {_labels[thread].data()};
+
+               fetchPair(index, labels);
+
+               _corrModels[thread]->compute(
+                  _expressions[thread],
+                  index,
+                  1,
+                  labels,
+                  _base->_input->sampleSize(),
+                  _base->_minSamples,
+                  correlations
+               );
+            }
+
+            // mark a pair with a gene which is not clean for its own row of
+            // labels if it is not removed by the correlation thresholds
+            ownRows[i] = !clean && ResultBlock::isWithin(correlations[0], _base->_minCorrelation, _base->_maxCorrelation);
+         }
       }
+   });
+
+   // assign a row of labels to each marked pair
+   int numRows {1};
 
-      // label any remaining samples as cluster 0
-      else
+   for ( int i = 0; i < workBlock->size(); ++i )
+   {
+      if ( ownRows[i] )
       {
-         numSamples++;
-         labels[i] = 0;
+         resultBlock->setRow(i, numRows++);
       }
    }
 
-   // return number of clean samples
-   return numSamples;
+   resultBlock->resizeRows(numRows);
+
+   // fetch the labels of each marked pair with the thread pool
+   _threadPool.run(workBlock->rowEnd() - workBlock->rowStart(), [&] (int, int r)
+   {
+      qint32 x = workBlock->rowStart() + r;
+      qint32 rowBegin = workBlock->columnBegin(x);
+      qint64 rowOffset {workBlock->offset(x)};
+
+      for ( qint32 y = rowBegin; y < workBlock->columnEnd(x); ++y )
+      {
+         int i = rowOffset + y - rowBegin;
+
+         if ( ownRows[i] )
+         {
+            fetchPair(Pairwise::Index(x, y), resultBlock->labels(i));
+         }
+      }
+   });
+
+   // remove the results which are not within the correlation thresholds
+   resultBlock->filter(workBlock, _base->_minCorrelation, _base->_maxCorrelation);
+
+   // return result block
+   return unique_ptr<EAbstractAnalyticBlock>(resultBlock);
+}
+
+
+
+
+
+
+/*!
+ * Compute the initial labels for a gene pair in an expression matrix. Samples
+ * with missing values and samples that fall below the expression threshold are
+ * labeled as such, all other samples are labeled as cluster 0. The labels are
+ * computed from the sample validity masks of each gene. The number of clean
+ * samples is returned.
+ *
+ * @param index
+ * @param labels
+ */
+int Similarity::Serial::fetchPair(const Pairwise::Index& index, qint8 *labels)
+{
+   EDEBUG_FUNC(this,&index,labels);
+
+   return _masks.labels(index.getX(), index.getY(), labels);
 }
 
 
@@ -211,6 +878,10 @@ int Similarity::Serial::fetchPair(const Pairwise::Index& index, QVector<qint8>&
  * samples in the given cluster are used in outlier detection. For unclustered data,
  * all samples are labeled as 0, so a cluster value of 0 should be used.
  *
+ * The quartiles of each axis are selected from the samples of the cluster,
+ * which are copied into the given workspace, unless the quartiles of both
+ * axes are given.
+ *
  * This function returns the number of clean samples remaining in the data array,
  * including samples in other clusters.
  *
@@ -219,47 +890,54 @@ int Similarity::Serial::fetchPair(const Pairwise::Index& index, QVector<qint8>&
  * @param labels
  * @param cluster
  * @param marker
+ * @param work
+ * @param quartiles_x
+ * @param quartiles_y
  */
-int Similarity::Serial::removeOutliersCluster(const float *x, const float *y, QVector<qint8>& labels, qint8 cluster, qint8 marker)
+int Similarity::Serial::removeOutliersCluster(const float *x, const float *y, QVector<qint8>& labels, qint8 cluster, qint8 marker, float *work, const float *quartiles_x, const float *quartiles_y)
 {
-   EDEBUG_FUNC(this,x,y,&labels,cluster,marker);
+   EDEBUG_FUNC(this,x,y,&labels,cluster,marker,work,quartiles_x,quartiles_y);
 
-   // extract samples from the given cluster into separate arrays
-   QVector<float> x_sorted;
-   QVector<float> y_sorted;
+   float Q1_x, Q3_x, Q1_y, Q3_y;
 
-   x_sorted.reserve(labels.size());
-   y_sorted.reserve(labels.size());
-
-   for ( int i = 0; i < labels.size(); i++ )
+   if ( quartiles_x && quartiles_y )
    {
-      if ( labels[i] == cluster )
-      {
-         x_sorted.append(x[i]);
-         y_sorted.append(y[i]);
-      }
+      Q1_x = quartiles_x[0];
+      Q3_x = quartiles_x[1];
+      Q1_y = quartiles_y[0];
+      Q3_y = quartiles_y[1];
    }
-
-   // return if the given cluster is empty
-   if ( x_sorted.size() == 0 || y_sorted.size() == 0 )
+   else
    {
-      return 0;
-   }
+      // extract samples from the given cluster into the workspace
+      float *x_work = &work[0];
+      float *y_work = &work[labels.size()];
+      int n = 0;
 
-   // sort samples for each axis
-   std::sort(x_sorted.begin(), x_sorted.end());
-   std::sort(y_sorted.begin(), y_sorted.end());
+      for ( int i = 0; i < labels.size(); i++ )
+      {
+         if ( labels[i] == cluster )
+         {
+            x_work[n] = x[i];
+            y_work[n] = y[i];
+            n++;
+         }
+      }
+
+      // return if the given cluster is empty
+      if ( n == 0 )
+      {
+         return 0;
+      }
 
-   // compute quartiles and thresholds for each axis
-   const int n = x_sorted.size();
+      // select quartiles for each axis
+      computeQuartiles(x_work, n, &Q1_x, &Q3_x);
+      computeQuartiles(y_work, n, &Q1_y, &Q3_y);
+   }
 
-   float Q1_x = x_sorted[n * 1 / 4];
-   float Q3_x = x_sorted[n * 3 / 4];
+   // compute thresholds for each axis
    float T_x_min = Q1_x - 1.5f * (Q3_x - Q1_x);
    float T_x_max = Q3_x + 1.5f * (Q3_x - Q1_x);
-
-   float Q1_y = y_sorted[n * 1 / 4];
-   float Q3_y = y_sorted[n * 3 / 4];
    float T_y_min = Q1_y - 1.5f * (Q3_y - Q1_y);
    float T_y_max = Q3_y + 1.5f * (Q3_y - Q1_y);
 
@@ -291,21 +969,26 @@ int Similarity::Serial::removeOutliersCluster(const float *x, const float *y, QV
 
 
 /*!
- * Perform outlier removal on each cluster in a parwise data array.
+ * Perform outlier removal on each cluster in a parwise data array, using the
+ * outlier workspace of the given thread. Pre-clustering outlier removal uses
+ * the quartiles of each gene if every sample of the pair is clean, since the
+ * single cluster then contains every sample of both genes.
  *
+ * @param thread
  * @param index
  * @param numSamples
  * @param labels
  * @param clusterSize
  * @param marker
  */
-int Similarity::Serial::removeOutliers(const Pairwise::Index& index, int numSamples, QVector<qint8>& labels, qint8 clusterSize, qint8 marker)
+int Similarity::Serial::removeOutliers(int thread, const Pairwise::Index& index, int numSamples, QVector<qint8>& labels, qint8 clusterSize, qint8 marker)
 {
-   EDEBUG_FUNC(this,&index,numSamples,&labels,clusterSize,marker);
+   EDEBUG_FUNC(this,thread,&index,numSamples,&labels,clusterSize,marker);
 
    // index into gene expressions
-   const float *x = &_expressions[index.getX() * _base->_input->sampleSize()];
-   const float *y = &_expressions[index.getY() * _base->_input->sampleSize()];
+   const float *x = &_expressions[thread][static_cast<qint64>(index.getX()) * _base->_input->sampleSize()];
+   const float *y = &_expressions[thread][static_cast<qint64>(index.getY()) * _base->_input->sampleSize()];
+   float *work = _outlierWork[thread].data();
 
    // do not perform post-clustering outlier removal if there is only one cluster
    if ( marker == -8 && clusterSize <= 1 )
@@ -313,11 +996,91 @@ int Similarity::Serial::removeOutliers(const Pairwise::Index& index, int numSamp
       return numSamples;
    }
 
+   // use the quartiles of each gene if every sample is clean
+   if ( marker == -7 && numSamples == labels.size() )
+   {
+      const float *quartiles_x = &_quartiles[2 * index.getX()];
+      const float *quartiles_y = &_quartiles[2 * index.getY()];
+
+      return removeOutliersCluster(x, y, labels, 0, marker, work, quartiles_x, quartiles_y);
+   }
+
    // perform outlier removal on each cluster
    for ( qint8 k = 0; k < clusterSize; ++k )
    {
-      numSamples = removeOutliersCluster(x, y, labels, k, marker);
+      numSamples = removeOutliersCluster(x, y, labels, k, marker, work, nullptr, nullptr);
    }
 
    return numSamples;
 }
+
+
+
+
+
+
+/*!
+ * Compute the adjusted Rand index of two clusterings of the same pair, which
+ * measures the agreement of the two sets of labels after correcting for
+ * chance. The index is 1 if the labels are identical up to a permutation of
+ * the clusters and around 0 for random labels. Only the samples which are
+ * clean in both clusterings are compared.
+ *
+ * @param labels1
+ * @param K1
+ * @param labels2
+ * @param K2
+ */
+double Similarity::Serial::adjustedRandIndex(const QVector<qint8>& labels1, qint8 K1, const QVector<qint8>& labels2, qint8 K2)
+{
+   // compute the contingency table of the two clusterings
+   QVector<qint64> table(K1 * K2, 0);
+   QVector<qint64> sums1(K1, 0);
+   QVector<qint64> sums2(K2, 0);
+   qint64 n {0};
+
+   for ( int i = 0; i < labels1.size(); ++i )
+   {
+      if ( labels1[i] >= 0 && labels2[i] >= 0 )
+      {
+         table[labels1[i] * K2 + labels2[i]]++;
+         sums1[labels1[i]]++;
+         sums2[labels2[i]]++;
+         n++;
+      }
+   }
+
+   // compute the number of agreeing sample pairs and its expected value
+   auto choose2 = [] (qint64 m) { return 0.5 * m * (m - 1); };
+
+   double index {0};
+   double index1 {0};
+   double index2 {0};
+
+   for ( auto& count : table )
+   {
+      index += choose2(count);
+   }
+
+   for ( auto& count : sums1 )
+   {
+      index1 += choose2(count);
+   }
+
+   for ( auto& count : sums2 )
+   {
+      index2 += choose2(count);
+   }
+
+   double expected {(n > 1) ? index1 * index2 / choose2(n) : 0};
+   double maximum {0.5 * (index1 + index2)};
+
+   // define the index as 1 when it is undefined, such as when both clusterings
+   // have a single cluster
+   if ( maximum == expected )
+   {
+      return 1;
+   }
+
+   return (index - expected) / (maximum - expected);
+}
@@ -1,41 +1,120 @@
 #ifndef SIMILARITY_SERIAL_H
 #define SIMILARITY_SERIAL_H
 #include "similarity.h"
+#include "expressionmatrix_tilecache.h"
 #include "pairwise_clusteringmodel.h"
 #include "pairwise_correlationmodel.h"
+#include "pairwise_samplemasks.h"
+#include "pairwise_tiledcorrelation.h"
+#include "similarity_threadpool.h"
 
 
 
 /*!
  * This class implements the serial working class of the similarity analytic.
+ * The expression data is either mapped in full or, if a memory limit is set,
+ * read in tiles of genes through a tile cache as the chunks of each work block
+ * need them.
  */
 class Similarity::Serial : public EAbstractAnalyticSerial
 {
    Q_OBJECT
 public:
    explicit Serial(Similarity* parent);
+   ~Serial();
    virtual std::unique_ptr<EAbstractAnalyticBlock> execute(const EAbstractAnalyticBlock* block) override final;
 private:
-   int fetchPair(const Pairwise::Index& index, QVector<qint8>& labels);
-   int removeOutliersCluster(const float *x, const float *y, QVector<qint8>& labels, qint8 cluster, qint8 marker);
-   int removeOutliers(const Pairwise::Index& index, int numSamples, QVector<qint8>& labels, qint8 clusterSize, qint8 marker);
+   /*!
+    * The number of pairs in each chunk of a work block that is processed by
+    * a single thread.
+    */
+   constexpr static int CHUNK_SIZE {64};
+   void executePairs(int thread, const Pairwise::Index& start, qint64 size, ResultBlock* resultBlock, int offset);
+   std::unique_ptr<EAbstractAnalyticBlock> executeTiled(const WorkBlock* workBlock);
+   static std::vector<int> selectCpus(int numThreads, NumaPolicy policy);
+   void initializeCache();
+   std::vector<int> chunkTiles(const Pairwise::Index& start, qint64 size) const;
+   void countAccess(int thread, const Pairwise::Index& start, qint64 size);
+   int fetchPair(const Pairwise::Index& index, qint8 *labels);
+   int removeOutliersCluster(const float *x, const float *y, QVector<qint8>& labels, qint8 cluster, qint8 marker, float *work, const float *quartiles_x, const float *quartiles_y);
+   int removeOutliers(int thread, const Pairwise::Index& index, int numSamples, QVector<qint8>& labels, qint8 clusterSize, qint8 marker);
+   static double adjustedRandIndex(const QVector<qint8>& labels1, qint8 K1, const QVector<qint8>& labels2, qint8 K2);
 private:
    /*!
     * Pointer to the base analytic for this object.
     */
    Similarity* _base;
    /*!
-    * Pointer to the clustering model to use.
+    * The thread pool which processes each work block.
+    */
+   ThreadPool _threadPool;
+   /*!
+    * Pointer to the clustering model of each thread.
+    */
+   std::vector<Pairwise::ClusteringModel*> _clusModels;
+   /*!
+    * Pointer to the correlation model of each thread.
+    */
+   std::vector<Pairwise::CorrelationModel*> _corrModels;
+   /*!
+    * Pointer to the reference clustering model of each thread, which is only
+    * used to compare the variational Bayesian clustering model with the
+    * Gaussian mixture model.
+    */
+   std::vector<Pairwise::ClusteringModel*> _refModels;
+   /*!
+    * The agreement statistics of each thread for the current work block.
+    */
+   std::vector<Agreement> _agreements;
+   /*!
+    * Pointer to the tiled correlation engine, which is only used by the BLAS
+    * execution engine.
+    */
+   Pairwise::TiledCorrelation* _tiledModel {nullptr};
+   /*!
+    * The shared view of the expression matrix of each thread, which is on the
+    * NUMA node of the thread if the expression matrix is replicated.
     */
-   Pairwise::ClusteringModel* _clusModel {nullptr};
+   std::vector<std::shared_ptr<const ExpressionMatrix::View>> _views;
    /*!
-    * Pointer to the correlation model to use.
+    * The out-of-core tile cache of the expression matrix, which is only used
+    * if the memory limit is set, in which case there are no views.
     */
-   Pairwise::CorrelationModel* _corrModel {nullptr};
-   /**
-    * Workspace array for expression matrix.
+   std::unique_ptr<ExpressionMatrix::TileCache> _cache;
+   /*!
+    * Pointer to the expression data of the view of each thread, or of the
+    * tile cache.
+    */
+   std::vector<const float *> _expressions;
+   /*!
+    * The counts of local and remote reads of gene expressions of each thread
+    * for the current work block.
+    */
+   std::vector<NumaAccess> _numaAccess;
+   /*!
+    * The first and third quartiles of each gene, which are used for
+    * pre-clustering outlier removal.
+    */
+   std::vector<float> _quartiles;
+   /*!
+    * The sample validity masks of each gene, which are used to compute the
+    * initial labels of each pair.
+    */
+   Pairwise::SampleMasks _masks;
+   /*!
+    * Workspace for the samples of a cluster of each thread, which is used to
+    * compute quartiles for outlier removal.
+    */
+   std::vector<std::vector<float>> _outlierWork;
+   /*!
+    * The label workspace of each thread, so that no labels are allocated for
+    * each pair.
+    */
+   std::vector<QVector<qint8>> _labels;
+   /*!
+    * The label workspace of each thread for the reference clustering model.
     */
-   std::vector<float> _expressions;
+   std::vector<QVector<qint8>> _refLabels;
 };
 
 
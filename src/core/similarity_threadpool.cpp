@@ -0,0 +1,328 @@
+#include "similarity_threadpool.h"
+
+
+
+using namespace std;
+
+
+
+
+
+
+/*!
+ * Construct a new thread pool with the given number of threads. The calling
+ * thread counts as one of the threads, so numThreads - 1 threads are started.
+ * If a list of CPUs is given, each thread is pinned to the CPU with the same
+ * index. The calling thread is only pinned to the first CPU while it runs
+ * tasks, so that the threads it starts at other times, such as the I/O thread
+ * of the tile cache and the output writer, are not confined to that CPU.
+ *
+ * @param numThreads
+ * @param cpus
+ */
+Similarity::ThreadPool::ThreadPool(int numThreads, const std::vector<int>& cpus):
+   _numThreads(max(1, numThreads))
+{
+   for ( int i = 0; i < _numThreads; ++i )
+   {
+      _queues.emplace_back(new Queue);
+   }
+
+   for ( int i = 1; i < _numThreads; ++i )
+   {
+      _threads.emplace_back(&ThreadPool::loop, this, i);
+   }
+
+   // pin each thread to its CPU
+   if ( static_cast<int>(cpus.size()) >= _numThreads )
+   {
+      _cpus.assign(cpus.begin(), cpus.begin() + _numThreads);
+
+      for ( int i = 1; i < _numThreads; ++i )
+      {
+         pin(_threads[i - 1].native_handle(), _cpus[i]);
+      }
+   }
+}
+
+
+
+
+
+
+/*!
+ * Stop and join all threads of this pool.
+ */
+Similarity::ThreadPool::~ThreadPool()
+{
+   {
+      lock_guard<mutex> lock(_mutex);
+      _stop = true;
+   }
+
+   _started.notify_all();
+
+   for ( auto& thread : _threads )
+   {
+      thread.join();
+   }
+}
+
+
+
+
+
+
+/*!
+ * Run a set of tasks on this thread pool and return when every task has
+ * finished. Each thread is initially given a contiguous range of tasks, and
+ * threads which finish their own range early steal the remaining tasks of
+ * other threads. If any task throws an exception, the first such exception is
+ * rethrown by this function after all threads have finished. If the threads
+ * are pinned, the calling thread is pinned to its CPU during the run and its
+ * previous affinity is restored afterwards.
+ *
+ * @param numTasks
+ * @param task
+ */
+void Similarity::ThreadPool::run(int numTasks, const Task& task)
+{
+   cpu_set_t affinity;
+   bool pinned {!_cpus.empty() && pthread_getaffinity_np(pthread_self(), sizeof(affinity), &affinity) == 0};
+
+   if ( pinned )
+   {
+      pin(pthread_self(), _cpus[0]);
+   }
+
+   try
+   {
+      dispatch(numTasks, task);
+   }
+   catch ( ... )
+   {
+      if ( pinned )
+      {
+         pthread_setaffinity_np(pthread_self(), sizeof(affinity), &affinity);
+      }
+
+      throw;
+   }
+
+   if ( pinned )
+   {
+      pthread_setaffinity_np(pthread_self(), sizeof(affinity), &affinity);
+   }
+}
+
+
+
+
+
+
+/*!
+ * Distribute a set of tasks among the threads of this pool and process them,
+ * as described in run().
+ *
+ * @param numTasks
+ * @param task
+ */
+void Similarity::ThreadPool::dispatch(int numTasks, const Task& task)
+{
+   // run the tasks on the calling thread if there are no other threads
+   if ( _numThreads == 1 )
+   {
+      for ( int i = 0; i < numTasks; ++i )
+      {
+         task(0, i);
+      }
+      return;
+   }
+
+   // distribute tasks evenly among the queues
+   for ( int i = 0; i < _numThreads; ++i )
+   {
+      Queue& queue {*_queues[i]};
+      lock_guard<mutex> lock(queue.mutex);
+
+      int first = static_cast<qint64>(i) * numTasks / _numThreads;
+      int last = static_cast<qint64>(i + 1) * numTasks / _numThreads;
+
+      queue.tasks.clear();
+
+      for ( int j = first; j < last; ++j )
+      {
+         queue.tasks.push_back(j);
+      }
+   }
+
+   // start the run on all other threads
+   {
+      lock_guard<mutex> lock(_mutex);
+      _task = task;
+      _exception = nullptr;
+      _active = _numThreads - 1;
+      ++_generation;
+   }
+
+   _started.notify_all();
+
+   // process tasks on the calling thread
+   work(0);
+
+   // wait for all other threads to finish
+   unique_lock<mutex> lock(_mutex);
+   _finished.wait(lock, [this] { return _active == 0; });
+   _task = nullptr;
+
+   // rethrow the first exception from any task
+   if ( _exception )
+   {
+      rethrow_exception(_exception);
+   }
+}
+
+
+
+
+
+
+/*!
+ * Pin a thread to a CPU. Failures are ignored, since pinning only affects the
+ * performance of the thread pool.
+ *
+ * @param thread
+ * @param cpu
+ */
+void Similarity::ThreadPool::pin(pthread_t thread, int cpu)
+{
+   cpu_set_t set;
+
+   CPU_ZERO(&set);
+   CPU_SET(cpu, &set);
+
+   pthread_setaffinity_np(thread, sizeof(set), &set);
+}
+
+
+
+
+
+
+/*!
+ * Wait for each run of this thread pool and process tasks until the pool is
+ * stopped. This function is the main loop of each thread other than the
+ * calling thread.
+ *
+ * @param thread
+ */
+void Similarity::ThreadPool::loop(int thread)
+{
+   qint64 generation {0};
+
+   while ( true )
+   {
+      // wait for the next run or for the pool to stop
+      {
+         unique_lock<mutex> lock(_mutex);
+         _started.wait(lock, [this, generation] { return _stop || _generation != generation; });
+
+         if ( _stop )
+         {
+            return;
+         }
+
+         generation = _generation;
+      }
+
+      // process tasks
+      work(thread);
+
+      // signal that this thread has finished the run
+      {
+         lock_guard<mutex> lock(_mutex);
+
+         if ( --_active == 0 )
+         {
+            _finished.notify_one();
+         }
+      }
+   }
+}
+
+
+
+
+
+
+/*!
+ * Process tasks on the given thread until no tasks remain in any queue.
+ *
+ * @param thread
+ */
+void Similarity::ThreadPool::work(int thread)
+{
+   int task;
+
+   while ( pop(thread, task) )
+   {
+      try
+      {
+         _task(thread, task);
+      }
+      catch ( ... )
+      {
+         lock_guard<mutex> lock(_mutex);
+
+         if ( !_exception )
+         {
+            _exception = current_exception();
+         }
+      }
+   }
+}
+
+
+
+
+
+
+/*!
+ * Take the next task for the given thread. A thread takes tasks from the front
+ * of its own queue; when its queue is empty it steals a task from the back of
+ * the next queue which is not empty. Returns false if all queues are empty.
+ *
+ * @param thread
+ * @param task
+ */
+bool Similarity::ThreadPool::pop(int thread, int& task)
+{
+   // take a task from the front of this thread's queue
+   {
+      Queue& queue {*_queues[thread]};
+      lock_guard<mutex> lock(queue.mutex);
+
+      if ( !queue.tasks.empty() )
+      {
+         task = queue.tasks.front();
+         queue.tasks.pop_front();
+         return true;
+      }
+   }
+
+   // steal a task from the back of another thread's queue
+   for ( int i = 1; i < _numThreads; ++i )
+   {
+      Queue& queue {*_queues[(thread + i) % _numThreads]};
+      lock_guard<mutex> lock(queue.mutex);
+
+      if ( !queue.tasks.empty() )
+      {
+         task = queue.tasks.back();
+         queue.tasks.pop_back();
+         return true;
+      }
+   }
+
+   return false;
+}
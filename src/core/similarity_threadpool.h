@@ -0,0 +1,121 @@
+#ifndef SIMILARITY_THREADPOOL_H
+#define SIMILARITY_THREADPOOL_H
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+
+#include "similarity.h"
+
+
+
+/*!
+ * This class implements the thread pool of the similarity analytic, which is
+ * used by the serial worker to process a work block with several threads. A
+ * set of tasks is distributed evenly among the threads as contiguous ranges,
+ * and a thread which runs out of tasks steals tasks from the back of another
+ * thread's queue, so that threads stay busy even when the cost of each task
+ * varies widely. The calling thread participates as thread 0. Each thread
+ * can optionally be pinned to a CPU, so that it stays on the same NUMA node.
+ */
+class Similarity::ThreadPool
+{
+public:
+   /*!
+    * Defines the function type of a task, which is given the index of the
+    * thread which runs it and the index of the task.
+    */
+   typedef std::function<void(int, int)> Task;
+public:
+   explicit ThreadPool(int numThreads, const std::vector<int>& cpus = {});
+   ~ThreadPool();
+   /*!
+    * Return the number of threads in this pool, including the calling thread.
+    */
+   int size() const { return _numThreads; }
+   /*!
+    * Return the CPU to which a thread is pinned, or -1 if the threads of this
+    * pool are not pinned.
+    *
+    * @param thread
+    */
+   int cpu(int thread) const { return _cpus.empty() ? -1 : _cpus[thread]; }
+   void run(int numTasks, const Task& task);
+private:
+   /*!
+    * Defines the task queue of a single thread.
+    */
+   struct Queue
+   {
+      /*!
+       * Mutex which protects the queue.
+       */
+      std::mutex mutex;
+      /*!
+       * The indices of the remaining tasks in the queue.
+       */
+      std::deque<int> tasks;
+   };
+   static void pin(pthread_t thread, int cpu);
+   void dispatch(int numTasks, const Task& task);
+   void loop(int thread);
+   void work(int thread);
+   bool pop(int thread, int& task);
+private:
+   /*!
+    * The number of threads in this pool, including the calling thread.
+    */
+   int _numThreads;
+   /*!
+    * The CPU to which each thread is pinned, which is empty if the threads
+    * are not pinned.
+    */
+   std::vector<int> _cpus;
+   /*!
+    * The threads of this pool, excluding the calling thread.
+    */
+   std::vector<std::thread> _threads;
+   /*!
+    * The task queue of each thread.
+    */
+   std::vector<std::unique_ptr<Queue>> _queues;
+   /*!
+    * The task function of the current run.
+    */
+   Task _task;
+   /*!
+    * Mutex which protects the state of the current run.
+    */
+   std::mutex _mutex;
+   /*!
+    * Condition which is signaled when a run is started or the pool is stopped.
+    */
+   std::condition_variable _started;
+   /*!
+    * Condition which is signaled when a thread has finished a run.
+    */
+   std::condition_variable _finished;
+   /*!
+    * The number of runs which have been started.
+    */
+   qint64 _generation {0};
+   /*!
+    * The number of threads which have not finished the current run.
+    */
+   int _active {0};
+   /*!
+    * Whether the threads of this pool should exit.
+    */
+   bool _stop {false};
+   /*!
+    * The first exception which was thrown by a task in the current run.
+    */
+   std::exception_ptr _exception;
+};
+
+
+
+#endif
@@ -2,6 +2,10 @@
 
 
 
+using namespace std;
+
+
+
 
 
 
@@ -19,6 +23,163 @@ Similarity::WorkBlock::WorkBlock(int index, qint64 start, qint64 size):
    _size(size)
 {
    EDEBUG_FUNC(this,index,start,size);
+
+   initialize();
+}
+
+
+
+
+
+
+/*!
+ * Construct a new block with the given index which contains the pairs of a
+ * tile of the pairwise matrix. Only the pairs of the tile which are in the
+ * lower triangle (y < x) belong to the block.
+ *
+ * @param index
+ * @param rowStart
+ * @param rowEnd
+ * @param colStart
+ * @param colEnd
+ */
+Similarity::WorkBlock::WorkBlock(int index, qint32 rowStart, qint32 rowEnd, qint32 colStart, qint32 colEnd):
+   EAbstractAnalyticBlock(index),
+   _tiled(true),
+   _rowStart(rowStart),
+   _rowEnd(rowEnd),
+   _colStart(colStart),
+   _colEnd(colEnd)
+{
+   EDEBUG_FUNC(this,index,rowStart,rowEnd,colStart,colEnd);
+
+   initialize();
+}
+
+
+
+
+
+
+/*!
+ * Return the first column of the given row which belongs to this block.
+ *
+ * @param x
+ */
+qint32 Similarity::WorkBlock::columnBegin(qint32 x) const
+{
+   if ( _tiled )
+   {
+      return _colStart;
+   }
+
+   return max(0LL, _start - Pairwise::Index::rowOffset(x));
+}
+
+
+
+
+
+
+/*!
+ * Return one past the last column of the given row which belongs to this
+ * block. The row is empty if this value is not greater than columnBegin().
+ *
+ * @param x
+ */
+qint32 Similarity::WorkBlock::columnEnd(qint32 x) const
+{
+   if ( _tiled )
+   {
+      return max(_colStart, min(_colEnd, x));
+   }
+
+   return min(static_cast<qint64>(x), _start + _size - Pairwise::Index::rowOffset(x));
+}
+
+
+
+
+
+
+/*!
+ * Return the position within this block of the first pair of the given row,
+ * which is the number of pairs of this block in all previous rows.
+ *
+ * @param x
+ */
+qint64 Similarity::WorkBlock::offset(qint32 x) const
+{
+   if ( _tiled )
+   {
+      // count the rows which intersect the diagonal of the tile
+      qint64 a = max(_rowStart, _colStart);
+      qint64 b = min(x, _colEnd);
+      qint64 diagonal = (b > a) ? ((a - _colStart) + (b - 1 - _colStart)) * (b - a) / 2 : 0;
+
+      // count the rows which lie entirely below the diagonal
+      qint64 full = max(0, x - max(_rowStart, _colEnd)) * static_cast<qint64>(_colEnd - _colStart);
+
+      return diagonal + full;
+   }
+
+   return Pairwise::Index::rowOffset(x) + columnBegin(x) - _start;
+}
+
+
+
+
+
+
+/*!
+ * Return the first pair of this block.
+ */
+Pairwise::Index Similarity::WorkBlock::begin() const
+{
+   qint32 x = _rowStart;
+
+   while ( x < _rowEnd && columnEnd(x) <= columnBegin(x) )
+   {
+      ++x;
+   }
+
+   return Pairwise::Index::fromUnchecked(x, columnBegin(x));
+}
+
+
+
+
+
+
+/*!
+ * Advance a pairwise index to the next pair of this block. Pairs are traversed
+ * row by row, so for a linear block this is the same as incrementing the index.
+ *
+ * @param index
+ */
+void Similarity::WorkBlock::increment(Pairwise::Index& index) const
+{
+   if ( !_tiled )
+   {
+      ++index;
+      return;
+   }
+
+   qint32 x = index.getX();
+   qint32 y = index.getY() + 1;
+
+   if ( y >= columnEnd(x) )
+   {
+      do
+      {
+         ++x;
+      }
+      while ( x < _rowEnd && columnEnd(x) <= columnBegin(x) );
+
+      y = columnBegin(x);
+   }
+
+   index = Pairwise::Index::fromUnchecked(x, y);
 }
 
 
@@ -36,6 +197,7 @@ void Similarity::WorkBlock::write(QDataStream& stream) const
    EDEBUG_FUNC(this,&stream);
 
    stream << _start << _size;
+   stream << _tiled << _rowStart << _rowEnd << _colStart << _colEnd;
 }
 
 
@@ -53,4 +215,32 @@ void Similarity::WorkBlock::read(QDataStream& stream)
    EDEBUG_FUNC(this,&stream);
 
    stream >> _start >> _size;
+   stream >> _tiled >> _rowStart >> _rowEnd >> _colStart >> _colEnd;
+}
+
+
+
+
+
+
+/*!
+ * Initialize the geometry of this block. For a linear block, the range of
+ * rows is determined from the range of pairwise indices and the range of
+ * columns spans every row. For a tiled block, the number of pairs and the
+ * pairwise index of the first pair are determined from the tile.
+ */
+void Similarity::WorkBlock::initialize()
+{
+   if ( _tiled )
+   {
+      _size = offset(_rowEnd);
+      _start = begin().toScalar();
+   }
+   else
+   {
+      _rowStart = Pairwise::Index::rowOf(_start);
+      _rowEnd = Pairwise::Index::rowOf(_start + _size - 1) + 1;
+      _colStart = 0;
+      _colEnd = _rowEnd - 1;
+   }
 }
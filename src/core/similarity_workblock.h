@@ -5,7 +5,13 @@
 
 
 /*!
- * This class implements the work block of the similarity analytic.
+ * This class implements the work block of the similarity analytic. A work
+ * block is either a contiguous range of pairwise indices (linear order) or
+ * the pairs of a rectangular tile of the pairwise matrix, which consists of a
+ * range of rows and a range of columns (tiled order). In either case the
+ * block is traversed row by row, and the pairs of each row are contiguous in
+ * pairwise order, so the block can also be described as a range of rows with
+ * a range of columns for each row.
  */
 class Similarity::WorkBlock : public EAbstractAnalyticBlock
 {
@@ -16,11 +22,24 @@ public:
     */
    explicit WorkBlock() = default;
    explicit WorkBlock(int index, qint64 start, qint64 size);
+   explicit WorkBlock(int index, qint32 rowStart, qint32 rowEnd, qint32 colStart, qint32 colEnd);
    qint64 start() const { return _start; }
    qint64 size() const { return _size; }
+   bool isTiled() const { return _tiled; }
+   qint32 rowStart() const { return _rowStart; }
+   qint32 rowEnd() const { return _rowEnd; }
+   qint32 colStart() const { return _colStart; }
+   qint32 colEnd() const { return _colEnd; }
+   qint32 columnBegin(qint32 x) const;
+   qint32 columnEnd(qint32 x) const;
+   qint64 offset(qint32 x) const;
+   Pairwise::Index begin() const;
+   void increment(Pairwise::Index& index) const;
 protected:
    virtual void write(QDataStream& stream) const override final;
    virtual void read(QDataStream& stream) override final;
+private:
+   void initialize();
 private:
    /*!
     * The pairwise index of the first pair to process.
@@ -30,6 +49,26 @@ private:
     * The number of pairs to process.
     */
    qint64 _size;
+   /*!
+    * Whether this block is a tile of the pairwise matrix.
+    */
+   bool _tiled {false};
+   /*!
+    * The first row of the block.
+    */
+   qint32 _rowStart {0};
+   /*!
+    * One past the last row of the block.
+    */
+   qint32 _rowEnd {0};
+   /*!
+    * The first column of the block.
+    */
+   qint32 _colStart {0};
+   /*!
+    * One past the last column of the block.
+    */
+   qint32 _colEnd {0};
 };
 
 
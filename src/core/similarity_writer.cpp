@@ -0,0 +1,264 @@
+#include "similarity_writer.h"
+#include "ccmatrix.h"
+#include "correlationmatrix.h"
+
+
+
+using namespace std;
+
+
+
+
+
+
+/*!
+ * Construct a new writer for the given output data objects and start its
+ * writer thread.
+ *
+ * @param ccm
+ * @param cmx
+ */
+Similarity::Writer::Writer(CCMatrix* ccm, CorrelationMatrix* cmx):
+   _ccm(ccm),
+   _cmx(cmx),
+   _current(new Buffer)
+{
+   for ( int i = 0; i < QUEUE_SIZE; ++i )
+   {
+      _free.emplace_back(new Buffer);
+   }
+
+   _thread = std::thread(&Writer::loop, this);
+}
+
+
+
+
+
+
+/*!
+ * Stop and join the writer thread. Any buffers which were not flushed are
+ * discarded.
+ */
+Similarity::Writer::~Writer()
+{
+   {
+      lock_guard<mutex> lock(_mutex);
+      _queue.clear();
+      _stop = true;
+   }
+
+   _pushed.notify_all();
+   _thread.join();
+}
+
+
+
+
+
+
+/*!
+ * Encode a pair into the current buffer. Only the clusters whose correlation
+ * is not NAN are kept, and the records of the pair are encoded from its labels
+ * and the map of its kept clusters. The buffer is passed to the writer thread
+ * once it is full.
+ *
+ * @param index
+ * @param pair
+ */
+void Similarity::Writer::append(const Pairwise::Index& index, const Pair& pair)
+{
+   Buffer& buffer {*_current};
+   qint8 clusters[Pairwise::Index::MAX_CLUSTER_SIZE];
+   float correlations[Pairwise::Index::MAX_CLUSTER_SIZE];
+   qint8 size = 0;
+
+   // map each kept cluster to its cluster in the output, skipping
+   // correlations that were removed by the worker
+   for ( qint8 k = 0; k < pair.K; ++k )
+   {
+      float corr = pair.correlations[k];
+
+      if ( isnan(corr) )
+      {
+         clusters[k] = -1;
+         continue;
+      }
+
+      clusters[k] = size;
+      correlations[size] = corr;
+      ++size;
+   }
+
+   if ( size == 0 )
+   {
+      return;
+   }
+
+   // save the index and the records of the pair
+   buffer.indices.push_back(index.getX());
+   buffer.indices.push_back(index.getY());
+   buffer.sizes.push_back(size);
+
+   _ccm->encodePair(pair.labels, clusters, size, buffer.ccmData);
+   _cmx->encodePair(correlations, size, buffer.cmxData);
+
+   if ( static_cast<qint64>(buffer.ccmData.size()) >= BUFFER_SIZE )
+   {
+      submit();
+   }
+}
+
+
+
+
+
+
+/*!
+ * Pass the current buffer to the writer thread if it contains any pairs. If
+ * the queue of the writer thread is full, this function waits until a buffer
+ * has been written. Any exception which was thrown by the writer thread is
+ * rethrown here.
+ */
+void Similarity::Writer::submit()
+{
+   EDEBUG_FUNC(this);
+
+   unique_lock<mutex> lock(_mutex);
+
+   if ( _exception )
+   {
+      rethrow_exception(_exception);
+   }
+
+   if ( _current->sizes.empty() )
+   {
+      return;
+   }
+
+   // wait for an empty buffer
+   _popped.wait(lock, [this] { return !_free.empty() || _exception; });
+
+   if ( _exception )
+   {
+      rethrow_exception(_exception);
+   }
+
+   // queue the current buffer and continue with an empty buffer
+   _queue.push_back(std::move(_current));
+   _current = std::move(_free.back());
+   _free.pop_back();
+
+   _pushed.notify_one();
+}
+
+
+
+
+
+
+/*!
+ * Pass the current buffer to the writer thread and wait until every buffer
+ * has been written. Any exception which was thrown by the writer thread is
+ * rethrown here.
+ */
+void Similarity::Writer::flush()
+{
+   EDEBUG_FUNC(this);
+
+   submit();
+
+   unique_lock<mutex> lock(_mutex);
+   _popped.wait(lock, [this] { return (_queue.empty() && !_busy) || _exception; });
+
+   if ( _exception )
+   {
+      rethrow_exception(_exception);
+   }
+}
+
+
+
+
+
+
+/*!
+ * Write each queued buffer until the writer is stopped. This function is the
+ * main loop of the writer thread.
+ */
+void Similarity::Writer::loop()
+{
+   while ( true )
+   {
+      // wait for the next buffer or for the writer to stop
+      unique_ptr<Buffer> buffer;
+      bool failed;
+
+      {
+         unique_lock<mutex> lock(_mutex);
+         _pushed.wait(lock, [this] { return _stop || !_queue.empty(); });
+
+         if ( _stop )
+         {
+            return;
+         }
+
+         buffer = std::move(_queue.front());
+         _queue.pop_front();
+         _busy = true;
+         failed = static_cast<bool>(_exception);
+      }
+
+      // write the buffer unless a previous buffer has failed
+      try
+      {
+         if ( !failed )
+         {
+            write(*buffer);
+         }
+      }
+      catch ( ... )
+      {
+         lock_guard<mutex> lock(_mutex);
+
+         if ( !_exception )
+         {
+            _exception = current_exception();
+         }
+      }
+
+      // recycle the buffer
+      buffer->indices.clear();
+      buffer->sizes.clear();
+      buffer->ccmData.clear();
+      buffer->cmxData.clear();
+
+      {
+         lock_guard<mutex> lock(_mutex);
+         _free.push_back(std::move(buffer));
+         _busy = false;
+      }
+
+      _popped.notify_all();
+   }
+}
+
+
+
+
+
+
+/*!
+ * Write the pairs of a buffer to the output data objects in the order in which
+ * they were encoded. The records of every pair are already encoded, so they
+ * are appended to each matrix with a single call.
+ *
+ * @param buffer
+ */
+void Similarity::Writer::write(const Buffer& buffer)
+{
+   int size = buffer.sizes.size();
+
+   _ccm->writeRecords(buffer.indices.data(), buffer.sizes.data(), size, buffer.ccmData.data());
+   _cmx->writeRecords(buffer.indices.data(), buffer.sizes.data(), size, buffer.cmxData.data());
+}
@@ -0,0 +1,124 @@
+#ifndef SIMILARITY_WRITER_H
+#define SIMILARITY_WRITER_H
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "similarity.h"
+
+
+
+/*!
+ * This class implements the output writer of the similarity analytic, which
+ * writes the pairs of each result block to the output cluster matrix and
+ * correlation matrix on a dedicated thread, so that the master can collect the
+ * next result block while the previous one is written. Pairs are encoded into
+ * a buffer on the calling thread directly from their labels and the map of
+ * their kept clusters, in the record layout in which they are stored in each
+ * matrix, and each full buffer is passed to the writer thread through a
+ * bounded queue. The writer thread appends the records of a buffer to each
+ * matrix with a single call. Buffers are recycled once they are written, so
+ * the calling thread only waits when the writer thread falls behind by more
+ * than the queue size.
+ */
+class Similarity::Writer
+{
+public:
+   explicit Writer(CCMatrix* ccm, CorrelationMatrix* cmx);
+   ~Writer();
+   void append(const Pairwise::Index& index, const Pair& pair);
+   void submit();
+   void flush();
+private:
+   /*!
+    * Defines a buffer of encoded pairs.
+    */
+   struct Buffer
+   {
+      /*!
+       * The x and y index of each pair.
+       */
+      std::vector<qint32> indices;
+      /*!
+       * The number of kept clusters of each pair.
+       */
+      std::vector<qint8> sizes;
+      /*!
+       * The records of each pair in the cluster matrix.
+       */
+      std::vector<char> ccmData;
+      /*!
+       * The records of each pair in the correlation matrix.
+       */
+      std::vector<char> cmxData;
+   };
+   void loop();
+   void write(const Buffer& buffer);
+private:
+   /*!
+    * The number of full buffers which can wait in the queue of the writer
+    * thread before the calling thread is blocked.
+    */
+   constexpr static int QUEUE_SIZE {2};
+   /*!
+    * The size in bytes of the records of the cluster matrix in a buffer at
+    * which the buffer is passed to the writer thread.
+    */
+   constexpr static qint64 BUFFER_SIZE {1LL << 24};
+   /*!
+    * Pointer to the output cluster matrix.
+    */
+   CCMatrix* _ccm;
+   /*!
+    * Pointer to the output correlation matrix.
+    */
+   CorrelationMatrix* _cmx;
+   /*!
+    * The buffer which is filled by the calling thread.
+    */
+   std::unique_ptr<Buffer> _current;
+   /*!
+    * The full buffers which are waiting to be written.
+    */
+   std::deque<std::unique_ptr<Buffer>> _queue;
+   /*!
+    * The empty buffers which can be reused by the calling thread.
+    */
+   std::vector<std::unique_ptr<Buffer>> _free;
+   /*!
+    * The writer thread.
+    */
+   std::thread _thread;
+   /*!
+    * Mutex which protects the queues and the state of the writer thread.
+    */
+   std::mutex _mutex;
+   /*!
+    * Condition which is signaled when a buffer is queued or the writer is
+    * stopped.
+    */
+   std::condition_variable _pushed;
+   /*!
+    * Condition which is signaled when a buffer has been written.
+    */
+   std::condition_variable _popped;
+   /*!
+    * Whether the writer thread is writing a buffer.
+    */
+   bool _busy {false};
+   /*!
+    * Whether the writer thread should exit.
+    */
+   bool _stop {false};
+   /*!
+    * The first exception which was thrown by the writer thread.
+    */
+   std::exception_ptr _exception;
+};
+
+
+
+#endif
@@ -28,6 +28,7 @@ struct GMM
    int K;
    float logL;
    float entropy;
+   bool abandoned;
    Vector2 *_Mu;
    int *_counts;
    float *_logpi;
@@ -153,8 +154,87 @@ void GMM_Component_computeLogProbNorm(
 
 
 /*!
- * Initialize the mean of each component in the mixture model using k-means
- * clustering.
+ * Compute the squared distance of a sample from the nearest mean of the first
+ * K components.
+ *
+ * @param gmm
+ * @param x
+ * @param K
+ */
+__device__
+float GMM_nearestDistance(GMM *gmm, const Vector2 *x, int K)
+{
+   float min_dist = INFINITY;
+
+   for ( int k = 0; k < K; ++k )
+   {
+      float dist = SQR(x->x - gmm->components[k].mu.x) + SQR(x->y - gmm->components[k].mu.y);
+
+      min_dist = fmin(min_dist, dist);
+   }
+
+   return min_dist;
+}
+
+
+
+
+
+
+/*!
+ * Select a sample as the mean of a new component with the k-means++ rule:
+ * each sample is selected with a probability proportional to its squared
+ * distance from the nearest mean of the first K components.
+ *
+ * @param gmm
+ * @param X
+ * @param N
+ * @param K
+ * @param state
+ */
+__device__
+int GMM_sampleMean(GMM *gmm, const Vector2 *X, int N, int K, unsigned long *state)
+{
+   // compute the sum of the squared distances
+   float total = 0;
+
+   for ( int i = 0; i < N; ++i )
+   {
+      total += GMM_nearestDistance(gmm, &X[i], K);
+   }
+
+   // select a random sample if every sample coincides with a mean
+   if ( !(total > 0) )
+   {
+      return myrand(state) % N;
+   }
+
+   // select a random point along the cumulative sum of the distances
+   float u = total * myrand(state) / 32768.0f;
+   float sum = 0;
+
+   for ( int i = 0; i < N; ++i )
+   {
+      sum += GMM_nearestDistance(gmm, &X[i], K);
+
+      if ( u < sum )
+      {
+         return i;
+      }
+   }
+
+   return N - 1;
+}
+
+
+
+
+
+
+/*!
+ * Refine the mean of each component in the mixture model using k-means
+ * clustering. A component which is not nearest to any sample keeps its
+ * mean.
  *
  * @param gmm
  * @param X
@@ -167,7 +247,7 @@ void GMM_initializeMeans(GMM *gmm, const Vector2 *X, int N)
 
    const int MAX_ITERATIONS = 20;
    const float TOLERANCE = 1e-3f;
-   float diff = 0;
+   float diff = INFINITY;
 
    // initialize workspace
    Vector2 *Mu = gmm->_Mu;
@@ -202,7 +282,14 @@ void GMM_initializeMeans(GMM *gmm, const Vector2 *X, int N)
       // scale each mean by its sample count
       for ( int k = 0; k < K; ++k )
       {
-         vectorScale(&Mu[k], 1.0f / counts[k]);
+         if ( counts[k] > 0 )
+         {
+            vectorScale(&Mu[k], 1.0f / counts[k]);
+         }
+         else
+         {
+            Mu[k] = gmm->components[k].mu;
+         }
       }
 
       // compute the total change of all means
@@ -449,20 +536,18 @@ float GMM_computeEntropy(
 
 
 /*!
- * Fit the mixture model to a pairwise data array and compute the output cluster
- * labels for the data. The data array should only contain clean samples.
+ * Initialize the K components of the mixture model for a pairwise data array.
+ * Each component has a uniform mixture weight, an identity covariance matrix
+ * and a mean which is seeded with k-means++, and the means are then refined
+ * with k-means.
  *
  * @param gmm
  * @param X
  * @param N
  * @param K
- * @param labels
  */
 __device__
-bool GMM_fit(
-   GMM *gmm,
-   const Vector2 *X, int N, int K,
-   char *labels)
+void GMM_initializeComponents(GMM *gmm, const Vector2 *X, int N, int K)
 {
    // initialize random state
    unsigned long state = 1;
@@ -472,20 +557,96 @@ bool GMM_fit(
 
    for ( int k = 0; k < K; ++k )
    {
-      // use uniform mixture weight and randomly sampled mean
-      int i = myrand(&state) % N;
+      // use uniform mixture weight and a random sample as the first mean
+      int i = (k == 0)
+         ? myrand(&state) % N
+         : GMM_sampleMean(gmm, X, N, k, &state);
 
       GMM_Component_initialize(&gmm->components[k], 1.0f / K, &X[i]);
    }
 
-   // initialize means with k-means
+   // refine means with k-means
    GMM_initializeMeans(gmm, X, N);
+}
+
+
+
+
+
+
+/*!
+ * Initialize the components of the mixture model with K + 1 components from
+ * the components of a fitted mixture model with K components. The fitted
+ * components are kept and a new component is added whose mean is seeded with
+ * k-means++.
+ *
+ * @param gmm
+ * @param X
+ * @param N
+ */
+__device__
+void GMM_extendComponents(GMM *gmm, const Vector2 *X, int N)
+{
+   const int K = gmm->K;
+
+   // initialize random state
+   unsigned long state = 1;
+
+   // select the mean of the new component
+   int i = GMM_sampleMean(gmm, X, N, K, &state);
+
+   // scale the mixture weights of the fitted components
+   for ( int k = 0; k < K; ++k )
+   {
+      gmm->components[k].pi *= (float) K / (K + 1);
+   }
+
+   // add the new component
+   GMM_Component_initialize(&gmm->components[K], 1.0f / (K + 1), &X[i]);
+
+   gmm->K = K + 1;
+}
+
+
+
+
+
+
+/*!
+ * Fit the mixture model to a pairwise data array and compute the output cluster
+ * labels for the data, starting from the current components. The data array
+ * should only contain clean samples. The fit is abandoned as soon as an
+ * extrapolation of its final log-likelihood is not above the given threshold,
+ * as described in GMM::fit().
+ *
+ * @param gmm
+ * @param X
+ * @param N
+ * @param threshold
+ * @param labels
+ */
+__device__
+bool GMM_fit(
+   GMM *gmm,
+   const Vector2 *X, int N,
+   float threshold,
+   char *labels)
+{
+   const int K = gmm->K;
 
    // run EM algorithm
    const int MAX_ITERATIONS = 100;
    const float TOLERANCE = 1e-8f;
+   const int EXTRAPOLATE_WINDOW = 4;
+   const float EXTRAPOLATE_TOLERANCE = 0.02f;
+   const float EXTRAPOLATE_SAFETY = 2.0f;
    float prevLogL = -INFINITY;
    float currLogL = -INFINITY;
+   float prevDiff = INFINITY;
+   float prevRatio = INFINITY;
+   int stable = 0;
+
+   gmm->abandoned = false;
 
    for ( int t = 0; t < MAX_ITERATIONS; ++t )
    {
@@ -513,6 +674,28 @@ bool GMM_fit(
          break;
       }
 
+      // return failure if the log-likelihood cannot reach the threshold
+      float diff = currLogL - prevLogL;
+      float ratio = diff / prevDiff;
+
+      if ( 0 < ratio && ratio < 1 && fabs(ratio - prevRatio) <= EXTRAPOLATE_TOLERANCE * ratio )
+      {
+         ++stable;
+      }
+      else
+      {
+         stable = 0;
+      }
+
+      if ( stable >= EXTRAPOLATE_WINDOW && currLogL + EXTRAPOLATE_SAFETY * diff * ratio / (1 - ratio) <= threshold )
+      {
+         gmm->abandoned = true;
+         return false;
+      }
+
+      prevDiff = diff;
+      prevRatio = ratio;
+
       // perform M step
       GMM_computeMStep(gmm, X, N);
    }
@@ -542,6 +725,18 @@ typedef enum
 
 
 
+typedef enum
+{
+   FULL,
+   EXTRAPOLATE,
+   FIRST
+} Selection;
+
+
+
+
+
+
 /*!
  * Compute the Akaike Information Criterion of a Gaussian mixture model.
  *
@@ -605,10 +800,57 @@ float GMM_computeICL(int K, int D, float logL, int N, float E)
 
 
 
+/*!
+ * Compute the log-likelihood threshold which a sub-model with K components
+ * must exceed in order to have a lower criterion value than the given best
+ * value, as described in GMM::computeThreshold().
+ *
+ * @param criterion
+ * @param selection
+ * @param K
+ * @param N
+ * @param bestValue
+ */
+__device__
+float GMM_computeThreshold(Criterion criterion, Selection selection, int K, int N, float bestValue)
+{
+   if ( selection == FULL || isinf(bestValue) )
+   {
+      return -INFINITY;
+   }
+
+   float penalty = INFINITY;
+
+   switch (criterion)
+   {
+   case AIC:
+      penalty = GMM_computeAIC(K, 2, 0);
+      break;
+   case BIC:
+      penalty = GMM_computeBIC(K, 2, 0, N);
+      break;
+   case ICL:
+      penalty = GMM_computeICL(K, 2, 0, N, 0);
+      break;
+   }
+
+   return 0.5f * (penalty - bestValue);
+}
+
+
+
+
+
+
 /*!
  * Determine the number of clusters in a pairwise data array. Several sub-models,
  * each one having a different number of clusters, are fit to the data and the
- * sub-model with the best criterion value is selected.
+ * sub-model with the best criterion value is selected. Each sub-model is warm
+ * started from the previous sub-model if it was fit successfully or abandoned.
+ * Depending on the selection strategy, sub-models which are not expected to
+ * have the best criterion value are abandoned, and the remaining sub-models
+ * are skipped after the first sub-model which does not improve the criterion
+ * value.
  *
  * @param globalWorkSize
  * @param expressions
@@ -618,6 +860,7 @@ float GMM_computeICL(int K, int D, float logL, int N, float E)
  * @param minClusters
  * @param maxClusters
  * @param criterion
+ * @param selection
  * @param out_K
  * @param out_labels
  */
@@ -631,6 +874,7 @@ void GMM_compute(
    char minClusters,
    char maxClusters,
    Criterion criterion,
+   Selection selection,
    Vector2 *work_xy,
    int *work_N,
    char *work_labels,
@@ -667,7 +911,7 @@ void GMM_compute(
    // initialize GMM struct
    GMM gmm = {
       components,
-      0, 0, 0,
+      0, 0, 0, false,
       Mu,
       counts,
       logpi,
@@ -691,11 +935,26 @@ void GMM_compute(
 
       // determine the number of clusters
       float bestValue = INFINITY;
+      bool warmStart = false;
 
       for ( char K = minClusters; K <= maxClusters; ++K )
       {
+         // initialize each sub-model from the previous sub-model if it was fit
+         // or abandoned
+         if ( warmStart )
+         {
+            GMM_extendComponents(&gmm, X, numSamples);
+         }
+         else
+         {
+            GMM_initializeComponents(&gmm, X, numSamples, K);
+         }
+
          // run each clustering sub-model
-         bool success = GMM_fit(&gmm, X, numSamples, K, labels);
+         float threshold = GMM_computeThreshold(criterion, selection, K, numSamples, bestValue);
+         bool success = GMM_fit(&gmm, X, numSamples, threshold, labels);
+
+         warmStart = success || gmm.abandoned;
 
          if ( !success )
          {
@@ -718,6 +977,12 @@ void GMM_compute(
             break;
          }
 
+         // skip the remaining sub-models if the sub-model is not an improvement
+         if ( selection == FIRST && value >= bestValue )
+         {
+            break;
+         }
+
          // save the sub-model with the lowest criterion value
          if ( value < bestValue )
          {
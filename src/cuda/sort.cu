@@ -175,3 +175,64 @@ void bitonicSortFI(int size, float *array, int *extra)
       }
    }
 }
+
+
+
+
+
+
+/*!
+ * Select the k-th smallest value of an array in place, using the selection
+ * algorithm of Hoare with the partition scheme of Wirth. Afterwards the
+ * values before position k are not greater than the selected value, and the
+ * values after position k are not less than it.
+ *
+ * @param array
+ * @param size
+ * @param k
+ */
+__device__
+float quickSelect(float *array, int size, int k)
+{
+   int left = 0;
+   int right = size - 1;
+
+   while ( left < right )
+   {
+      float pivot = array[k];
+      int i = left;
+      int j = right;
+
+      do
+      {
+         while ( array[i] < pivot )
+         {
+            i++;
+         }
+
+         while ( pivot < array[j] )
+         {
+            j--;
+         }
+
+         if ( i <= j )
+         {
+            swapF(&array[i], &array[j]);
+            i++;
+            j--;
+         }
+      } while ( i <= j );
+
+      if ( j < k )
+      {
+         left = i;
+      }
+
+      if ( k < i )
+      {
+         right = j;
+      }
+   }
+
+   return array[k];
+}
@@ -1,4 +1,3 @@
-
 // #include "sort.cl"
 
 
@@ -12,6 +11,10 @@
  * samples in the given cluster are used in outlier detection. For unclustered data,
  * all samples are labeled as 0, so a cluster value of 0 should be used.
  *
+ * The quartiles of each axis are selected from the samples of the cluster,
+ * which are copied into the given workspace, unless the quartiles of both
+ * axes are given.
+ *
  * This function returns the number of clean samples remaining in the data array,
  * including samples in other clusters.
  *
@@ -21,8 +24,10 @@
  * @param sampleSize
  * @param cluster
  * @param marker
- * @param x_sorted
- * @param y_sorted
+ * @param x_work
+ * @param y_work
+ * @param quartiles_x
+ * @param quartiles_y
  */
 int removeOutliersCluster(
    __global const float *x,
@@ -31,49 +36,55 @@ int removeOutliersCluster(
    int sampleSize,
    char cluster,
    char marker,
-   __global float *x_sorted,
-   __global float *y_sorted)
+   __global float *x_work,
+   __global float *y_work,
+   __global const float *quartiles_x,
+   __global const float *quartiles_y)
 {
-   // extract samples from the given cluster into separate arrays
-   int n = 0;
+   float Q1_x, Q3_x, Q1_y, Q3_y;
 
-   for ( int i = 0; i < sampleSize; i++ )
+   if ( quartiles_x && quartiles_y )
    {
-      if ( labels[i] == cluster )
+      Q1_x = quartiles_x[0];
+      Q3_x = quartiles_x[1];
+      Q1_y = quartiles_y[0];
+      Q3_y = quartiles_y[1];
+   }
+   else
+   {
+      // extract samples from the given cluster into separate arrays
+      int n = 0;
+
+      for ( int i = 0; i < sampleSize; i++ )
       {
-         x_sorted[n] = x[i];
-         y_sorted[n] = y[i];
-         n++;
+         if ( labels[i] == cluster )
+         {
+            x_work[n] = x[i];
+            y_work[n] = y[i];
+            n++;
+         }
       }
-   }
 
-   // get power of 2 size
-   int N_pow2 = nextPower2(sampleSize);
+      // return if the given cluster is empty
+      if ( n == 0 )
+      {
+         return 0;
+      }
 
-   for ( int i = n; i < N_pow2; ++i )
-   {
-      x_sorted[i] = INFINITY;
-      y_sorted[i] = INFINITY;
-   }
+      // select quartiles for each axis
+      const int k1 = n * 1 / 4;
+      const int k3 = n * 3 / 4;
 
-   // return if the given cluster is empty
-   if ( n == 0 )
-   {
-      return 0;
-   }
+      Q1_x = quickSelect(x_work, n, k1);
+      Q3_x = (k3 > k1) ? quickSelect(&x_work[k1 + 1], n - k1 - 1, k3 - k1 - 1) : Q1_x;
 
-   // sort samples for each axis
-   bitonicSort(x_sorted, N_pow2);
-   bitonicSort(y_sorted, N_pow2);
+      Q1_y = quickSelect(y_work, n, k1);
+      Q3_y = (k3 > k1) ? quickSelect(&y_work[k1 + 1], n - k1 - 1, k3 - k1 - 1) : Q1_y;
+   }
 
-   // compute interquartile range and thresholds for each axis
-   float Q1_x = x_sorted[n * 1 / 4];
-   float Q3_x = x_sorted[n * 3 / 4];
+   // compute thresholds for each axis
    float T_x_min = Q1_x - 1.5f * (Q3_x - Q1_x);
    float T_x_max = Q3_x + 1.5f * (Q3_x - Q1_x);
-
-   float Q1_y = y_sorted[n * 1 / 4];
-   float Q3_y = y_sorted[n * 3 / 4];
    float T_y_min = Q1_y - 1.5f * (Q3_y - Q1_y);
    float T_y_max = Q3_y + 1.5f * (Q3_y - Q1_y);
 
@@ -105,7 +116,9 @@ int removeOutliersCluster(
 
 
 /*!
- * Perform outlier removal on each cluster in a parwise data array.
+ * Perform outlier removal on each cluster in a parwise data array. Pre-clustering
+ * outlier removal uses the quartiles of each gene if every sample of the pair is
+ * clean.
  *
  * @param globalWorkSize
  * @param expressions
@@ -114,7 +127,9 @@ int removeOutliersCluster(
  * @param in_N
  * @param in_labels
  * @param in_K
+ * @param in_quartiles
  * @param marker
+ * @param work_xy
  */
 __kernel void removeOutliers(
    int globalWorkSize,
@@ -124,6 +139,7 @@ __kernel void removeOutliers(
    __global int *in_N,
    __global char *in_labels,
    __global char *in_K,
+   __global const float *in_quartiles,
    char marker,
    __global float *work_xy)
 {
@@ -142,8 +158,8 @@ __kernel void removeOutliers(
    __global int *p_N = &in_N[i];
    __global char *labels = &in_labels[i * sampleSize];
    char clusterSize = in_K[i];
-   __global float *x_sorted = &work_xy[(2 * i + 0) * N_pow2];
-   __global float *y_sorted = &work_xy[(2 * i + 1) * N_pow2];
+   __global float *x_work = &work_xy[(2 * i + 0) * N_pow2];
+   __global float *y_work = &work_xy[(2 * i + 1) * N_pow2];
 
    if ( marker == -7 )
    {
@@ -156,12 +172,22 @@ __kernel void removeOutliers(
       return;
    }
 
+   // use the quartiles of each gene if every sample is clean
+   if ( marker == -7 && *p_N == sampleSize )
+   {
+      __global const float *quartiles_x = &in_quartiles[2 * index.x];
+      __global const float *quartiles_y = &in_quartiles[2 * index.y];
+
+      *p_N = removeOutliersCluster(x, y, labels, sampleSize, 0, marker, x_work, y_work, quartiles_x, quartiles_y);
+      return;
+   }
+
    // perform outlier removal on each cluster
    int N;
 
    for ( char k = 0; k < clusterSize; ++k )
    {
-      N = removeOutliersCluster(x, y, labels, sampleSize, k, marker, x_sorted, y_sorted);
+      N = removeOutliersCluster(x, y, labels, sampleSize, k, marker, x_work, y_work, 0, 0);
    }
 
    // save number of remaining samples
@@ -5,10 +5,15 @@
 #include "testexportcorrelationmatrix.h"
 #include "testexportexpressionmatrix.h"
 #include "testexpressionmatrix.h"
+#include "testgmm.h"
 #include "testimportcorrelationmatrix.h"
 #include "testimportexpressionmatrix.h"
+#include "testpairwiseindex.h"
+#include "testquartiles.h"
 #include "testrmt.h"
+#include "testsamplemasks.h"
 #include "testsimilarity.h"
+#include "testtiledcorrelation.h"
 
 
 
@@ -33,10 +38,15 @@ int main(int argc, char **argv)
 		// ASSERT_TEST(new TestExportCorrelationMatrix);
 		// ASSERT_TEST(new TestExportExpressionMatrix);
 		ASSERT_TEST(new TestExpressionMatrix);
+		ASSERT_TEST(new TestGMM);
 		// ASSERT_TEST(new TestImportCorrelationMatrix);
 		// ASSERT_TEST(new TestImportExpressionMatrix);
+		ASSERT_TEST(new TestPairwiseIndex);
+		ASSERT_TEST(new TestQuartiles);
 		// ASSERT_TEST(new TestRMT);
+		ASSERT_TEST(new TestSampleMasks);
 		// ASSERT_TEST(new TestSimilarity);
+		ASSERT_TEST(new TestTiledCorrelation);
 	}
 	catch ( EException& e )
 	{
@@ -102,4 +102,172 @@ void TestClusterMatrix::test()
 			}
 		}
 	}
+	// create random cluster data which is derived from sample labels
+	QVector<Pair> labelPairs;
+
+	for ( int i = 0; i < numGenes; ++i )
+	{
+		for ( int j = 0; j < i; ++j )
+		{
+			int numClusters = rand() % (maxClusters + 1);
+
+			if ( numClusters > 0 )
+			{
+				QVector<QVector<qint8>> sampleMasks(numClusters, QVector<qint8>(numSamples));
+
+				for ( int n = 0; n < numSamples; ++n )
+				{
+					int label = rand() % (numClusters + 3) - 2;
+					qint8 value = (label == -2) ? 9 : (label == -1) ? 6 : 0;
+
+					for ( int k = 0; k < numClusters; ++k )
+					{
+						sampleMasks[k][n] = (k == label) ? 1 : value;
+					}
+				}
+
+				labelPairs.append({ { i, j }, sampleMasks });
+			}
+		}
+	}
+
+	// create data object in the label format
+	QString labelPath {QDir::tempPath() + "/test-labels.ccm"};
+
+	std::unique_ptr<Ace::DataObject> labelDataRef {new Ace::DataObject(labelPath, DataFactory::CCMatrixType, EMetaObject())};
+	CCMatrix* labelMatrix {labelDataRef->data()->cast<CCMatrix>()};
+
+	labelMatrix->initialize(metaGeneNames, maxClusters, metaSampleNames, CCMatrix::Format::Labels);
+
+	CCMatrix::Pair labelPair(labelMatrix);
+
+	for ( auto& testPair : labelPairs )
+	{
+		labelPair.clearClusters();
+		labelPair.addCluster(testPair.sampleMasks.size());
+
+		for ( int k = 0; k < labelPair.clusterSize(); ++k )
+		{
+			for ( int n = 0; n < numSamples; ++n )
+			{
+				labelPair.at(k, n) = testPair.sampleMasks.at(k).at(n);
+			}
+		}
+
+		labelPair.write(testPair.index);
+	}
+
+	labelMatrix->finish();
+
+	// verify that the sample masks are reconstructed from the label format
+	labelPair.reset();
+
+	for ( auto& testPair : labelPairs )
+	{
+		QVERIFY(labelPair.hasNext());
+		labelPair.readNext();
+
+		QCOMPARE(labelPair.index(), testPair.index);
+		QCOMPARE(labelPair.clusterSize(), testPair.sampleMasks.size());
+
+		for ( int k = 0; k < labelPair.clusterSize(); ++k )
+		{
+			for ( int n = 0; n < numSamples; ++n )
+			{
+				QCOMPARE(labelPair.at(k, n), testPair.sampleMasks.at(k).at(n));
+			}
+		}
+	}
+
+	// verify that random access reads the same pairs
+	for ( auto& testPair : labelPairs )
+	{
+		labelPair.read(testPair.index);
+
+		QCOMPARE(labelPair.clusterSize(), testPair.sampleMasks.size());
+	}
+
+	// verify that pairs which are encoded from their labels and kept clusters
+	// are read back as the same sample masks in both formats
+	for ( auto format : { CCMatrix::Format::Masks, CCMatrix::Format::Labels } )
+	{
+		QString encodedPath {QDir::tempPath() + "/test-encoded.ccm"};
+
+		std::unique_ptr<Ace::DataObject> encodedDataRef {new Ace::DataObject(encodedPath, DataFactory::CCMatrixType, EMetaObject())};
+		CCMatrix* encodedMatrix {encodedDataRef->data()->cast<CCMatrix>()};
+
+		encodedMatrix->initialize(metaGeneNames, maxClusters, metaSampleNames, format);
+
+		QVector<Pair> encodedPairs;
+		std::vector<qint32> indices;
+		std::vector<qint8> sizes;
+		std::vector<char> data;
+
+		for ( int i = 0; i < numGenes; ++i )
+		{
+			for ( int j = 0; j < i; ++j )
+			{
+				// create random labels and keep a random subset of clusters
+				int K = rand() % maxClusters + 1;
+				QVector<qint8> labels(numSamples);
+				QVector<qint8> clusters(K);
+				qint8 clusterSize = 0;
+
+				for ( int n = 0; n < numSamples; ++n )
+				{
+					int label = rand() % (K + 2) - 2;
+					labels[n] = (label == -2) ? -9 : (label == -1) ? -6 : label;
+				}
+
+				for ( int k = 0; k < K; ++k )
+				{
+					clusters[k] = (rand() % 3 == 0) ? -1 : clusterSize++;
+				}
+
+				if ( clusterSize == 0 )
+				{
+					continue;
+				}
+
+				// save the expected sample masks and encode the pair
+				QVector<QVector<qint8>> sampleMasks(clusterSize, QVector<qint8>(numSamples));
+
+				for ( int k = 0; k < clusterSize; ++k )
+				{
+					for ( int n = 0; n < numSamples; ++n )
+					{
+						sampleMasks[k][n] = (labels[n] >= 0) ? (clusters[labels[n]] == k) : -labels[n];
+					}
+				}
+
+				encodedPairs.append({ { i, j }, sampleMasks });
+				indices.push_back(i);
+				indices.push_back(j);
+				sizes.push_back(clusterSize);
+				encodedMatrix->encodePair(labels.constData(), clusters.constData(), clusterSize, data);
+			}
+		}
+
+		encodedMatrix->writeRecords(indices.data(), sizes.data(), sizes.size(), data.data());
+		encodedMatrix->finish();
+
+		CCMatrix::Pair encodedPair(encodedMatrix);
+
+		for ( auto& testPair : encodedPairs )
+		{
+			QVERIFY(encodedPair.hasNext());
+			encodedPair.readNext();
+
+			QCOMPARE(encodedPair.index(), testPair.index);
+			QCOMPARE(encodedPair.clusterSize(), testPair.sampleMasks.size());
+
+			for ( int k = 0; k < encodedPair.clusterSize(); ++k )
+			{
+				for ( int n = 0; n < numSamples; ++n )
+				{
+					QCOMPARE(encodedPair.at(k, n), testPair.sampleMasks.at(k).at(n));
+				}
+			}
+		}
+	}
 }
@@ -86,4 +86,70 @@ void TestCorrelationMatrix::test()
 			QCOMPARE(pair.at(k), testPair.correlations.at(k));
 		}
 	}
+	// verify that the raw data has the same pairs
+	CorrelationMatrix::RawData rawData {matrix->dumpRawData()};
+
+	QCOMPARE(static_cast<int>(rawData.pairs.size()), testPairs.size());
+
+	for ( int i = 0; i < testPairs.size(); ++i )
+	{
+		auto& rawPair {rawData.pairs[i]};
+
+		QCOMPARE(rawPair.index, testPairs[i].index);
+		QCOMPARE(rawPair.clusterSize, testPairs[i].correlations.size());
+
+		for ( int k = 0; k < rawPair.clusterSize; ++k )
+		{
+			QCOMPARE(rawPair.correlations[k], testPairs[i].correlations.at(k));
+		}
+	}
+
+	// create a larger matrix which is stored in several chunks
+	int numLargeGenes = 400;
+	EMetaArray metaLargeGeneNames;
+
+	for ( int i = 0; i < numLargeGenes; ++i )
+	{
+		metaLargeGeneNames.append(QString::number(i));
+	}
+
+	QString largePath {QDir::tempPath() + "/test-large.cmx"};
+
+	std::unique_ptr<Ace::DataObject> largeDataRef {new Ace::DataObject(largePath, DataFactory::CorrelationMatrixType, EMetaObject())};
+	CorrelationMatrix* largeMatrix {largeDataRef->data()->cast<CorrelationMatrix>()};
+
+	largeMatrix->initialize(metaLargeGeneNames, maxClusters, "test");
+
+	CorrelationMatrix::Pair largePair(largeMatrix);
+
+	for ( Pairwise::Index index; index.getX() < numLargeGenes; ++index )
+	{
+		if ( index.toScalar() % 3 != 0 )
+		{
+			largePair.clearClusters();
+			largePair.addCluster();
+			largePair.at(0) = index.toScalar();
+			largePair.write(index);
+		}
+	}
+
+	largeMatrix->finish();
+
+	// verify that pairs are found in any order, and that missing pairs are empty
+	for ( qint64 i = Pairwise::Index(numLargeGenes, 0).toScalar() - 1; i >= 0; i -= 97 )
+	{
+		Pairwise::Index index(i);
+
+		largePair.read(index);
+
+		if ( i % 3 != 0 )
+		{
+			QCOMPARE(largePair.clusterSize(), 1);
+			QCOMPARE(largePair.at(0), static_cast<float>(i));
+		}
+		else
+		{
+			QCOMPARE(largePair.clusterSize(), 0);
+		}
+	}
 }
@@ -5,6 +5,7 @@
 #include "../core/datafactory.h"
 #include "../core/expressionmatrix.h"
 #include "../core/expressionmatrix_gene.h"
+#include "../core/expressionmatrix_view.h"
 
 
 
@@ -61,4 +62,114 @@ void TestExpressionMatrix::test()
 
 	// verify expression data
 	QVERIFY(!memcmp(testExpressions.data(), expressions.data(), testExpressions.size() * sizeof(float)));
+
+	// verify that the shared view has the same expression data
+	std::shared_ptr<const ExpressionMatrix::View> view {matrix->mapRawData()};
+
+	QCOMPARE(view->size(), static_cast<qint64>(testExpressions.size()));
+	QVERIFY(!memcmp(testExpressions.data(), view->data(), testExpressions.size() * sizeof(float)));
+
+	// verify that the view is shared while it is owned
+	QVERIFY(matrix->mapRawData() == view);
+
+	// verify that an interleaved view has the same expression data
+	std::shared_ptr<const ExpressionMatrix::View> interleaved {matrix->mapRawData(false, ExpressionMatrix::View::ALL_NODES)};
+
+	QVERIFY(interleaved != view);
+	QVERIFY(!memcmp(testExpressions.data(), interleaved->data(), testExpressions.size() * sizeof(float)));
+}
+
+
+
+
+void TestExpressionMatrix::testPrecision()
+{
+	// create random expression data with a missing expression
+	int numGenes = 10;
+	int numSamples = 5;
+	std::vector<float> testExpressions(numGenes * numSamples);
+
+	for ( size_t i = 0; i < testExpressions.size(); ++i )
+	{
+		testExpressions[i] = -10.0f + 20.0f * rand() / (1 << 31);
+	}
+
+	testExpressions[1] = NAN;
+
+	// create metadata
+	QStringList geneNames;
+	QStringList sampleNames;
+
+	for ( int i = 0; i < numGenes; ++i )
+	{
+		geneNames.append(QString::number(i));
+	}
+
+	for ( int i = 0; i < numSamples; ++i )
+	{
+		sampleNames.append(QString::number(i));
+	}
+
+	// define the error bound of each precision, relative for floating point
+	// and absolute for integers, which are scaled to a range of 20
+	struct Bound
+	{
+		ExpressionMatrix::Precision precision;
+		float relative;
+		float absolute;
+	};
+
+	Bound bounds[] {
+		{ ExpressionMatrix::Precision::Float16, ldexpf(1, -11), ldexpf(1, -25) },
+		{ ExpressionMatrix::Precision::BFloat16, ldexpf(1, -8), 0 },
+		{ ExpressionMatrix::Precision::Int16, 0, 20.0f / 131068 * 1.001f }
+	};
+
+	for ( const Bound& bound : bounds )
+	{
+		// write data to file
+		QString path {QDir::tempPath() + "/test-precision.emx"};
+
+		std::unique_ptr<Ace::DataObject> dataRef {new Ace::DataObject(path, DataFactory::ExpressionMatrixType, EMetaObject())};
+		ExpressionMatrix* matrix {dataRef->data()->cast<ExpressionMatrix>()};
+
+		matrix->initialize(geneNames, sampleNames, bound.precision);
+
+		ExpressionMatrix::Gene gene(matrix);
+		for ( int i = 0; i < matrix->geneSize(); ++i )
+		{
+			for ( int j = 0; j < matrix->sampleSize(); ++j )
+			{
+				gene[j] = testExpressions[i * numSamples + j];
+			}
+
+			gene.write(i);
+		}
+
+		matrix->finish();
+		dataRef.reset();
+
+		// read expression data from file
+		dataRef.reset(new Ace::DataObject(path));
+		matrix = dataRef->data()->cast<ExpressionMatrix>();
+
+		QVERIFY(matrix->precision() == bound.precision);
+		QCOMPARE(matrix->geneSize(), numGenes);
+		QCOMPARE(matrix->sampleSize(), numSamples);
+
+		std::vector<float> expressions {matrix->dumpRawData()};
+
+		// verify that each expression is within the error bound
+		for ( size_t i = 0; i < testExpressions.size(); ++i )
+		{
+			if ( std::isnan(testExpressions[i]) )
+			{
+				QVERIFY(std::isnan(expressions[i]));
+			}
+			else
+			{
+				QVERIFY(fabs(expressions[i] - testExpressions[i]) <= bound.relative * fabs(testExpressions[i]) + bound.absolute);
+			}
+		}
+	}
 }
@@ -9,6 +9,7 @@ class TestExpressionMatrix : public QObject
 	Q_OBJECT
 private slots:
 	void test();
+	void testPrecision();
 };
 
 
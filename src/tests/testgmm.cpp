@@ -0,0 +1,144 @@
+#include <ace/core/core.h>
+#include <ace/core/ace_dataobject.h>
+#include <numeric>
+
+#include "testgmm.h"
+#include "../core/expressionmatrix_gene.h"
+#include "../core/pairwise_gmm.h"
+#include "../core/pairwise_vbgmm.h"
+
+
+
+void TestGMM::test()
+{
+	// create random expression data with two clusters and missing values
+	int numGenes = 2;
+	int numSamples = 203;
+	int minSamples = 30;
+	std::vector<float> expressions(numGenes * numSamples);
+	QVector<qint8> labels(numSamples);
+
+	for ( int j = 0; j < numSamples; ++j )
+	{
+		float offset = (rand() % 2) ? 5.0f : 0.0f;
+
+		expressions[0 * numSamples + j] = offset + 2.0f * rand() / RAND_MAX;
+		expressions[1 * numSamples + j] = offset + 2.0f * rand() / RAND_MAX;
+		labels[j] = (rand() % 10 == 0) ? -9 : 0;
+	}
+
+	int cleanSamples = std::count(labels.begin(), labels.end(), 0);
+
+	// create metadata
+	QStringList geneNames;
+	QStringList sampleNames;
+
+	for ( int i = 0; i < numGenes; ++i )
+	{
+		geneNames.append(QString::number(i));
+	}
+
+	for ( int i = 0; i < numSamples; ++i )
+	{
+		sampleNames.append(QString::number(i));
+	}
+
+	// create expression matrix
+	QString emxPath {QDir::tempPath() + "/test.emx"};
+
+	QFile(emxPath).remove();
+
+	std::unique_ptr<Ace::DataObject> emxDataRef {new Ace::DataObject(emxPath)};
+	ExpressionMatrix* emx {emxDataRef->data()->cast<ExpressionMatrix>()};
+
+	emx->initialize(geneNames, sampleNames);
+
+	ExpressionMatrix::Gene gene(emx);
+	for ( int i = 0; i < emx->geneSize(); ++i )
+	{
+		for ( int j = 0; j < emx->sampleSize(); ++j )
+		{
+			gene[j] = expressions[i * numSamples + j];
+		}
+
+		gene.write(i);
+	}
+
+	emxDataRef->data()->finish();
+	emxDataRef->finalize();
+
+	// compute the reference clustering with the scalar kernels
+	Pairwise::GMM scalarModel(emx, 5, Pairwise::SimdLevel::Scalar);
+	Pairwise::Index index(1, 0);
+	QVector<qint8> expectedLabels {labels};
+
+	qint8 expectedK = scalarModel.compute(expressions.data(), index, cleanSamples, expectedLabels, minSamples, 1, 5, Pairwise::Criterion::ICL);
+
+	QVERIFY(expectedK > 0);
+
+	// verify that the kernels of every supported instruction set give the same clustering
+	for ( auto level : { Pairwise::SimdLevel::SSE2, Pairwise::SimdLevel::AVX2, Pairwise::SimdLevel::AVX512 } )
+	{
+		if ( !Pairwise::simdSupported(level) )
+		{
+			continue;
+		}
+
+		Pairwise::GMM model(emx, 5, level);
+		QVector<qint8> actualLabels {labels};
+
+		qint8 actualK = model.compute(expressions.data(), index, cleanSamples, actualLabels, minSamples, 1, 5, Pairwise::Criterion::ICL);
+
+		QCOMPARE(actualK, expectedK);
+		QCOMPARE(actualLabels, expectedLabels);
+	}
+
+	// verify that each selection strategy skips a sub-model and finds a clustering
+	for ( auto selection : { Pairwise::Selection::Extrapolate, Pairwise::Selection::First } )
+	{
+		Pairwise::GMM selectModel(emx, 5, Pairwise::SimdLevel::Scalar, selection);
+		QVector<qint8> selectLabels {labels};
+
+		qint8 selectK = selectModel.compute(expressions.data(), index, cleanSamples, selectLabels, minSamples, 1, 5, Pairwise::Criterion::ICL);
+
+		QVERIFY(selectK > 0);
+		QCOMPARE(std::accumulate(selectModel.skipped().begin(), selectModel.skipped().end(), static_cast<qint64>(0)), static_cast<qint64>(1));
+	}
+
+	// verify that the variational model finds both clusters with every instruction set
+	Pairwise::VBGMM scalarVBModel(emx, 5, 0.05f, Pairwise::SimdLevel::Scalar);
+	QVector<qint8> expectedVBLabels {labels};
+
+	qint8 expectedVBK = scalarVBModel.compute(expressions.data(), index, cleanSamples, expectedVBLabels, minSamples, 1, 5, Pairwise::Criterion::ICL);
+
+	QCOMPARE(expectedVBK, static_cast<qint8>(2));
+
+	for ( auto level : { Pairwise::SimdLevel::SSE2, Pairwise::SimdLevel::AVX2, Pairwise::SimdLevel::AVX512 } )
+	{
+		if ( !Pairwise::simdSupported(level) )
+		{
+			continue;
+		}
+
+		Pairwise::VBGMM model(emx, 5, 0.05f, level);
+		QVector<qint8> actualLabels {labels};
+
+		qint8 actualK = model.compute(expressions.data(), index, cleanSamples, actualLabels, minSamples, 1, 5, Pairwise::Criterion::ICL);
+
+		QCOMPARE(actualK, expectedVBK);
+		QCOMPARE(actualLabels, expectedVBLabels);
+	}
+
+	// verify that a degenerate variational fit fails instead of leaking an
+	// invalid label, since a clean sample which is NAN makes every
+	// responsibility NAN
+	std::vector<float> degenerate {expressions};
+	int first = std::find(labels.begin(), labels.end(), 0) - labels.begin();
+
+	degenerate[first] = NAN;
+
+	QVector<qint8> degenerateLabels {labels};
+	qint8 degenerateK = scalarVBModel.compute(degenerate.data(), index, cleanSamples, degenerateLabels, minSamples, 1, 5, Pairwise::Criterion::ICL);
+
+	QCOMPARE(degenerateK, static_cast<qint8>(0));
+}
@@ -0,0 +1,16 @@
+#ifndef TESTGMM_H
+#define TESTGMM_H
+#include <QtTest/QtTest>
+
+
+
+class TestGMM : public QObject
+{
+	Q_OBJECT
+private slots:
+	void test();
+};
+
+
+
+#endif
@@ -0,0 +1,198 @@
+#include <ace/core/core.h>
+
+#include "testpairwiseindex.h"
+#include "../core/pairwise_index.h"
+
+
+
+/*!
+ * Decode a scalar index by walking the rows one at a time, which is the
+ * reference implementation of Pairwise::Index::Index(qint64).
+ *
+ * @param index
+ */
+static Pairwise::Index decodeLoop(qint64 index)
+{
+	qint64 pos {0};
+	qint64 x {0};
+
+	while ( pos + x <= index )
+	{
+		pos += x;
+		++x;
+	}
+
+	return Pairwise::Index(static_cast<qint32>(x), static_cast<qint32>(index - pos));
+}
+
+
+
+void TestPairwiseIndex::test()
+{
+	// verify decode of every pair in a small matrix
+	qint64 scalar {0};
+
+	for ( qint32 x = 1; x < 1000; ++x )
+	{
+		for ( qint32 y = 0; y < x; ++y )
+		{
+			Pairwise::Index index(scalar);
+
+			QCOMPARE(index.getX(), x);
+			QCOMPARE(index.getY(), y);
+			QCOMPARE(index.toScalar(), scalar);
+
+			++scalar;
+		}
+	}
+
+	// verify decode at the boundaries of rows in a large matrix
+	qint32 geneSize {500000};
+
+	for ( qint32 x = 1; x < geneSize; x += 9973 )
+	{
+		for ( qint32 y : { 0, x / 2, x - 1 } )
+		{
+			Pairwise::Index index(Pairwise::Index::rowOffset(x) + y);
+
+			QCOMPARE(index.getX(), x);
+			QCOMPARE(index.getY(), y);
+		}
+	}
+
+	// verify that the closed-form decode matches the reference decode
+	for ( qint64 i = 0; i < 100; ++i )
+	{
+		qint64 scalar {i * i * i * 1237};
+
+		QVERIFY(Pairwise::Index(scalar) == decodeLoop(scalar));
+	}
+
+	// verify range iterator
+	qint64 start {123456789};
+	qint64 size {50000};
+	qint64 count {0};
+
+	for ( const Pairwise::Index& index : Pairwise::Index::Range(start, size) )
+	{
+		QCOMPARE(index.toScalar(), start + count);
+		++count;
+	}
+
+	QCOMPARE(count, size);
+
+	// verify row split
+	qint64 offset {0};
+
+	for ( auto& row : Pairwise::Index::splitRows(start, size) )
+	{
+		QCOMPARE(row.offset, offset);
+		QCOMPARE(Pairwise::Index::rowOffset(row.x) + row.yBegin, start + offset);
+
+		offset += row.yEnd - row.yBegin;
+	}
+
+	QCOMPARE(offset, size);
+
+	// verify tile numbering
+	qint32 tileSize {64};
+	qint32 numTiles {(1000 + tileSize - 1) / tileSize};
+	qint64 tile {0};
+
+	for ( qint32 i = 0; i < numTiles; ++i )
+	{
+		for ( qint32 j = 0; j <= i; ++j )
+		{
+			Pairwise::Index::Tile t {Pairwise::Index::tileAt(tile, 1000, tileSize)};
+
+			QCOMPARE(t.rowStart, i * tileSize);
+			QCOMPARE(t.colStart, j * tileSize);
+			QCOMPARE(t.rowEnd, qMin((i + 1) * tileSize, 1000));
+			QCOMPARE(t.colEnd, qMin((j + 1) * tileSize, 1000));
+
+			++tile;
+		}
+	}
+
+	QCOMPARE(tile, Pairwise::Index::tileCount(1000, tileSize));
+
+	// verify that the owner order permutes the tiles within each row of tiles,
+	// keeps the diagonal last, and deals the same columns to each owner
+	for ( qint32 owners : { 1, 3, 4, 7 } )
+	{
+		tile = 0;
+
+		for ( qint32 i = 0; i < numTiles; ++i )
+		{
+			QVector<bool> dealt(i + 1, false);
+			qint32 foreign {0};
+
+			for ( qint32 j = 0; j <= i; ++j )
+			{
+				qint64 owned {Pairwise::Index::ownedTile(tile, owners)};
+				qint64 column {owned - Pairwise::Index::rowOffset(i + 1)};
+
+				QVERIFY(column >= 0 && column <= i);
+				QVERIFY(!dealt[column]);
+				dealt[column] = true;
+
+				if ( j == i )
+				{
+					QCOMPARE(column, static_cast<qint64>(i));
+				}
+				else if ( column % owners != tile % owners )
+				{
+					++foreign;
+				}
+
+				++tile;
+			}
+
+			QVERIFY(foreign < owners);
+		}
+	}
+}
+
+
+
+void TestPairwiseIndex::benchmarkDecode_data()
+{
+	QTest::addColumn<qint32>("geneSize");
+	QTest::addColumn<bool>("closedForm");
+
+	for ( qint32 geneSize : { 1000, 60000, 500000 } )
+	{
+		QTest::newRow(qPrintable(QString("loop G=%1").arg(geneSize))) << geneSize << false;
+		QTest::newRow(qPrintable(QString("closed-form G=%1").arg(geneSize))) << geneSize << true;
+	}
+}
+
+
+
+void TestPairwiseIndex::benchmarkDecode()
+{
+	QFETCH(qint32, geneSize);
+	QFETCH(bool, closedForm);
+
+	// decode the first index of each work block in the last rows of the matrix,
+	// which is the worst case for the reference decode; the blocks are made
+	// smaller for matrices with too few pairs so that every index is valid
+	const int numBlocks {100};
+	const qint64 totalPairs {Pairwise::Index::rowOffset(geneSize)};
+	const qint64 blockSize {qMin(32768LL, totalPairs / numBlocks)};
+	qint64 start {totalPairs - numBlocks * blockSize};
+	qint64 checksum {0};
+
+	QBENCHMARK
+	{
+		for ( int i = 0; i < numBlocks; ++i )
+		{
+			qint64 scalar {start + i * blockSize};
+			Pairwise::Index index {closedForm ? Pairwise::Index(scalar) : decodeLoop(scalar)};
+
+			checksum += index.getX();
+		}
+	}
+
+	QVERIFY(checksum > 0);
+}
@@ -0,0 +1,18 @@
+#ifndef TESTPAIRWISEINDEX_H
+#define TESTPAIRWISEINDEX_H
+#include <QtTest/QtTest>
+
+
+
+class TestPairwiseIndex : public QObject
+{
+	Q_OBJECT
+private slots:
+	void test();
+	void benchmarkDecode_data();
+	void benchmarkDecode();
+};
+
+
+
+#endif
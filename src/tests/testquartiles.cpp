@@ -0,0 +1,29 @@
+#include <ace/core/core.h>
+
+#include "testquartiles.h"
+#include "../core/similarity.h"
+
+
+
+void TestQuartiles::test()
+{
+	// verify that the selected quartiles are the quartiles of the sorted data
+	for ( int n = 1; n <= 64; ++n )
+	{
+		std::vector<float> values(n);
+
+		for ( auto& value : values )
+		{
+			value = static_cast<float>(rand() % 16);
+		}
+
+		std::vector<float> sorted {values};
+		std::sort(sorted.begin(), sorted.end());
+
+		float Q1, Q3;
+		Similarity::computeQuartiles(values.data(), n, &Q1, &Q3);
+
+		QCOMPARE(Q1, sorted[n * 1 / 4]);
+		QCOMPARE(Q3, sorted[n * 3 / 4]);
+	}
+}
@@ -0,0 +1,16 @@
+#ifndef TESTQUARTILES_H
+#define TESTQUARTILES_H
+#include <QtTest/QtTest>
+
+
+
+class TestQuartiles : public QObject
+{
+	Q_OBJECT
+private slots:
+	void test();
+};
+
+
+
+#endif
@@ -15,10 +15,15 @@ SOURCES += \
 	testexportcorrelationmatrix.cpp \
 	testexportexpressionmatrix.cpp \
 	testexpressionmatrix.cpp \
+	testgmm.cpp \
 	testimportcorrelationmatrix.cpp \
 	testimportexpressionmatrix.cpp \
+	testpairwiseindex.cpp \
+	testquartiles.cpp \
 	testrmt.cpp \
+	testsamplemasks.cpp \
 	testsimilarity.cpp \
+	testtiledcorrelation.cpp \
 	main.cpp
 
 HEADERS += \
@@ -27,10 +32,15 @@ HEADERS += \
 	testexportcorrelationmatrix.h \
 	testexportexpressionmatrix.h \
 	testexpressionmatrix.h \
+	testgmm.h \
 	testimportcorrelationmatrix.h \
 	testimportexpressionmatrix.h \
+	testpairwiseindex.h \
+	testquartiles.h \
 	testrmt.h \
-	testsimilarity.h
+	testsamplemasks.h \
+	testsimilarity.h \
+	testtiledcorrelation.h
 
 # Installation instructions
 isEmpty(PREFIX) { PREFIX = /usr/local }
@@ -0,0 +1,47 @@
+#include <ace/core/core.h>
+
+#include "testsamplemasks.h"
+#include "../core/pairwise_samplemasks.h"
+
+
+
+void TestSampleMasks::test()
+{
+	// verify that the sample masks give the same labels as a comparison of each sample
+	for ( int n : { 1, 63, 64, 65, 200 } )
+	{
+		std::vector<float> values(2 * n);
+
+		for ( auto& value : values )
+		{
+			int r = rand() % 8;
+			value = (r == 0) ? NAN : static_cast<float>(r);
+		}
+
+		Pairwise::SampleMasks masks(values.data(), 2, n, 2.0f);
+		QVector<qint8> labels(n);
+		int numSamples = masks.labels(1, 0, labels.data());
+
+		for ( int i = 0; i < n; ++i )
+		{
+			float x = values[1 * n + i];
+			float y = values[0 * n + i];
+			qint8 expected = (std::isnan(x) || std::isnan(y)) ? -9 : (x < 2.0f || y < 2.0f) ? -6 : 0;
+
+			QCOMPARE(labels[i], expected);
+		}
+
+		QCOMPARE(numSamples, static_cast<int>(std::count(labels.begin(), labels.end(), 0)));
+		QCOMPARE(masks.count(1, 0), numSamples);
+
+		// verify that masks which are computed one gene at a time are the same
+		Pairwise::SampleMasks split(2, n);
+		QVector<qint8> splitLabels(n);
+
+		split.compute(values.data(), 1, 2, 2.0f);
+		split.compute(values.data(), 0, 1, 2.0f);
+
+		QCOMPARE(split.labels(1, 0, splitLabels.data()), numSamples);
+		QCOMPARE(splitLabels, labels);
+	}
+}
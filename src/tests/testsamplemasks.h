@@ -0,0 +1,16 @@
+#ifndef TESTSAMPLEMASKS_H
+#define TESTSAMPLEMASKS_H
+#include <QtTest/QtTest>
+
+
+
+class TestSampleMasks : public QObject
+{
+	Q_OBJECT
+private slots:
+	void test();
+};
+
+
+
+#endif
@@ -0,0 +1,77 @@
+#include <ace/core/core.h>
+
+#include "testtiledcorrelation.h"
+#include "../core/pairwise_pearson.h"
+#include "../core/pairwise_tiledcorrelation.h"
+
+
+
+void TestTiledCorrelation::test()
+{
+	// create random expression data with missing and below-threshold values
+	int numGenes = 300;
+	int numSamples = 97;
+	float minExpression = -5.0f;
+	int minSamples = 30;
+	std::vector<float> expressions(numGenes * numSamples);
+
+	for ( int i = 0; i < numGenes; ++i )
+	{
+		for ( int j = 0; j < numSamples; ++j )
+		{
+			float value = -10.0f + 20.0f * rand() / RAND_MAX;
+
+			if ( i % 3 == 0 && rand() % 5 == 0 )
+			{
+				value = NAN;
+			}
+
+			expressions[i * numSamples + j] = value;
+		}
+	}
+
+	// compute all correlations with the tiled engine
+	Pairwise::TiledCorrelation tiledModel(expressions.data(), numGenes, numSamples, minExpression, minSamples);
+	std::vector<float> tile(numGenes * numGenes);
+	std::vector<float> workspace;
+
+	tiledModel.compute(0, numGenes, 0, numGenes, tile.data(), workspace);
+
+	// verify each correlation against the pairwise correlation model
+	Pairwise::Pearson pearson;
+	QVector<qint8> labels(numSamples);
+
+	for ( Pairwise::Index index; index.getX() < numGenes; ++index )
+	{
+		const float *x = &expressions[index.getX() * numSamples];
+		const float *y = &expressions[index.getY() * numSamples];
+
+		for ( int i = 0; i < numSamples; ++i )
+		{
+			if ( std::isnan(x[i]) || std::isnan(y[i]) )
+			{
+				labels[i] = -9;
+			}
+			else if ( x[i] < minExpression || y[i] < minExpression )
+			{
+				labels[i] = -6;
+			}
+			else
+			{
+				labels[i] = 0;
+			}
+		}
+
+		float expected;
+		pearson.compute(expressions.data(), index, 1, labels.constData(), numSamples, minSamples, &expected);
+
+		float actual = tile[index.getX() * numGenes + index.getY()];
+
+		QCOMPARE(std::isnan(actual), std::isnan(expected));
+
+		if ( !std::isnan(expected) )
+		{
+			QVERIFY(fabs(actual - expected) < 1e-4f);
+		}
+	}
+}
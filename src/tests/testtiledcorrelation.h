@@ -0,0 +1,16 @@
+#ifndef TESTTILEDCORRELATION_H
+#define TESTTILEDCORRELATION_H
+#include <QtTest/QtTest>
+
+
+
+class TestTiledCorrelation : public QObject
+{
+	Q_OBJECT
+private slots:
+	void test();
+};
+
+
+
+#endif